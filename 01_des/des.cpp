@@ -1,4 +1,19 @@
-#include <bits/stdc++.h>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sdes.hpp"
+#include "sdes_bitslice.hpp"
+#include "../common/instrument.hpp"
 using namespace std;
 
 /*
@@ -12,29 +27,18 @@ using namespace std;
  */
 
 // --- Permutation and S-Box Constants ---
-int P10[] = {3, 5, 2, 7, 4, 10, 1, 9, 8, 6};
-int P8[]  = {6, 3, 7, 4, 8, 5, 10, 9};
-int P4[]  = {2, 4, 3, 1};
-int IP[]  = {2, 6, 3, 1, 4, 8, 5, 7};
-int IP_INV[] = {4, 1, 3, 5, 7, 2, 8, 6};
-int E_P[] = {4, 1, 2, 3, 2, 3, 4, 1};
-
-int S0[4][4] = {
-    {1, 0, 3, 2},
-    {3, 2, 1, 0},
-    {0, 2, 1, 3},
-    {3, 1, 3, 2}
-};
-
-int S1[4][4] = {
-    {0, 1, 2, 3},
-    {2, 0, 1, 3},
-    {3, 0, 1, 0},
-    {2, 1, 0, 3}
-};
+// Shared with the bit-packed engine in sdes.hpp so both use one set of tables.
+using sdes_packed::P10;
+using sdes_packed::P8;
+using sdes_packed::P4;
+using sdes_packed::IP;
+using sdes_packed::IP_INV;
+using sdes_packed::E_P;
+using sdes_packed::S0;
+using sdes_packed::S1;
 
 // Utility functions
-vector<int> permute(const vector<int> &arr, int perm[], int size) {
+vector<int> permute(const vector<int> &arr, const int perm[], int size) {
     vector<int> result(size);
     for (int i = 0; i < size; i++) {
         result[i] = arr[perm[i] - 1];
@@ -44,7 +48,7 @@ vector<int> permute(const vector<int> &arr, int perm[], int size) {
 
 vector<int> leftShift(const vector<int> &bits, int shifts) {
     vector<int> shifted(bits.size());
-    for (int i = 0; i < bits.size(); i++) {
+    for (size_t i = 0; i < bits.size(); i++) {
         shifted[i] = bits[(i + shifts) % bits.size()];
     }
     return shifted;
@@ -52,13 +56,13 @@ vector<int> leftShift(const vector<int> &bits, int shifts) {
 
 vector<int> XOR(const vector<int> &a, const vector<int> &b) {
     vector<int> res(a.size());
-    for (int i = 0; i < a.size(); i++) res[i] = a[i] ^ b[i];
+    for (size_t i = 0; i < a.size(); i++) res[i] = a[i] ^ b[i];
     return res;
 }
 
 int binToInt(const vector<int> &bits) {
     int val = 0;
-    for (int i = 0; i < bits.size(); i++) {
+    for (size_t i = 0; i < bits.size(); i++) {
         val = (val << 1) | bits[i];
     }
     return val;
@@ -73,7 +77,7 @@ vector<int> intToBin(int val, int size) {
     return bits;
 }
 
-vector<int> sBox(const vector<int> &input, int sMatrix[4][4]) {
+vector<int> sBox(const vector<int> &input, const int sMatrix[4][4]) {
     int row = (input[0] << 1) | input[3];
     int col = (input[1] << 1) | input[2];
     int val = sMatrix[row][col];
@@ -125,6 +129,8 @@ vector<int> functionF(const vector<int> &left, const vector<int> &right, const v
 
 // DES main
 vector<int> sdes(vector<int> input, vector<int> key, bool decrypt) {
+    instrument::Scope timer(instrument::Probe::SdesReference);
+    instrument::count(instrument::Counter::SdesBlocks);
     auto [k1, k2] = generateKeys(key);
     if (decrypt) swap(k1, k2);
 
@@ -142,7 +148,7 @@ vector<int> sdes(vector<int> input, vector<int> key, bool decrypt) {
 
 // Input parsing helper
 vector<int> parseBits(const string &s, int expected) {
-    if (s.size() != expected || s.find_first_not_of("01") != string::npos) {
+    if (s.size() != size_t(expected) || s.find_first_not_of("01") != string::npos) {
         cout << "Invalid input. Must be " << expected << " bits (0 or 1 only).\n";
         return {};
     }
@@ -156,8 +162,280 @@ void printBits(const vector<int> &bits) {
     cout << "\n";
 }
 
+// Runs every (block, key, mode) combination through both the vector reference
+// and the bit-packed engine and reports the first mismatch, if any.
+bool crossCheck() {
+    for (int k = 0; k < 1024; k++) {
+        vector<int> key = intToBin(k, 10);
+        sdes_packed::SdesContext ctx(uint16_t(k), true);
+        for (int b = 0; b < 256; b++) {
+            vector<int> block = intToBin(b, 8);
+            for (bool decrypt : {false, true}) {
+                int expected = binToInt(sdes(block, key, decrypt));
+                int actual = sdes_packed::sdes(uint8_t(b), uint16_t(k), decrypt);
+                int tabled = decrypt ? ctx.decrypt(uint8_t(b)) : ctx.encrypt(uint8_t(b));
+                if (expected != actual || expected != tabled) {
+                    cout << "Mismatch: block=" << bitset<8>(b) << " key=" << bitset<10>(k)
+                         << (decrypt ? " decrypt" : " encrypt") << " reference=" << bitset<8>(expected)
+                         << " packed=" << bitset<8>(actual)
+                         << " table=" << bitset<8>(tabled) << "\n";
+                    return false;
+                }
+            }
+        }
+    }
+    cout << "Bit-packed engine and block tables match the reference for all 1024 keys x 256 blocks.\n";
+
+    // Every bitsliced kernel this CPU can run, against the packed engine.
+    sdes_bitslice::Kernel active = sdes_bitslice::activeKernel();
+    vector<uint8_t> blocks(256), out(1024);
+    vector<uint16_t> keys(1024);
+    iota(blocks.begin(), blocks.end(), 0);
+    iota(keys.begin(), keys.end(), 0);
+    for (int kernel = 0; kernel <= int(active); kernel++) {
+        sdes_bitslice::selectKernel(sdes_bitslice::Kernel(kernel));
+        for (int k = 0; k < 1024; k++) {
+            for (bool decrypt : {false, true}) {
+                sdes_bitslice::encryptBlocks(blocks.data(), out.data(), 256, uint16_t(k), decrypt);
+                for (int b = 0; b < 256; b++) {
+                    if (out[b] != sdes_packed::sdes(uint8_t(b), uint16_t(k), decrypt)) {
+                        cout << "Bitsliced " << sdes_bitslice::kernelName(sdes_bitslice::Kernel(kernel))
+                             << " mismatch: block=" << bitset<8>(b) << " key=" << bitset<10>(k) << "\n";
+                        return false;
+                    }
+                }
+            }
+        }
+        for (int b = 0; b < 256; b++) {
+            sdes_bitslice::encryptUnderKeys(uint8_t(b), keys.data(), out.data(), 1024);
+            for (int k = 0; k < 1024; k++) {
+                if (out[k] != sdes_packed::sdes(uint8_t(b), uint16_t(k), false)) {
+                    cout << "Bitsliced " << sdes_bitslice::kernelName(sdes_bitslice::Kernel(kernel))
+                         << " key-batch mismatch: block=" << bitset<8>(b) << " key=" << bitset<10>(k) << "\n";
+                    return false;
+                }
+            }
+        }
+        cout << "Bitsliced " << sdes_bitslice::kernelName(sdes_bitslice::Kernel(kernel)) << " kernel matches.\n";
+    }
+    sdes_bitslice::selectKernel(active);
+    return true;
+}
+
+// StreamCipher in every mode: the bytes match the block-by-block definition,
+// feeding the data in uneven chunks (the file mode reads 1 MiB at a time)
+// gives the same bytes as one call, and decryption in chunks restores them.
+bool streamCheck() {
+    const char *names[] = {"ECB", "CBC", "CTR"};
+    vector<uint8_t> plain(5000);
+    for (size_t i = 0; i < plain.size(); i++) plain[i] = uint8_t(i * 37 + (i >> 8));
+    for (int k = 0; k < 1024; k += 93) {
+        sdes_packed::SdesContext ctx(uint16_t(k), true);
+        uint8_t iv = uint8_t(k * 11 + 250); // CTR wraps its 8-bit counter well inside the data
+        for (auto mode : {sdes_packed::Mode::ECB, sdes_packed::Mode::CBC, sdes_packed::Mode::CTR}) {
+            vector<uint8_t> whole = plain;
+            sdes_packed::StreamCipher(ctx, mode, false, iv).process(whole.data(), whole.size());
+            uint8_t chain = iv;
+            bool ok = true;
+            for (size_t i = 0; i < plain.size() && ok; i++) {
+                uint8_t expect;
+                if (mode == sdes_packed::Mode::ECB) expect = sdes_packed::sdes(plain[i], uint16_t(k), false);
+                else if (mode == sdes_packed::Mode::CBC)
+                    expect = chain = sdes_packed::sdes(plain[i] ^ chain, uint16_t(k), false);
+                else expect = plain[i] ^ sdes_packed::sdes(chain++, uint16_t(k), false);
+                ok = whole[i] == expect;
+            }
+            vector<uint8_t> pieces = plain, back;
+            sdes_packed::StreamCipher enc(ctx, mode, false, iv);
+            for (size_t pos = 0, n = 1; pos < pieces.size(); pos += n, n = n * 2 + 1)
+                enc.process(pieces.data() + pos, min(n, pieces.size() - pos));
+            back = pieces;
+            sdes_packed::StreamCipher dec(ctx, mode, true, iv);
+            for (size_t pos = 0, n = 700; pos < back.size(); pos += n, n = n / 2 + 3)
+                dec.process(back.data() + pos, min(n, back.size() - pos));
+            if (!ok || pieces != whole || back != plain) {
+                cout << "StreamCipher " << names[int(mode)] << " mismatch: key=" << bitset<10>(k) << "\n";
+                return false;
+            }
+        }
+    }
+    cout << "StreamCipher ECB, CBC and CTR match the block definitions, in one call and in chunks.\n";
+    return true;
+}
+
+// --- Throughput comparison ---
+template <class F>
+void benchRow(const string &name, size_t blocksPerCall, F &&f) {
+    size_t calls = 0;
+    auto start = chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        f();
+        calls++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.2);
+    cout << left << setw(26) << name << right << setw(14) << fixed << setprecision(0)
+         << calls * blocksPerCall / seconds << " blocks/s\n";
+}
+
+void runBench() {
+    const size_t N = 1 << 16;
+    vector<uint8_t> data(N), out(N);
+    for (size_t i = 0; i < N; i++) data[i] = uint8_t(i * 131 + 7);
+    uint16_t key = 0b0111111101;
+    volatile uint8_t sink = 0;
+
+    vector<int> keyBits = intToBin(key, 10);
+    benchRow("reference sdes()", 1024, [&] {
+        for (int i = 0; i < 1024; i++) sink = sink + sdes(intToBin(data[i], 8), keyBits, false)[0];
+    });
+    benchRow("packed sdes()", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = sdes_packed::sdes(data[i], key, false);
+    });
+    sdes_packed::SdesContext ctx(key);
+    benchRow("context, no tables", N, [&] { ctx.encrypt(data.data(), out.data(), N); });
+    ctx.buildTables();
+    benchRow("context, 256-byte table", N, [&] { ctx.encrypt(data.data(), out.data(), N); });
+
+    sdes_bitslice::Kernel active = sdes_bitslice::activeKernel();
+    for (int kernel = 0; kernel <= int(active); kernel++) {
+        sdes_bitslice::selectKernel(sdes_bitslice::Kernel(kernel));
+        string name = sdes_bitslice::kernelName(sdes_bitslice::Kernel(kernel));
+        benchRow("bitsliced " + name, N, [&] { sdes_bitslice::encryptBlocks(data.data(), out.data(), N, key); });
+        uint8_t plain = 0xA2, cipher = 0x38;
+        uint64_t mask[16];
+        benchRow("brute force " + name, 1024, [&] {
+            sdes_bitslice::matchAllKeys(&plain, &cipher, 1, mask);
+            sink = sink + uint8_t(mask[7]);
+        });
+    }
+    sdes_bitslice::selectKernel(active);
+    benchRow("brute force packed", 1024, [&] {
+        for (int k = 0; k < 1024; k++) sink = sink + (sdes_packed::sdes(0xA2, uint16_t(k), false) == 0x38);
+    });
+}
+
+// --- Streaming mode ---
+// des --encrypt|--decrypt --key <10 bits> [--mode ecb|cbc|ctr] [--iv <8 bits>]
+//     [--in <file>] [--out <file>]
+// Reads stdin (or --in) in large chunks, transforms each chunk in place and
+// writes it to stdout (or --out). Throughput goes to stderr.
+const size_t STREAM_CHUNK = 1 << 20;
+
+bool parseBitValue(const string &s, int expected, int &value) {
+    if (s.size() != size_t(expected) || s.find_first_not_of("01") != string::npos) return false;
+    value = stoi(s, nullptr, 2);
+    return true;
+}
+
+int runStream(int argc, char *argv[]) {
+    bool decrypt = string(argv[1]) == "--decrypt";
+    sdes_packed::Mode mode = sdes_packed::Mode::ECB;
+    int key = -1, iv = 0;
+    const char *inPath = nullptr, *outPath = nullptr;
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << "\n";
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "--key") {
+            if (!parseBitValue(value, 10, key)) {
+                cerr << "Invalid key. Must be 10 bits (0 or 1 only).\n";
+                return 2;
+            }
+        } else if (arg == "--iv") {
+            if (!parseBitValue(value, 8, iv)) {
+                cerr << "Invalid IV. Must be 8 bits (0 or 1 only).\n";
+                return 2;
+            }
+        } else if (arg == "--mode") {
+            if (value == "ecb") mode = sdes_packed::Mode::ECB;
+            else if (value == "cbc") mode = sdes_packed::Mode::CBC;
+            else if (value == "ctr") mode = sdes_packed::Mode::CTR;
+            else {
+                cerr << "Unknown mode " << value << " (expected ecb, cbc or ctr).\n";
+                return 2;
+            }
+        } else if (arg == "--in") {
+            inPath = argv[i];
+        } else if (arg == "--out") {
+            outPath = argv[i];
+        } else {
+            cerr << "Unknown option " << arg << "\n";
+            return 2;
+        }
+    }
+    if (key < 0) {
+        cerr << "A 10-bit --key is required.\n";
+        return 2;
+    }
+
+    FILE *in = inPath ? fopen(inPath, "rb") : freopen(nullptr, "rb", stdin);
+    FILE *out = outPath ? fopen(outPath, "wb") : freopen(nullptr, "wb", stdout);
+    // Closes whatever was opened; false if the output did not reach the disk.
+    auto closeFiles = [&] {
+        if (in && inPath) fclose(in);
+        bool flushed = !out || (outPath ? fclose(out) == 0 : fflush(out) == 0);
+        in = out = nullptr;
+        return flushed;
+    };
+    if (!in || !out) {
+        cerr << "Cannot open " << (!in ? (inPath ? inPath : "stdin") : (outPath ? outPath : "stdout")) << "\n";
+        closeFiles();
+        return 1;
+    }
+    setvbuf(in, nullptr, _IONBF, 0);
+    setvbuf(out, nullptr, _IONBF, 0);
+
+    sdes_packed::SdesContext ctx(uint16_t(key), true);
+    sdes_packed::StreamCipher cipher(ctx, mode, decrypt, uint8_t(iv));
+    vector<uint8_t> buffer(STREAM_CHUNK);
+    size_t total = 0;
+
+    auto start = chrono::steady_clock::now();
+    size_t n;
+    while ((n = fread(buffer.data(), 1, buffer.size(), in)) > 0) {
+        cipher.process(buffer.data(), n);
+        if (fwrite(buffer.data(), 1, n, out) != n) {
+            cerr << "Write failed.\n";
+            closeFiles();
+            return 1;
+        }
+        total += n;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (ferror(in)) {
+        cerr << "Read failed.\n";
+        closeFiles();
+        return 1;
+    }
+    if (!closeFiles()) {
+        cerr << "Write failed.\n";
+        return 1;
+    }
+
+    cerr << (decrypt ? "Decrypted " : "Encrypted ") << total << " bytes in " << fixed << setprecision(3)
+         << seconds << " s (" << setprecision(1) << (seconds > 0 ? total / seconds / 1e6 : 0.0)
+         << " MB/s)\n";
+    return 0;
+}
+
 // --- Interactive Menu ---
-int main() {
+int main(int argc, char *argv[]) {
+    if (argc > 1 && string(argv[1]) == "--selftest") {
+        return crossCheck() && streamCheck() ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        runBench();
+        return 0;
+    }
+    if (argc > 1 && (string(argv[1]) == "--encrypt" || string(argv[1]) == "--decrypt")) {
+        return runStream(argc, argv);
+    }
+
     vector<int> input, key;
     bool decrypt = false;
     while (true) {
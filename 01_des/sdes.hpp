@@ -0,0 +1,247 @@
+#pragma once
+
+/*
+ * Bit-packed S-DES engine
+ * -----------------------
+ * Same cipher as the vector<int> reference in des.cpp, but blocks are held
+ * in a uint8_t and keys in a uint16_t. Bit 1 of every table is the most
+ * significant bit, matching the order parseBits()/printBits() use, so a
+ * bit string "10100010" is the byte 0b10100010 in both implementations.
+ *
+ * All permutations on the block path are precomputed at compile time and
+ * nothing here allocates.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "../common/instrument.hpp"
+
+namespace sdes_packed {
+
+// --- Permutation and S-Box Constants (1-based, MSB first) ---
+inline constexpr int P10[] = {3, 5, 2, 7, 4, 10, 1, 9, 8, 6};
+inline constexpr int P8[]  = {6, 3, 7, 4, 8, 5, 10, 9};
+inline constexpr int P4[]  = {2, 4, 3, 1};
+inline constexpr int IP[]  = {2, 6, 3, 1, 4, 8, 5, 7};
+inline constexpr int IP_INV[] = {4, 1, 3, 5, 7, 2, 8, 6};
+inline constexpr int E_P[] = {4, 1, 2, 3, 2, 3, 4, 1};
+
+inline constexpr int S0[4][4] = {
+    {1, 0, 3, 2},
+    {3, 2, 1, 0},
+    {0, 2, 1, 3},
+    {3, 1, 3, 2}
+};
+
+inline constexpr int S1[4][4] = {
+    {0, 1, 2, 3},
+    {2, 0, 1, 3},
+    {3, 0, 1, 0},
+    {2, 1, 0, 3}
+};
+
+// Applies a 1-based permutation table to the low `inBits` bits of `value`.
+template <std::size_t N>
+constexpr uint32_t permuteBits(uint32_t value, const int (&perm)[N], int inBits) {
+    uint32_t out = 0;
+    for (std::size_t i = 0; i < N; i++)
+        out = (out << 1) | ((value >> (inBits - perm[i])) & 1u);
+    return out;
+}
+
+// Circular left shift of a 5-bit half key.
+constexpr uint32_t rotl5(uint32_t half, int shifts) {
+    return ((half << shifts) | (half >> (5 - shifts))) & 0x1F;
+}
+
+constexpr uint8_t sBoxLookup(uint32_t nibble, const int (&sMatrix)[4][4]) {
+    int row = int(((nibble >> 2) & 2) | (nibble & 1));
+    int col = int((nibble >> 1) & 3);
+    return uint8_t(sMatrix[row][col]);
+}
+
+namespace detail {
+
+template <std::size_t N>
+constexpr std::array<uint8_t, 256> blockPermutationTable(const int (&perm)[N]) {
+    std::array<uint8_t, 256> table{};
+    for (uint32_t v = 0; v < 256; v++)
+        table[v] = uint8_t(permuteBits(v, perm, 8));
+    return table;
+}
+
+constexpr std::array<uint8_t, 16> expansionTable() {
+    std::array<uint8_t, 16> table{};
+    for (uint32_t v = 0; v < 16; v++)
+        table[v] = uint8_t(permuteBits(v, E_P, 4));
+    return table;
+}
+
+// S0/S1 followed by P4, indexed by the 8-bit value E_P(R) ^ K.
+constexpr std::array<uint8_t, 256> substitutionTable() {
+    std::array<uint8_t, 256> table{};
+    for (uint32_t v = 0; v < 256; v++) {
+        uint32_t s = (uint32_t(sBoxLookup(v >> 4, S0)) << 2) | sBoxLookup(v & 0xF, S1);
+        table[v] = uint8_t(permuteBits(s, P4, 4));
+    }
+    return table;
+}
+
+} // namespace detail
+
+inline constexpr std::array<uint8_t, 256> kIP = detail::blockPermutationTable(IP);
+inline constexpr std::array<uint8_t, 256> kIPInv = detail::blockPermutationTable(IP_INV);
+inline constexpr std::array<uint8_t, 16> kEP = detail::expansionTable();
+inline constexpr std::array<uint8_t, 256> kSP = detail::substitutionTable();
+
+// --- Key generation (produces K1, K2) ---
+struct RoundKeys {
+    uint8_t k1;
+    uint8_t k2;
+};
+
+constexpr RoundKeys generateKeys(uint16_t key) {
+    uint32_t p10 = permuteBits(key & 0x3FFu, P10, 10);
+    uint32_t left = p10 >> 5, right = p10 & 0x1F;
+
+    // LS-1
+    left = rotl5(left, 1);
+    right = rotl5(right, 1);
+    uint8_t k1 = uint8_t(permuteBits((left << 5) | right, P8, 10));
+
+    // LS-2
+    left = rotl5(left, 2);
+    right = rotl5(right, 2);
+    uint8_t k2 = uint8_t(permuteBits((left << 5) | right, P8, 10));
+
+    return {k1, k2};
+}
+
+// F-function applied to the right nibble and folded into the left one.
+constexpr uint8_t functionF(uint8_t block, uint8_t subkey) {
+    return uint8_t(block ^ (kSP[kEP[block & 0xF] ^ subkey] << 4));
+}
+
+constexpr uint8_t encryptBlock(uint8_t block, RoundKeys keys) {
+    uint8_t state = kIP[block];
+    state = functionF(state, keys.k1);
+    state = uint8_t((state << 4) | (state >> 4)); // SW
+    state = functionF(state, keys.k2);
+    return kIPInv[state];
+}
+
+constexpr uint8_t decryptBlock(uint8_t block, RoundKeys keys) {
+    return encryptBlock(block, {keys.k2, keys.k1});
+}
+
+// Drop-in equivalent of sdes(input, key, decrypt) from des.cpp.
+constexpr uint8_t sdes(uint8_t input, uint16_t key, bool decrypt) {
+    RoundKeys keys = generateKeys(key);
+    return decrypt ? decryptBlock(input, keys) : encryptBlock(input, keys);
+}
+
+// --- Keyed context ---
+// Runs the key schedule once per key. With tables built, the whole cipher
+// under that key is two 256-byte permutations and each byte is one lookup.
+class SdesContext {
+public:
+    explicit SdesContext(uint16_t key, bool withTables = false) : keys(generateKeys(key)) {
+        if (withTables) buildTables();
+    }
+
+    void buildTables() {
+        for (int b = 0; b < 256; b++) {
+            uint8_t c = encryptBlock(uint8_t(b), keys);
+            encTable[b] = c;
+            decTable[c] = uint8_t(b);
+        }
+        tablesReady = true;
+    }
+
+    bool hasTables() const { return tablesReady; }
+    RoundKeys roundKeys() const { return keys; }
+
+    uint8_t encrypt(uint8_t block) const {
+        return tablesReady ? encTable[block] : encryptBlock(block, keys);
+    }
+
+    uint8_t decrypt(uint8_t block) const {
+        return tablesReady ? decTable[block] : decryptBlock(block, keys);
+    }
+
+    // Bulk ECB over n bytes; `in` and `out` may alias.
+    void encrypt(const uint8_t *in, uint8_t *out, std::size_t n) const {
+        instrument::Scope timer(instrument::Probe::SdesBulk);
+        instrument::count(instrument::Counter::SdesBlocks, n);
+        if (tablesReady) {
+            for (std::size_t i = 0; i < n; i++) out[i] = encTable[in[i]];
+        } else {
+            for (std::size_t i = 0; i < n; i++) out[i] = encryptBlock(in[i], keys);
+        }
+    }
+
+    void decrypt(const uint8_t *in, uint8_t *out, std::size_t n) const {
+        instrument::Scope timer(instrument::Probe::SdesBulk);
+        instrument::count(instrument::Counter::SdesBlocks, n);
+        if (tablesReady) {
+            for (std::size_t i = 0; i < n; i++) out[i] = decTable[in[i]];
+        } else {
+            for (std::size_t i = 0; i < n; i++) out[i] = decryptBlock(in[i], keys);
+        }
+    }
+
+private:
+    RoundKeys keys;
+    bool tablesReady = false;
+    std::array<uint8_t, 256> encTable{};
+    std::array<uint8_t, 256> decTable{};
+};
+
+// --- Modes of operation over byte streams ---
+// Every S-DES block is one byte. CBC chains on the previous ciphertext byte
+// and CTR encrypts an 8-bit counter starting at the IV, so its keystream
+// repeats every 256 bytes: fine for exercising the cipher, useless for secrecy.
+enum class Mode { ECB, CBC, CTR };
+
+// Keeps the chaining state between calls so a stream can be fed in chunks.
+class StreamCipher {
+public:
+    StreamCipher(const SdesContext &ctx, Mode mode, bool decrypt, uint8_t iv = 0)
+        : ctx(ctx), mode(mode), decrypt(decrypt), chain(iv) {}
+
+    // Processes n bytes in place.
+    void process(uint8_t *data, std::size_t n) {
+        switch (mode) {
+        case Mode::ECB:
+            if (decrypt) ctx.decrypt(data, data, n);
+            else ctx.encrypt(data, data, n);
+            break;
+        case Mode::CBC:
+            if (decrypt) {
+                for (std::size_t i = 0; i < n; i++) {
+                    uint8_t c = data[i];
+                    data[i] = ctx.decrypt(c) ^ chain;
+                    chain = c;
+                }
+            } else {
+                for (std::size_t i = 0; i < n; i++)
+                    chain = data[i] = ctx.encrypt(uint8_t(data[i] ^ chain));
+            }
+            break;
+        case Mode::CTR:
+            for (std::size_t i = 0; i < n; i++)
+                data[i] ^= ctx.encrypt(chain++);
+            break;
+        }
+    }
+
+private:
+    const SdesContext &ctx;
+    Mode mode;
+    bool decrypt;
+    uint8_t chain; // previous ciphertext byte (CBC) or next counter (CTR)
+};
+
+} // namespace sdes_packed
@@ -0,0 +1,410 @@
+#pragma once
+
+/*
+ * Bitsliced batch S-DES
+ * ---------------------
+ * A batch of blocks is transposed into 8 bit-planes: plane p holds bit p+1
+ * of every block, one block per bit lane. The permutations then cost
+ * nothing (they only rename planes), the key XOR is a plane XOR, and S0/S1
+ * become small boolean circuits generated from their truth tables at
+ * compile time. One pass of the kernel encrypts 64 blocks per 64-bit lane.
+ *
+ * The same kernel is instantiated for a plain uint64_t (64 blocks), a 128-bit
+ * vector (SSE2 / NEON, 128 blocks), AVX2 (256) and AVX-512 (512). The widest
+ * kernel the CPU supports is picked once at runtime.
+ *
+ * Three entry points:
+ *   encryptBlocks()    many blocks, one key
+ *   encryptUnderKeys() one block, many keys (key schedule is bitsliced too)
+ *   matchAllKeys()     known-plaintext test of all 1024 keys at once, for
+ *                      brute force; no transposition is needed at all
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#include "sdes.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SDES_BITSLICE_X86 1
+#endif
+
+namespace sdes_bitslice {
+
+using sdes_packed::RoundKeys;
+
+enum class Kernel { Scalar64, Vector128, AVX2, AVX512 };
+
+inline const char *kernelName(Kernel k) {
+    switch (k) {
+    case Kernel::Scalar64: return "scalar64";
+    case Kernel::Vector128: return "vector128";
+    case Kernel::AVX2: return "avx2";
+    case Kernel::AVX512: return "avx512";
+    }
+    return "?";
+}
+
+namespace detail {
+
+#if defined(__GNUC__)
+#define SDES_INLINE inline __attribute__((always_inline))
+typedef uint64_t V128 __attribute__((vector_size(16)));
+typedef uint64_t V256 __attribute__((vector_size(32)));
+typedef uint64_t V512 __attribute__((vector_size(64)));
+#else
+#define SDES_INLINE inline
+#endif
+
+template <class V>
+constexpr std::size_t LANES = sizeof(V) / sizeof(uint64_t);
+
+template <class V>
+SDES_INLINE void broadcast(V &v, uint64_t s) {
+    uint64_t lanes[LANES<V>];
+    for (std::size_t i = 0; i < LANES<V>; i++) lanes[i] = s;
+    std::memcpy(&v, lanes, sizeof(V));
+}
+
+// --- S-box circuits ---
+// Truth table of one output bit of an S-box, indexed by the 4-bit input.
+constexpr uint32_t sBoxTruthTable(const int (&sMatrix)[4][4], int outBit) {
+    uint32_t t = 0;
+    for (uint32_t v = 0; v < 16; v++)
+        t |= uint32_t((sdes_packed::sBoxLookup(v, sMatrix) >> outBit) & 1) << v;
+    return t;
+}
+
+// Shannon expansion of a Bits-input function with truth table T, branching
+// on x[0] (the most significant input). Equal cofactors and constant leaves
+// are folded so the circuit only contains the gates it needs.
+template <uint32_t T, int Bits, class V>
+SDES_INLINE void lut(V &out, const V *x) {
+    if constexpr (Bits == 0) {
+        out = (T & 1) ? ~V{} : V{};
+    } else {
+        constexpr uint32_t entries = 1u << (Bits - 1);
+        constexpr uint32_t mask = entries == 32 ? 0xFFFFFFFFu : (1u << entries) - 1;
+        constexpr uint32_t lo = T & mask, hi = (T >> entries) & mask;
+        if constexpr (lo == hi) {
+            lut<lo, Bits - 1>(out, x + 1);
+        } else if constexpr (lo == 0) {
+            V b;
+            lut<hi, Bits - 1>(b, x + 1);
+            out = x[0] & b;
+        } else if constexpr (hi == 0) {
+            V a;
+            lut<lo, Bits - 1>(a, x + 1);
+            out = a & ~x[0];
+        } else if constexpr (lo == (~hi & mask)) {
+            V a;
+            lut<lo, Bits - 1>(a, x + 1);
+            out = a ^ x[0];
+        } else {
+            V a, b;
+            lut<lo, Bits - 1>(a, x + 1);
+            lut<hi, Bits - 1>(b, x + 1);
+            out = a ^ (x[0] & (a ^ b));
+        }
+    }
+}
+
+// L ^= P4(S0 || S1)(E_P(R) ^ K) on bit-planes; l and r point at 4 planes each.
+template <class V>
+SDES_INLINE void functionF(V *l, const V *r, const V *k) {
+    using sdes_packed::E_P;
+    using sdes_packed::P4;
+    V e[8];
+    for (int i = 0; i < 8; i++) e[i] = r[E_P[i] - 1] ^ k[i];
+    V s[4];
+    lut<sBoxTruthTable(sdes_packed::S0, 1), 4>(s[0], e);
+    lut<sBoxTruthTable(sdes_packed::S0, 0), 4>(s[1], e);
+    lut<sBoxTruthTable(sdes_packed::S1, 1), 4>(s[2], e + 4);
+    lut<sBoxTruthTable(sdes_packed::S1, 0), 4>(s[3], e + 4);
+    for (int i = 0; i < 4; i++) l[i] ^= s[P4[i] - 1];
+}
+
+template <class V>
+SDES_INLINE void encryptPlanes(V *b, const V *k1, const V *k2) {
+    using sdes_packed::IP;
+    using sdes_packed::IP_INV;
+    V s[8];
+    for (int i = 0; i < 8; i++) s[i] = b[IP[i] - 1];
+    functionF(s, s + 4, k1);
+    // SW: the second round works on (R, L ^ F) without moving any planes.
+    functionF(s + 4, s, k2);
+    V t[8] = {s[4], s[5], s[6], s[7], s[0], s[1], s[2], s[3]};
+    for (int i = 0; i < 8; i++) b[i] = t[IP_INV[i] - 1];
+}
+
+// --- Transposition ---
+// 8x8 bit transpose inside every 64-bit lane (Hacker's Delight, transpose8).
+template <class V>
+SDES_INLINE void transposeBits(V &x) {
+    V t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+}
+
+template <class V>
+SDES_INLINE void swapBytes(V &a, V &b, int shift, uint64_t loMask) {
+    V na = (a & loMask) | ((b << shift) & ~loMask);
+    V nb = ((a >> shift) & loMask) | (b & ~loMask);
+    a = na;
+    b = nb;
+}
+
+// 8x8 byte transpose across eight words, lane by lane.
+template <class V>
+SDES_INLINE void transposeBytes(V *w) {
+    for (int i = 0; i < 4; i++) swapBytes(w[i], w[i + 4], 32, 0x00000000FFFFFFFFULL);
+    for (int i : {0, 1, 4, 5}) swapBytes(w[i], w[i + 2], 16, 0x0000FFFF0000FFFFULL);
+    for (int i : {0, 2, 4, 6}) swapBytes(w[i], w[i + 1], 8, 0x00FF00FF00FF00FFULL);
+}
+
+// 64 * LANES bytes -> 8 planes (plane 0 = most significant bit). Both
+// transposes are involutions, so storePlanes() is the exact inverse.
+template <class V>
+SDES_INLINE void loadPlanes(const uint8_t *bytes, V *planes) {
+    V w[8];
+    for (int i = 0; i < 8; i++) {
+        std::memcpy(&w[i], bytes + i * sizeof(V), sizeof(V));
+        transposeBits(w[i]);
+    }
+    transposeBytes(w);
+    for (int p = 0; p < 8; p++) planes[p] = w[7 - p];
+}
+
+template <class V>
+SDES_INLINE void storePlanes(const V *planes, uint8_t *bytes) {
+    V w[8];
+    for (int p = 0; p < 8; p++) w[7 - p] = planes[p];
+    transposeBytes(w);
+    for (int i = 0; i < 8; i++) {
+        transposeBits(w[i]);
+        std::memcpy(bytes + i * sizeof(V), &w[i], sizeof(V));
+    }
+}
+
+// --- Batch drivers ---
+template <class V>
+SDES_INLINE void subkeyPlanes(RoundKeys keys, V *k1, V *k2) {
+    for (int i = 0; i < 8; i++) {
+        broadcast(k1[i], ((keys.k1 >> (7 - i)) & 1) ? ~0ULL : 0);
+        broadcast(k2[i], ((keys.k2 >> (7 - i)) & 1) ? ~0ULL : 0);
+    }
+}
+
+template <class V>
+SDES_INLINE void encryptBlocksImpl(const uint8_t *in, uint8_t *out, std::size_t n, RoundKeys keys) {
+    constexpr std::size_t CHUNK = 64 * LANES<V>;
+    V k1[8], k2[8], b[8];
+    subkeyPlanes(keys, k1, k2);
+    std::size_t i = 0;
+    for (; i + CHUNK <= n; i += CHUNK) {
+        loadPlanes(in + i, b);
+        encryptPlanes(b, k1, k2);
+        storePlanes(b, out + i);
+    }
+    if (i < n) {
+        uint8_t tail[CHUNK] = {};
+        std::memcpy(tail, in + i, n - i);
+        loadPlanes(tail, b);
+        encryptPlanes(b, k1, k2);
+        storePlanes(b, tail);
+        std::memcpy(out + i, tail, n - i);
+    }
+}
+
+// Source bit of the 10-bit key (0 = most significant) for each subkey bit.
+// The S-DES key schedule is a pure bit permutation, so probing it with
+// single-bit keys recovers the wiring.
+struct ScheduleWiring {
+    int k1[8], k2[8];
+};
+
+constexpr ScheduleWiring scheduleWiring() {
+    ScheduleWiring w{};
+    for (int j = 0; j < 10; j++) {
+        RoundKeys rk = sdes_packed::generateKeys(uint16_t(1u << (9 - j)));
+        for (int i = 0; i < 8; i++) {
+            if ((rk.k1 >> (7 - i)) & 1) w.k1[i] = j;
+            if ((rk.k2 >> (7 - i)) & 1) w.k2[i] = j;
+        }
+    }
+    return w;
+}
+
+inline constexpr ScheduleWiring WIRING = scheduleWiring();
+
+template <class V>
+SDES_INLINE void encryptUnderKeysImpl(uint8_t block, const uint16_t *keys, uint8_t *out, std::size_t n,
+                                      bool decrypt) {
+    constexpr std::size_t CHUNK = 64 * LANES<V>;
+    for (std::size_t i = 0; i < n; i += CHUNK) {
+        std::size_t count = n - i < CHUNK ? n - i : CHUNK;
+        // Split the 10-bit keys into a high and a low byte and transpose both
+        // with the block transposer so key lanes line up with output lanes.
+        uint8_t hiBytes[CHUNK] = {}, loBytes[CHUNK] = {};
+        for (std::size_t j = 0; j < count; j++) {
+            hiBytes[j] = uint8_t((keys[i + j] >> 8) & 0x3);
+            loBytes[j] = uint8_t(keys[i + j]);
+        }
+        V hi[8], lo[8], key[10];
+        loadPlanes(hiBytes, hi);
+        loadPlanes(loBytes, lo);
+        key[0] = hi[6];
+        key[1] = hi[7];
+        for (int j = 2; j < 10; j++) key[j] = lo[j - 2];
+
+        V k1[8], k2[8], b[8];
+        for (int j = 0; j < 8; j++) {
+            k1[j] = key[WIRING.k1[j]];
+            k2[j] = key[WIRING.k2[j]];
+            broadcast(b[j], ((block >> (7 - j)) & 1) ? ~0ULL : 0);
+        }
+        if (decrypt) encryptPlanes(b, k2, k1);
+        else encryptPlanes(b, k1, k2);
+
+        uint8_t result[CHUNK];
+        storePlanes(b, result);
+        std::memcpy(out + i, result, count);
+    }
+}
+
+// Keys base + 64 * lane + bit, so the six low key bits are fixed patterns
+// and the rest are constant per lane.
+template <class V>
+SDES_INLINE void keyIndexPlanes(unsigned base, V *key) {
+    static constexpr uint64_t LOW_BITS[6] = {
+        0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+        0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL,
+    };
+    for (int j = 0; j < 10; j++) {
+        int bit = 9 - j;
+        uint64_t lanes[LANES<V>];
+        for (std::size_t l = 0; l < LANES<V>; l++) {
+            unsigned k = base + unsigned(64 * l);
+            lanes[l] = bit < 6 ? LOW_BITS[bit] : (((k >> bit) & 1) ? ~0ULL : 0);
+        }
+        std::memcpy(&key[j], lanes, sizeof(V));
+    }
+}
+
+template <class V>
+SDES_INLINE void matchAllKeysImpl(const uint8_t *plains, const uint8_t *ciphers, std::size_t pairs,
+                                  uint64_t *mask) {
+    for (unsigned base = 0; base < 1024; base += unsigned(64 * LANES<V>)) {
+        V key[10], k1[8], k2[8];
+        keyIndexPlanes(base, key);
+        for (int j = 0; j < 8; j++) {
+            k1[j] = key[WIRING.k1[j]];
+            k2[j] = key[WIRING.k2[j]];
+        }
+        V match = ~V{};
+        for (std::size_t p = 0; p < pairs; p++) {
+            V b[8];
+            for (int j = 0; j < 8; j++) broadcast(b[j], ((plains[p] >> (7 - j)) & 1) ? ~0ULL : 0);
+            encryptPlanes(b, k1, k2);
+            for (int j = 0; j < 8; j++) match &= ((ciphers[p] >> (7 - j)) & 1) ? b[j] : ~b[j];
+        }
+        std::memcpy(mask + base / 64, &match, sizeof(V));
+    }
+}
+
+// --- Kernel instantiations ---
+struct KernelTable {
+    Kernel kind;
+    void (*blocks)(const uint8_t *, uint8_t *, std::size_t, RoundKeys);
+    void (*underKeys)(uint8_t, const uint16_t *, uint8_t *, std::size_t, bool);
+    void (*matchAll)(const uint8_t *, const uint8_t *, std::size_t, uint64_t *);
+};
+
+#define SDES_DEFINE_KERNEL(NAME, V, ATTR)                                                          \
+    ATTR inline void NAME##Blocks(const uint8_t *in, uint8_t *out, std::size_t n, RoundKeys keys) { \
+        encryptBlocksImpl<V>(in, out, n, keys);                                                    \
+    }                                                                                               \
+    ATTR inline void NAME##UnderKeys(uint8_t block, const uint16_t *keys, uint8_t *out,             \
+                                     std::size_t n, bool decrypt) {                                 \
+        encryptUnderKeysImpl<V>(block, keys, out, n, decrypt);                                      \
+    }                                                                                               \
+    ATTR inline void NAME##MatchAll(const uint8_t *plains, const uint8_t *ciphers,                  \
+                                    std::size_t pairs, uint64_t *mask) {                            \
+        matchAllKeysImpl<V>(plains, ciphers, pairs, mask);                                          \
+    }
+
+SDES_DEFINE_KERNEL(scalar64, uint64_t, )
+#if defined(__GNUC__)
+SDES_DEFINE_KERNEL(vector128, V128, )
+#endif
+#if defined(SDES_BITSLICE_X86)
+SDES_DEFINE_KERNEL(avx2, V256, __attribute__((target("avx2"))))
+SDES_DEFINE_KERNEL(avx512, V512, __attribute__((target("avx512f"))))
+#endif
+#undef SDES_DEFINE_KERNEL
+
+inline KernelTable kernelTable(Kernel k) {
+    switch (k) {
+#if defined(SDES_BITSLICE_X86)
+    case Kernel::AVX512: return {k, avx512Blocks, avx512UnderKeys, avx512MatchAll};
+    case Kernel::AVX2: return {k, avx2Blocks, avx2UnderKeys, avx2MatchAll};
+#endif
+#if defined(__GNUC__)
+    case Kernel::Vector128: return {k, vector128Blocks, vector128UnderKeys, vector128MatchAll};
+#endif
+    default: return {Kernel::Scalar64, scalar64Blocks, scalar64UnderKeys, scalar64MatchAll};
+    }
+}
+
+inline Kernel detectKernel() {
+#if defined(SDES_BITSLICE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return Kernel::AVX512;
+    if (__builtin_cpu_supports("avx2")) return Kernel::AVX2;
+#endif
+#if defined(__GNUC__)
+    return Kernel::Vector128;
+#else
+    return Kernel::Scalar64;
+#endif
+}
+
+inline KernelTable &active() {
+    static KernelTable table = kernelTable(detectKernel());
+    return table;
+}
+
+} // namespace detail
+
+inline Kernel activeKernel() { return detail::active().kind; }
+
+// Overrides runtime detection, e.g. to compare kernels. Not thread-safe.
+inline void selectKernel(Kernel k) { detail::active() = detail::kernelTable(k); }
+
+// Encrypts (or decrypts) n blocks under one key; `in` and `out` may alias.
+inline void encryptBlocks(const uint8_t *in, uint8_t *out, std::size_t n, uint16_t key, bool decrypt = false) {
+    RoundKeys keys = sdes_packed::generateKeys(key);
+    if (decrypt) keys = {keys.k2, keys.k1};
+    instrument::count(instrument::Counter::SdesBlocks, n);
+    detail::active().blocks(in, out, n, keys);
+}
+
+// Encrypts (or decrypts) one block under each of n keys.
+inline void encryptUnderKeys(uint8_t block, const uint16_t *keys, uint8_t *out, std::size_t n,
+                             bool decrypt = false) {
+    detail::active().underKeys(block, keys, out, n, decrypt);
+}
+
+// Sets bit (k % 64) of mask[k / 64] for every key k that maps each
+// plains[i] to ciphers[i]. mask must hold 16 words (1024 keys).
+inline void matchAllKeys(const uint8_t *plains, const uint8_t *ciphers, std::size_t pairs, uint64_t mask[16]) {
+    detail::active().matchAll(plains, ciphers, pairs, mask);
+}
+
+} // namespace sdes_bitslice
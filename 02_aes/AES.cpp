@@ -1,142 +1,366 @@
-#include <bits/stdc++.h>
-using namespace std;
-
-class SimplifiedAES {
-public:
-    static constexpr uint8_t sBox[16] = {
-        0x9, 0x4, 0xA, 0xB,
-        0xD, 0x1, 0x8, 0x5,
-        0x6, 0x2, 0x0, 0x3,
-        0xC, 0xE, 0xF, 0x7
-    };
+// To compile and run this code, open a terminal in this folder and run:
+// g++ -O2 -std=c++20 -pthread AES.cpp -o aes && ./aes
 
-    static constexpr uint8_t sBoxI[16] = {
-        0xA, 0x5, 0x9, 0xB,
-        0x1, 0x7, 0x8, 0xF,
-        0x6, 0x0, 0x2, 0x3,
-        0xC, 0x4, 0xD, 0xE
-    };
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "saes.hpp"
+#include "saes_modes.hpp"
+#include "saes_simd.hpp"
+using namespace std;
 
-    vector<uint8_t> preRoundKey, round1Key, round2Key;
+// --- Cross-check of the SIMD kernels against the round-by-round cipher ---
+vector<saes_simd::Kernel> supportedKernels() {
+    vector<saes_simd::Kernel> kernels{saes_simd::Kernel::Scalar};
+    saes_simd::Kernel best = saes_simd::activeKernel();
+    for (auto k : {saes_simd::Kernel::SSSE3, saes_simd::Kernel::AVX2, saes_simd::Kernel::AVX512BW,
+                   saes_simd::Kernel::NEON})
+        if (k <= best && k != saes_simd::Kernel::Scalar && saes_simd::detail::kernelTable(k).kind == k)
+            kernels.push_back(k);
+    return kernels;
+}
 
-    SimplifiedAES(uint16_t key) {
-        tie(preRoundKey, round1Key, round2Key) = keyExpansion(key);
+bool checkKernels() {
+    saes_simd::Kernel best = saes_simd::activeKernel();
+    const size_t N = 1 << 16; // every block, plus a ragged tail below
+    vector<uint16_t> blocks(N), enc(N), dec(N);
+    iota(blocks.begin(), blocks.end(), 0);
+    vector<uint8_t> bytes(2 * 1001), encBytes(bytes.size());
+    for (size_t i = 0; i < bytes.size(); i++) bytes[i] = uint8_t(i * 131 + 7);
+    bool ok = true;
+    for (auto k : supportedKernels()) {
+        saes_simd::selectKernel(k);
+        size_t failures = 0;
+        for (uint32_t key = 0; key < 65536; key += 251) {
+            SimplifiedAES saes{uint16_t(key)};
+            saes_simd::encryptWords(saes, blocks.data(), enc.data(), N);
+            saes_simd::decryptWords(saes, enc.data(), dec.data(), N);
+            for (size_t i = 0; i < N; i++)
+                if (enc[i] != saes.EncryptRounds(blocks[i]) || dec[i] != blocks[i]) failures++;
+            saes_simd::encryptBytes(saes, bytes.data(), encBytes.data(), bytes.size() / 2);
+            for (size_t i = 0; i < bytes.size(); i += 2) {
+                uint16_t p = uint16_t((bytes[i] << 8) | bytes[i + 1]);
+                if (uint16_t((encBytes[i] << 8) | encBytes[i + 1]) != saes.EncryptRounds(p)) failures++;
+            }
+            uint16_t iv = uint16_t(key * 7);
+            saes_simd::ctrBytes(saes, iv, bytes.data(), encBytes.data(), bytes.size() / 2);
+            for (size_t i = 0; i < bytes.size(); i += 2) {
+                uint16_t ks = saes.EncryptRounds(uint16_t(iv + i / 2));
+                if (uint16_t(((encBytes[i] ^ bytes[i]) << 8) | (encBytes[i + 1] ^ bytes[i + 1])) != ks) failures++;
+            }
+        }
+        cout << left << setw(34) << string("SIMD kernel ") + saes_simd::kernelName(k) << (failures ? "FAILED" : "ok")
+             << "\n";
+        ok = ok && failures == 0;
     }
+    saes_simd::selectKernel(best);
+    return ok;
+}
 
-    static uint8_t subWord(uint8_t word) {
-        return (sBox[(word >> 4)] << 4) | sBox[word & 0x0F];
+// --- Compile-time tables against the functions they were built from ---
+// GF(2^4) products, both MixColumns tables and each fused T-table round
+// over every one of the 65536 inputs.
+bool checkRoundTables() {
+    using S = SimplifiedAES;
+    const saes_tables::TTables &t = saes_tables::T;
+    for (int a = 0; a < 16; a++)
+        for (int b = 0; b < 16; b++)
+            if (S::gfMultTable(uint8_t(a), uint8_t(b)) != S::gfMult(uint8_t(a), uint8_t(b))) return false;
+    for (uint32_t v = 0; v < 65536; v++) {
+        uint16_t x = uint16_t(v);
+        unsigned hi = x >> 8, lo = x & 0xFF;
+        if (S::mixColumnsTable(x) != S::mixColumns(x) || S::inverseMixColumnsTable(x) != S::inverseMixColumns(x) ||
+            S::inverseMixColumns(S::mixColumns(x)) != x)
+            return false;
+        if ((t.encMidHi[hi] ^ t.encMidLo[lo]) != S::mixColumns(S::shiftRows(S::subNibbles(S::sBox, x))) ||
+            (t.encLastHi[hi] ^ t.encLastLo[lo]) != S::shiftRows(S::subNibbles(S::sBox, x)) ||
+            (t.decFirstHi[hi] ^ t.decFirstLo[lo]) != S::subNibbles(S::sBoxI, S::shiftRows(x)) ||
+            (t.decMidHi[hi] ^ t.decMidLo[lo]) != S::subNibbles(S::sBoxI, S::shiftRows(S::inverseMixColumns(x))))
+            return false;
     }
+    return true;
+}
 
-    static uint8_t rotWord(uint8_t word) {
-        return ((word & 0x0F) << 4) | ((word & 0xF0) >> 4);
+// --- The packed T-table cipher against the round-by-round reference ---
+// Every block for a sample of keys, including the textbook key 4AF5.
+bool checkTTables() {
+    vector<uint16_t> keys{0x4AF5};
+    for (uint32_t key = 0; key < 65536; key += 251) keys.push_back(uint16_t(key));
+    for (uint16_t k : keys) {
+        SimplifiedAES saes(k);
+        for (uint32_t b = 0; b < 65536; b++) {
+            uint16_t block = uint16_t(b);
+            uint16_t enc = saes.Encrypt(block), dec = saes.Decrypt(block);
+            if (enc != saes.EncryptRounds(block) || dec != saes.DecryptRounds(block) || saes.Decrypt(enc) != block) {
+                cout << "Mismatch: key=" << bitset<16>(k) << " block=" << bitset<16>(block)
+                     << " encrypt=" << bitset<16>(enc) << " decrypt=" << bitset<16>(dec) << "\n";
+                return false;
+            }
+        }
     }
+    return true;
+}
 
-    static tuple<vector<uint8_t>, vector<uint8_t>, vector<uint8_t>> keyExpansion(uint16_t key) {
-        uint8_t Rcon1 = 0x80;
-        uint8_t Rcon2 = 0x30;
-
-        uint8_t w[6];
-        w[0] = (key & 0xFF00) >> 8;
-        w[1] = key & 0x00FF;
-
-        w[2] = w[0] ^ (subWord(rotWord(w[1])) ^ Rcon1);
-        w[3] = w[2] ^ w[1];
-        w[4] = w[2] ^ (subWord(rotWord(w[3])) ^ Rcon2);
-        w[5] = w[4] ^ w[3];
+// --- Codebooks and their cache ---
+bool checkCodebooks() {
+    bool ok = true;
+    for (uint32_t key = 0; key < 65536 && ok; key += 4099) {
+        SimplifiedAES saes{uint16_t(key)}, withBook{uint16_t(key)};
+        auto book = make_unique<SaesCodebook>(uint16_t(key));
+        withBook.useCodebook(book.get());
+        for (uint32_t b = 0; b < SaesCodebook::BLOCKS && ok; b++) {
+            uint16_t block = uint16_t(b);
+            ok = book->forward[block] == saes.EncryptRounds(block) && book->inverse[block] == saes.DecryptRounds(block) &&
+                 withBook.Encrypt(block) == book->forward[block] && withBook.Decrypt(block) == book->inverse[block];
+        }
+    }
+    // A codebook for another key is refused and leaves the cipher as it was.
+    SimplifiedAES other(0x1234);
+    auto wrongKey = make_unique<SaesCodebook>(0x4321);
+    try {
+        other.useCodebook(wrongKey.get());
+        ok = false;
+    } catch (const invalid_argument &) {
+    }
+    return ok && other.attachedCodebook() == nullptr;
+}
 
-        auto k0 = intToState((w[0] << 8) + w[1]);
-        auto k1 = intToState((w[2] << 8) + w[3]);
-        auto k2 = intToState((w[4] << 8) + w[5]);
+// Two entries: the least recently used key goes first, and a codebook a
+// caller still holds survives its eviction.
+bool checkCodebookCache() {
+    bool rejected = false;
+    try {
+        SaesCodebookCache tooSmall(sizeof(SaesCodebook) - 1);
+    } catch (const invalid_argument &) {
+        rejected = true;
+    }
+    SaesCodebookCache cache(2 * sizeof(SaesCodebook) + 1);
+    auto one = cache.get(1), two = cache.get(2);
+    bool ok = rejected && cache.maxEntries() == 2 && cache.get(1) == one; // 2 is now the oldest
+    cache.get(3);                                                          // evicts 2
+    ok = ok && cache.size() == 2 && cache.get(1) == one && cache.hits() == 2 && cache.misses() == 3;
+    auto twoAgain = cache.get(2); // rebuilt, evicts 3
+    ok = ok && twoAgain != two && two->key == 2 && twoAgain->forward == two->forward && cache.misses() == 4;
+    ok = ok && cache.get(1) == one && cache.hits() == 3;
+    cache.get(3); // 2 is older than 1 again
+    return ok && cache.get(1) == one && cache.misses() == 5;
+}
 
-        return {k0, k1, k2};
+// --- Modes ---
+// CBC against the chain rebuilt from EncryptRounds. The first block with a
+// zero IV is the textbook vector: key 4AF5, D728 -> 24EC.
+bool checkCbc(const SimplifiedAES &saes) {
+    vector<uint8_t> plain(2 * 501), enc(plain.size()), dec(plain.size());
+    for (size_t i = 0; i < plain.size(); i++) plain[i] = uint8_t(i * 29 + 3);
+    plain[0] = 0xD7;
+    plain[1] = 0x28;
+    uint16_t last = saes_modes::cbcEncrypt(saes, 0, plain, enc);
+    bool ok = enc[0] == 0x24 && enc[1] == 0xEC;
+    uint16_t chain = 0;
+    for (size_t i = 0; i < plain.size() && ok; i += 2) {
+        chain = saes.EncryptRounds(saes_modes::loadBlock(&plain[i]) ^ chain);
+        ok = saes_modes::loadBlock(&enc[i]) == chain;
     }
+    ok = ok && last == chain && saes_modes::cbcDecrypt(saes, 0, enc, dec) == last && dec == plain;
+    // Split in two calls, the returned block carrying the chain across.
+    vector<uint8_t> split(plain.size());
+    span<const uint8_t> in(plain);
+    span<uint8_t> out(split);
+    uint16_t iv = saes_modes::cbcEncrypt(saes, 0, in.first(400), out.first(400));
+    saes_modes::cbcEncrypt(saes, iv, in.subspan(400), out.subspan(400));
+    return ok && split == enc;
+}
+
+// ECB, CTR and the block-array calls on the scalar kernel, where an attached
+// codebook takes over from the T-tables. The odd CTR length covers the tail byte.
+bool checkScalarModes(const SimplifiedAES &saes, ThreadPool &pool) {
+    saes_simd::Kernel best = saes_simd::activeKernel();
+    saes_simd::selectKernel(saes_simd::Kernel::Scalar);
+    const uint16_t iv = 0xFFF0; // wraps within the first few blocks
+    vector<uint8_t> plain(2 * (saes_modes::PARALLEL_GRAIN + 777) + 1), out(plain.size()), back(plain.size());
+    for (size_t i = 0; i < plain.size(); i++) plain[i] = uint8_t(i * 7 + (i >> 9));
+    bool ok = true;
+    for (ThreadPool *p : {static_cast<ThreadPool *>(nullptr), &pool}) {
+        span<const uint8_t> even(plain.data(), plain.size() - 1);
+        saes_modes::ecbEncrypt(saes, even, out, p);
+        for (size_t i = 0; i < even.size() && ok; i += 2)
+            ok = saes_modes::loadBlock(&out[i]) == saes.EncryptRounds(saes_modes::loadBlock(&plain[i]));
+        saes_modes::ecbDecrypt(saes, span<const uint8_t>(out.data(), even.size()), back, p);
+        ok = ok && equal(even.begin(), even.end(), back.begin());
 
-    static uint8_t gfMult(uint8_t a, uint8_t b) {
-        uint8_t product = 0;
-        a &= 0x0F;
-        b &= 0x0F;
-
-        while (b) {
-            if (b & 1)
-                product ^= a;
-            a <<= 1;
-            if (a & (1 << 4))
-                a ^= 0b10011;
-            b >>= 1;
+        saes_modes::ctr(saes, iv, plain, out, p);
+        for (size_t i = 0; i + 1 < plain.size() && ok; i += 2) {
+            uint16_t ks = saes.EncryptRounds(uint16_t(iv + i / 2));
+            ok = uint16_t(saes_modes::loadBlock(&out[i]) ^ saes_modes::loadBlock(&plain[i])) == ks;
         }
-        return product;
+        uint16_t lastKs = saes.EncryptRounds(uint16_t(iv + plain.size() / 2));
+        ok = ok && uint8_t(out.back() ^ plain.back()) == uint8_t(lastKs >> 8);
+        saes_modes::ctr(saes, iv, out, back, p);
+        ok = ok && back == plain;
     }
+    vector<uint16_t> blocks(1000), enc(blocks.size()), dec(blocks.size());
+    iota(blocks.begin(), blocks.end(), uint16_t(0xFE00));
+    saes_modes::encrypt(saes, blocks, enc);
+    saes_modes::decrypt(saes, enc, dec);
+    for (size_t i = 0; i < blocks.size() && ok; i++) ok = enc[i] == saes.EncryptRounds(blocks[i]);
+    saes_simd::selectKernel(best);
+    return ok && dec == blocks;
+}
 
-    static vector<uint8_t> intToState(uint16_t n) {
-        return {
-            uint8_t((n >> 12) & 0xF),
-            uint8_t((n >> 4) & 0xF),
-            uint8_t((n >> 8) & 0xF),
-            uint8_t(n & 0xF)
-        };
-    }
+bool selfTest() {
+    bool ok = true;
+    auto report = [&](const string &name, bool pass) {
+        cout << left << setw(34) << name << (pass ? "ok" : "FAILED") << "\n";
+        ok = ok && pass;
+    };
+    ok = checkKernels();
+    report("GF, MixColumns, T-table entries", checkRoundTables());
+    report("T-tables vs round functions", checkTTables());
+    report("codebooks vs round functions", checkCodebooks());
+    report("codebook cache, LRU eviction", checkCodebookCache());
 
-    static uint16_t stateToInt(const vector<uint8_t> &m) {
-        return (m[0] << 12) + (m[2] << 8) + (m[1] << 4) + m[3];
-    }
+    SimplifiedAES saes(0x4AF5), withBook(0x4AF5);
+    auto book = make_unique<SaesCodebook>(0x4AF5);
+    withBook.useCodebook(book.get());
+    ThreadPool pool(3);
+    report("CBC known answer and round trip", checkCbc(saes) && checkCbc(withBook));
+    report("scalar ECB/CTR, T-tables", checkScalarModes(saes, pool));
+    report("scalar ECB/CTR, codebook", checkScalarModes(withBook, pool));
+    return ok;
+}
 
-    static vector<uint8_t> addRoundKey(const vector<uint8_t> &s1, const vector<uint8_t> &s2) {
-        vector<uint8_t> res(4);
-        for (int i = 0; i < 4; i++)
-            res[i] = s1[i] ^ s2[i];
-        return res;
-    }
+// --- Throughput comparison ---
+template <class F>
+void benchRow(const string &name, size_t blocksPerCall, F &&f) {
+    size_t calls = 0;
+    auto start = chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        f();
+        calls++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.2);
+    cout << left << setw(28) << name << right << setw(14) << fixed << setprecision(0)
+         << calls * blocksPerCall / seconds << " blocks/s\n";
+}
 
-    static vector<uint8_t> subNibbles(const uint8_t sbox[16], const vector<uint8_t> &state) {
-        vector<uint8_t> res(4);
-        for (int i = 0; i < 4; i++)
-            res[i] = sbox[state[i]];
-        return res;
-    }
+template <class F>
+void benchBytes(const string &name, size_t bytesPerCall, F &&f) {
+    size_t calls = 0;
+    auto start = chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        f();
+        calls++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.5);
+    cout << left << setw(28) << name << right << setw(14) << fixed << setprecision(1)
+         << calls * bytesPerCall / seconds / 1e6 << " MB/s\n";
+}
 
-    static vector<uint8_t> shiftRows(const vector<uint8_t> &state) {
-        return {state[0], state[1], state[3], state[2]};
-    }
+void runBulkBench() {
+    const size_t BYTES = 64 << 20;
+    vector<uint8_t> buffer(BYTES, 0x5A), out(BYTES);
+    SimplifiedAES saes(0b0100101011110101), withBook(0b0100101011110101);
+    auto book = make_unique<SaesCodebook>(0b0100101011110101);
+    withBook.useCodebook(book.get());
+    ThreadPool pool;
 
-    static vector<uint8_t> mixColumns(const vector<uint8_t> &state) {
-        return {
-            uint8_t(state[0] ^ gfMult(4, state[2])),
-            uint8_t(state[1] ^ gfMult(4, state[3])),
-            uint8_t(state[2] ^ gfMult(4, state[0])),
-            uint8_t(state[3] ^ gfMult(4, state[1]))
-        };
+    saes_simd::Kernel best = saes_simd::activeKernel();
+    for (auto k : supportedKernels()) {
+        saes_simd::selectKernel(k);
+        benchBytes(string("ECB, kernel ") + saes_simd::kernelName(k), BYTES,
+                   [&] { saes_modes::ecbEncrypt(saes, buffer, out); });
+        benchBytes(string("CTR, kernel ") + saes_simd::kernelName(k), BYTES,
+                   [&] { saes_modes::ctr(saes, 0x1234, buffer, out); });
     }
+    saes_simd::selectKernel(best);
 
-    static vector<uint8_t> inverseMixColumns(const vector<uint8_t> &state) {
-        return {
-            uint8_t(gfMult(9, state[0]) ^ gfMult(2, state[2])),
-            uint8_t(gfMult(9, state[1]) ^ gfMult(2, state[3])),
-            uint8_t(gfMult(9, state[2]) ^ gfMult(2, state[0])),
-            uint8_t(gfMult(9, state[3]) ^ gfMult(2, state[1]))
-        };
+    cout << "-- modes on the " << saes_simd::kernelName(best) << " kernel --\n";
+    for (auto [label, cipher] : {pair<const char *, SimplifiedAES *>{"T-tables", &saes}, {"codebook", &withBook}}) {
+        string suffix = string(" (") + label + ")";
+        benchBytes("ECB" + suffix, BYTES, [&] { saes_modes::ecbEncrypt(*cipher, buffer, out); });
+        benchBytes("CBC encrypt" + suffix, BYTES, [&] { saes_modes::cbcEncrypt(*cipher, 0x1234, buffer, out); });
+        benchBytes("CBC decrypt" + suffix, BYTES, [&] { saes_modes::cbcDecrypt(*cipher, 0x1234, buffer, out); });
+        benchBytes("CTR, 1 thread" + suffix, BYTES, [&] { saes_modes::ctr(*cipher, 0x1234, buffer, out); });
+        benchBytes("CTR, pool of " + to_string(pool.size()) + suffix, BYTES,
+                   [&] { saes_modes::ctr(*cipher, 0x1234, buffer, out, &pool); });
     }
+}
 
-    uint16_t Encrypt(uint16_t plaintext) {
-        auto state = addRoundKey(preRoundKey, intToState(plaintext));
-        state = mixColumns(shiftRows(subNibbles(sBox, state)));
-        state = addRoundKey(round1Key, state);
-        state = shiftRows(subNibbles(sBox, state));
-        state = addRoundKey(round2Key, state);
-        return stateToInt(state);
-    }
+void runBench() {
+    const size_t N = 1 << 16;
+    vector<uint16_t> data(N), out(N);
+    for (size_t i = 0; i < N; i++) data[i] = uint16_t(i * 40503u + 11);
+    SimplifiedAES saes(0b0100101011110101);
 
-    uint16_t Decrypt(uint16_t ciphertext) {
-        auto state = addRoundKey(round2Key, intToState(ciphertext));
-        state = subNibbles(sBoxI, shiftRows(state));
-        state = inverseMixColumns(addRoundKey(round1Key, state));
-        state = subNibbles(sBoxI, shiftRows(state));
-        state = addRoundKey(preRoundKey, state);
-        return stateToInt(state);
+    benchRow("mixColumns (gfMult loop)", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = SimplifiedAES::mixColumns(data[i]);
+    });
+    benchRow("mixColumns (GF table)", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = SimplifiedAES::mixColumnsTable(data[i]);
+    });
+    benchRow("inverseMixColumns (loop)", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = SimplifiedAES::inverseMixColumns(data[i]);
+    });
+    benchRow("inverseMixColumns (table)", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = SimplifiedAES::inverseMixColumnsTable(data[i]);
+    });
+    benchRow("EncryptRounds", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = saes.EncryptRounds(data[i]);
+    });
+    benchRow("Encrypt (T-tables)", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = saes.Encrypt(data[i]);
+    });
+    {
+        auto book = make_unique<SaesCodebook>(0b0100101011110101);
+        SimplifiedAES withBook(0b0100101011110101);
+        withBook.useCodebook(book.get());
+        benchRow("Encrypt (codebook)", N, [&] {
+            for (size_t i = 0; i < N; i++) out[i] = withBook.Encrypt(data[i]);
+        });
+        benchRow("codebook gather loop", N, [&] { book->encrypt(data.data(), out.data(), N); });
+    }
+    benchRow("codebook build", SaesCodebook::BLOCKS, [&] {
+        auto book = make_unique<SaesCodebook>(out[0]);
+        out[0] = book->forward[1];
+    });
+    // Rotating over 8 keys: a cache that holds all of them never rebuilds,
+    // one that holds half of them misses on every call (LRU worst case).
+    for (size_t entries : {8, 4}) {
+        SaesCodebookCache cache(entries * sizeof(SaesCodebook));
+        uint16_t key = 0;
+        benchRow("LRU, 8 keys, " + to_string(entries) + " entries", N, [&] {
+            auto book = cache.get(uint16_t(key++ % 8));
+            book->encrypt(data.data(), out.data(), N);
+        });
     }
-};
+    benchRow("DecryptRounds", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = saes.DecryptRounds(data[i]);
+    });
+    benchRow("Decrypt (T-tables)", N, [&] {
+        for (size_t i = 0; i < N; i++) out[i] = saes.Decrypt(data[i]);
+    });
+}
 
+int main(int argc, char *argv[]) {
+    if (argc > 1 && string(argv[1]) == "--selftest") return selfTest() ? 0 : 1;
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        runBench();
+        runBulkBench();
+        return 0;
+    }
 
-int main() {
     uint16_t key = 0b0100101011110101;
     uint16_t plaintext = 0b1101011100101000;
 
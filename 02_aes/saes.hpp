@@ -0,0 +1,361 @@
+#pragma once
+
+/*
+ * Simplified AES (S-AES)
+ * ----------------------
+ * The state is the 16-bit block itself, nibbles N0 N1 N2 N3 from the most
+ * significant end. In the usual 2x2 column-major layout N0/N1 form the first
+ * column and N2/N3 the second, so each byte of the block is one column.
+ * Every round step is a constexpr function on a uint16_t and nothing here
+ * touches the heap.
+ *
+ * Encrypt()/Decrypt() use byte-indexed "T-tables" generated at compile time:
+ * SubNibbles, ShiftRows and MixColumns of a round fold into two lookups,
+ * one per input column, so a whole block is four lookups and three key
+ * XORs. EncryptRounds()/DecryptRounds() apply the round steps one at a time
+ * and are kept as the reference.
+ *
+ * Because the block is only 16 bits, the entire permutation for one key fits
+ * in a 128 KiB codebook (plus 128 KiB for the inverse). useCodebook() routes
+ * Encrypt()/Decrypt() through one, and SaesCodebookCache keeps a bounded
+ * LRU set of them for workloads that rotate between a few keys.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "../common/instrument.hpp"
+
+struct SaesCodebook;
+
+class SimplifiedAES {
+public:
+    static constexpr uint8_t sBox[16] = {
+        0x9, 0x4, 0xA, 0xB,
+        0xD, 0x1, 0x8, 0x5,
+        0x6, 0x2, 0x0, 0x3,
+        0xC, 0xE, 0xF, 0x7
+    };
+
+    static constexpr uint8_t sBoxI[16] = {
+        0xA, 0x5, 0x9, 0xB,
+        0x1, 0x7, 0x8, 0xF,
+        0x6, 0x0, 0x2, 0x3,
+        0xC, 0x4, 0xD, 0xE
+    };
+
+    uint16_t preRoundKey, round1Key, round2Key;
+
+    constexpr SimplifiedAES(uint16_t key) : preRoundKey(0), round1Key(0), round2Key(0) {
+        std::array<uint16_t, 3> keys = keyExpansion(key);
+        preRoundKey = keys[0];
+        round1Key = keys[1];
+        round2Key = keys[2];
+    }
+
+    static constexpr uint8_t subWord(uint8_t word) {
+        return uint8_t((sBox[(word >> 4)] << 4) | sBox[word & 0x0F]);
+    }
+
+    static constexpr uint8_t rotWord(uint8_t word) {
+        return uint8_t(((word & 0x0F) << 4) | ((word & 0xF0) >> 4));
+    }
+
+    static constexpr std::array<uint16_t, 3> keyExpansion(uint16_t key) {
+        uint8_t Rcon1 = 0x80;
+        uint8_t Rcon2 = 0x30;
+
+        uint8_t w[6] = {};
+        w[0] = uint8_t((key & 0xFF00) >> 8);
+        w[1] = uint8_t(key & 0x00FF);
+
+        w[2] = w[0] ^ (subWord(rotWord(w[1])) ^ Rcon1);
+        w[3] = w[2] ^ w[1];
+        w[4] = w[2] ^ (subWord(rotWord(w[3])) ^ Rcon2);
+        w[5] = w[4] ^ w[3];
+
+        return {uint16_t((w[0] << 8) | w[1]), uint16_t((w[2] << 8) | w[3]), uint16_t((w[4] << 8) | w[5])};
+    }
+
+    static constexpr uint8_t gfMult(uint8_t a, uint8_t b) {
+        uint8_t product = 0;
+        a &= 0x0F;
+        b &= 0x0F;
+
+        while (b) {
+            if (b & 1)
+                product ^= a;
+            a <<= 1;
+            if (a & (1 << 4))
+                a ^= 0b10011;
+            b >>= 1;
+        }
+        return product;
+    }
+
+    // Nibble i (0 = most significant) of a state.
+    static constexpr uint8_t nibble(uint16_t state, int i) {
+        return uint8_t((state >> (12 - 4 * i)) & 0xF);
+    }
+
+    static constexpr uint16_t fromNibbles(uint8_t n0, uint8_t n1, uint8_t n2, uint8_t n3) {
+        return uint16_t((n0 << 12) | (n1 << 8) | (n2 << 4) | n3);
+    }
+
+    static constexpr uint16_t addRoundKey(uint16_t s1, uint16_t s2) {
+        return s1 ^ s2;
+    }
+
+    static constexpr uint16_t subNibbles(const uint8_t sbox[16], uint16_t state) {
+        return fromNibbles(sbox[nibble(state, 0)], sbox[nibble(state, 1)], sbox[nibble(state, 2)],
+                           sbox[nibble(state, 3)]);
+    }
+
+    // Swaps the bottom row: N1 <-> N3.
+    static constexpr uint16_t shiftRows(uint16_t state) {
+        return uint16_t((state & 0xF0F0) | ((state >> 8) & 0x000F) | ((state << 8) & 0x0F00));
+    }
+
+    static constexpr uint16_t mixColumns(uint16_t state) {
+        uint8_t n0 = nibble(state, 0), n1 = nibble(state, 1), n2 = nibble(state, 2), n3 = nibble(state, 3);
+        return fromNibbles(n0 ^ gfMult(4, n1), n1 ^ gfMult(4, n0), n2 ^ gfMult(4, n3), n3 ^ gfMult(4, n2));
+    }
+
+    static constexpr uint16_t inverseMixColumns(uint16_t state) {
+        uint8_t n0 = nibble(state, 0), n1 = nibble(state, 1), n2 = nibble(state, 2), n3 = nibble(state, 3);
+        return fromNibbles(gfMult(9, n0) ^ gfMult(2, n1), gfMult(9, n1) ^ gfMult(2, n0),
+                           gfMult(9, n2) ^ gfMult(2, n3), gfMult(9, n3) ^ gfMult(2, n2));
+    }
+
+    // GF(2^4) product from the compile-time 16x16 table.
+    static constexpr uint8_t gfMultTable(uint8_t a, uint8_t b);
+
+    static constexpr uint16_t mixColumnsTable(uint16_t state);
+    static constexpr uint16_t inverseMixColumnsTable(uint16_t state);
+
+    // One codebook lookup when a codebook is attached, T-tables otherwise.
+    constexpr uint16_t Encrypt(uint16_t plaintext) const;
+    constexpr uint16_t Decrypt(uint16_t ciphertext) const;
+
+    constexpr uint16_t EncryptTables(uint16_t plaintext) const;
+    constexpr uint16_t DecryptTables(uint16_t ciphertext) const;
+
+    // Attaches a codebook built for the same key, or detaches with nullptr.
+    // The codebook is not owned and must outlive its use here. A codebook
+    // for another key throws std::invalid_argument.
+    void useCodebook(const SaesCodebook *book);
+    const SaesCodebook *attachedCodebook() const { return codebook; }
+
+    constexpr uint16_t EncryptRounds(uint16_t plaintext) const {
+        uint16_t state = addRoundKey(preRoundKey, plaintext);
+        state = mixColumns(shiftRows(subNibbles(sBox, state)));
+        state = addRoundKey(round1Key, state);
+        state = shiftRows(subNibbles(sBox, state));
+        state = addRoundKey(round2Key, state);
+        return state;
+    }
+
+    constexpr uint16_t DecryptRounds(uint16_t ciphertext) const {
+        uint16_t state = addRoundKey(round2Key, ciphertext);
+        state = subNibbles(sBoxI, shiftRows(state));
+        state = inverseMixColumns(addRoundKey(round1Key, state));
+        state = subNibbles(sBoxI, shiftRows(state));
+        state = addRoundKey(preRoundKey, state);
+        return state;
+    }
+
+private:
+    const SaesCodebook *codebook = nullptr;
+};
+
+// --- Compile-time tables ---
+namespace saes_tables {
+
+using GfTable = std::array<std::array<uint8_t, 16>, 16>;
+
+constexpr GfTable makeGfMultTable() {
+    GfTable table{};
+    for (int a = 0; a < 16; a++)
+        for (int b = 0; b < 16; b++)
+            table[a][b] = SimplifiedAES::gfMult(uint8_t(a), uint8_t(b));
+    return table;
+}
+
+inline constexpr GfTable GF_MULT = makeGfMultTable();
+
+// Each table maps one column (byte) of the round input to its share of the
+// round output; the two shares of a round are XORed together. The masks
+// keep only the nibbles a column lands in after ShiftRows.
+struct TTables {
+    std::array<uint16_t, 256> encMidHi, encMidLo;     // MC(SR(SN(x)))
+    std::array<uint16_t, 256> encLastHi, encLastLo;   // SR(SN(x))
+    std::array<uint16_t, 256> decFirstHi, decFirstLo; // SNI(SR(x))
+    std::array<uint16_t, 256> decMidHi, decMidLo;     // SNI(SR(IMC(x)))
+};
+
+constexpr TTables makeTTables() {
+    using S = SimplifiedAES;
+    TTables t{};
+    for (uint16_t v = 0; v < 256; v++) {
+        uint16_t hi = uint16_t(v << 8), lo = v;
+        t.encMidHi[v] = S::mixColumns(S::shiftRows(S::subNibbles(S::sBox, hi) & 0xFF00));
+        t.encMidLo[v] = S::mixColumns(S::shiftRows(S::subNibbles(S::sBox, lo) & 0x00FF));
+        t.encLastHi[v] = S::shiftRows(S::subNibbles(S::sBox, hi)) & 0xF00F;
+        t.encLastLo[v] = S::shiftRows(S::subNibbles(S::sBox, lo)) & 0x0FF0;
+        t.decFirstHi[v] = S::subNibbles(S::sBoxI, S::shiftRows(hi)) & 0xF00F;
+        t.decFirstLo[v] = S::subNibbles(S::sBoxI, S::shiftRows(lo)) & 0x0FF0;
+        t.decMidHi[v] = S::subNibbles(S::sBoxI, S::shiftRows(S::inverseMixColumns(hi))) & 0xF00F;
+        t.decMidLo[v] = S::subNibbles(S::sBoxI, S::shiftRows(S::inverseMixColumns(lo))) & 0x0FF0;
+    }
+    return t;
+}
+
+inline constexpr TTables T = makeTTables();
+
+} // namespace saes_tables
+
+constexpr uint8_t SimplifiedAES::gfMultTable(uint8_t a, uint8_t b) {
+    return saes_tables::GF_MULT[a & 0x0F][b & 0x0F];
+}
+
+constexpr uint16_t SimplifiedAES::mixColumnsTable(uint16_t state) {
+    uint8_t n0 = nibble(state, 0), n1 = nibble(state, 1), n2 = nibble(state, 2), n3 = nibble(state, 3);
+    return fromNibbles(n0 ^ gfMultTable(4, n1), n1 ^ gfMultTable(4, n0), n2 ^ gfMultTable(4, n3),
+                       n3 ^ gfMultTable(4, n2));
+}
+
+constexpr uint16_t SimplifiedAES::inverseMixColumnsTable(uint16_t state) {
+    uint8_t n0 = nibble(state, 0), n1 = nibble(state, 1), n2 = nibble(state, 2), n3 = nibble(state, 3);
+    return fromNibbles(gfMultTable(9, n0) ^ gfMultTable(2, n1), gfMultTable(9, n1) ^ gfMultTable(2, n0),
+                       gfMultTable(9, n2) ^ gfMultTable(2, n3), gfMultTable(9, n3) ^ gfMultTable(2, n2));
+}
+
+constexpr uint16_t SimplifiedAES::EncryptTables(uint16_t plaintext) const {
+    const saes_tables::TTables &t = saes_tables::T;
+    uint16_t state = plaintext ^ preRoundKey;
+    state = t.encMidHi[state >> 8] ^ t.encMidLo[state & 0xFF] ^ round1Key;
+    return t.encLastHi[state >> 8] ^ t.encLastLo[state & 0xFF] ^ round2Key;
+}
+
+constexpr uint16_t SimplifiedAES::DecryptTables(uint16_t ciphertext) const {
+    const saes_tables::TTables &t = saes_tables::T;
+    uint16_t state = ciphertext ^ round2Key;
+    state = (t.decFirstHi[state >> 8] ^ t.decFirstLo[state & 0xFF]) ^ round1Key;
+    return t.decMidHi[state >> 8] ^ t.decMidLo[state & 0xFF] ^ preRoundKey;
+}
+
+// --- Codebooks ---
+struct SaesCodebook {
+    static constexpr std::size_t BLOCKS = 1 << 16;
+
+    uint16_t key;
+    std::array<uint16_t, BLOCKS> forward;
+    std::array<uint16_t, BLOCKS> inverse;
+
+    explicit SaesCodebook(uint16_t key) : key(key) {
+        SimplifiedAES saes(key);
+        for (std::size_t p = 0; p < BLOCKS; p++) {
+            uint16_t c = saes.EncryptTables(uint16_t(p));
+            forward[p] = c;
+            inverse[c] = uint16_t(p);
+        }
+    }
+
+    // Gather loops over n blocks; `in` and `out` may alias.
+    void encrypt(const uint16_t *in, uint16_t *out, std::size_t n) const {
+        for (std::size_t i = 0; i < n; i++) out[i] = forward[in[i]];
+    }
+
+    void decrypt(const uint16_t *in, uint16_t *out, std::size_t n) const {
+        for (std::size_t i = 0; i < n; i++) out[i] = inverse[in[i]];
+    }
+};
+
+inline void SimplifiedAES::useCodebook(const SaesCodebook *book) {
+    if (book && book->key != preRoundKey) throw std::invalid_argument("S-AES: codebook was built for another key");
+    codebook = book;
+}
+
+constexpr uint16_t SimplifiedAES::Encrypt(uint16_t plaintext) const {
+    instrument::countConstexpr(instrument::Counter::SaesBlocks);
+    return codebook ? codebook->forward[plaintext] : EncryptTables(plaintext);
+}
+
+constexpr uint16_t SimplifiedAES::Decrypt(uint16_t ciphertext) const {
+    instrument::countConstexpr(instrument::Counter::SaesBlocks);
+    return codebook ? codebook->inverse[ciphertext] : DecryptTables(ciphertext);
+}
+
+// Thread-safe LRU cache of codebooks, bounded by total codebook memory.
+// maxBytes must hold at least one codebook. Evicted codebooks stay alive
+// for as long as a caller still holds them.
+class SaesCodebookCache {
+public:
+    explicit SaesCodebookCache(std::size_t maxBytes) : capacity(maxBytes / sizeof(SaesCodebook)) {
+        if (capacity == 0) throw std::invalid_argument("SaesCodebookCache: maxBytes is below one codebook");
+    }
+
+    // A miss builds the codebook outside the lock, so lookups of other keys
+    // do not wait behind it. Two threads missing on the same key both
+    // build, and the second one adopts the first one's codebook.
+    std::shared_ptr<const SaesCodebook> get(uint16_t key) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (Entry hit = find(key)) {
+                hitCount++;
+                return hit;
+            }
+            missCount++;
+        }
+        Entry book = std::make_shared<const SaesCodebook>(key);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (Entry raced = find(key)) return raced;
+        if (lru.size() >= capacity) {
+            index.erase(lru.back()->key);
+            lru.pop_back();
+        }
+        lru.push_front(std::move(book));
+        index[key] = lru.begin();
+        return lru.front();
+    }
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lru.size();
+    }
+
+    std::size_t maxEntries() const { return capacity; }
+    std::size_t hits() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hitCount;
+    }
+
+    std::size_t misses() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return missCount;
+    }
+
+private:
+    using Entry = std::shared_ptr<const SaesCodebook>;
+
+    // The cached codebook for key, moved to the front; null if absent. Caller holds the mutex.
+    Entry find(uint16_t key) {
+        auto it = index.find(key);
+        if (it == index.end()) return nullptr;
+        lru.splice(lru.begin(), lru, it->second);
+        return *it->second;
+    }
+
+    std::size_t capacity;
+    mutable std::mutex mutex;
+    std::list<Entry> lru; // most recently used first
+    std::unordered_map<uint16_t, std::list<Entry>::iterator> index;
+    std::size_t hitCount = 0, missCount = 0;
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+/*
+ * Bulk S-AES and modes of operation
+ * ---------------------------------
+ * Byte buffers are split into 16-bit blocks, most significant byte first,
+ * so the bytes D7 28 are the block 0xD728. ECB and CBC need an even number
+ * of bytes; CTR works on any length.
+ *
+ * The CTR counter is the 16-bit block itself, starting at the IV, so the
+ * keystream repeats every 128 KiB. That is inherent to a 16-bit block and
+ * fine for exercising the cipher, not for protecting data.
+ *
+ * ECB and CTR have no dependency between blocks and are spread across a
+ * ThreadPool in large chunks when one is passed in. Their inner loops, and
+ * the block-array functions, run on the SIMD kernel from saes_simd.hpp when
+ * the CPU has one; otherwise they use the codebook if one is attached, or
+ * the T-tables. CBC goes block by block.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include "saes.hpp"
+#include "saes_simd.hpp"
+#include "../common/instrument.hpp"
+#include "../common/thread_pool.hpp"
+
+namespace saes_modes {
+
+// Blocks per parallel work item: 512 KiB of data.
+inline constexpr std::size_t PARALLEL_GRAIN = 1 << 18;
+
+inline bool useSimd() { return saes_simd::activeKernel() != saes_simd::Kernel::Scalar; }
+
+inline uint16_t loadBlock(const uint8_t *p) { return uint16_t((p[0] << 8) | p[1]); }
+
+inline void storeBlock(uint8_t *p, uint16_t block) {
+    p[0] = uint8_t(block >> 8);
+    p[1] = uint8_t(block);
+}
+
+inline void checkSizes(std::size_t in, std::size_t out, bool wholeBlocks) {
+    if (out < in) throw std::invalid_argument("S-AES: output buffer is smaller than the input");
+    if (wholeBlocks && in % 2 != 0)
+        throw std::invalid_argument("S-AES: ECB/CBC input must be a whole number of 16-bit blocks");
+}
+
+// --- Block arrays ---
+inline void encrypt(const SimplifiedAES &saes, std::span<const uint16_t> in, std::span<uint16_t> out) {
+    checkSizes(in.size(), out.size(), false);
+    if (useSimd()) {
+        saes_simd::encryptWords(saes, in.data(), out.data(), in.size());
+    } else if (const SaesCodebook *book = saes.attachedCodebook()) {
+        book->encrypt(in.data(), out.data(), in.size());
+    } else {
+        for (std::size_t i = 0; i < in.size(); i++) out[i] = saes.EncryptTables(in[i]);
+    }
+}
+
+inline void decrypt(const SimplifiedAES &saes, std::span<const uint16_t> in, std::span<uint16_t> out) {
+    checkSizes(in.size(), out.size(), false);
+    if (useSimd()) {
+        saes_simd::decryptWords(saes, in.data(), out.data(), in.size());
+    } else if (const SaesCodebook *book = saes.attachedCodebook()) {
+        book->decrypt(in.data(), out.data(), in.size());
+    } else {
+        for (std::size_t i = 0; i < in.size(); i++) out[i] = saes.DecryptTables(in[i]);
+    }
+}
+
+// --- ECB ---
+inline void ecbBlocks(const SimplifiedAES &saes, const uint8_t *in, uint8_t *out, std::size_t blocks, bool decrypting) {
+    if (useSimd()) {
+        if (decrypting) saes_simd::decryptBytes(saes, in, out, blocks);
+        else saes_simd::encryptBytes(saes, in, out, blocks);
+        return;
+    }
+    for (std::size_t i = 0; i < blocks; i++) {
+        uint16_t b = loadBlock(in + 2 * i);
+        storeBlock(out + 2 * i, decrypting ? saes.Decrypt(b) : saes.Encrypt(b));
+    }
+}
+
+inline void ecb(const SimplifiedAES &saes, std::span<const uint8_t> in, std::span<uint8_t> out, bool decrypting,
+                ThreadPool *pool = nullptr) {
+    checkSizes(in.size(), out.size(), true);
+    instrument::Scope timer(instrument::Probe::SaesMode);
+    instrument::count(instrument::Counter::SaesBytes, in.size());
+    std::size_t blocks = in.size() / 2;
+    if (!pool) {
+        ecbBlocks(saes, in.data(), out.data(), blocks, decrypting);
+        return;
+    }
+    pool->parallelFor(blocks, PARALLEL_GRAIN, [&](std::size_t begin, std::size_t end, unsigned) {
+        ecbBlocks(saes, in.data() + 2 * begin, out.data() + 2 * begin, end - begin, decrypting);
+    });
+}
+
+inline void ecbEncrypt(const SimplifiedAES &saes, std::span<const uint8_t> in, std::span<uint8_t> out,
+                       ThreadPool *pool = nullptr) {
+    ecb(saes, in, out, false, pool);
+}
+
+inline void ecbDecrypt(const SimplifiedAES &saes, std::span<const uint8_t> in, std::span<uint8_t> out,
+                       ThreadPool *pool = nullptr) {
+    ecb(saes, in, out, true, pool);
+}
+
+// --- CBC ---
+// Returns the last ciphertext block, which is the IV for a following call.
+inline uint16_t cbcEncrypt(const SimplifiedAES &saes, uint16_t iv, std::span<const uint8_t> in, std::span<uint8_t> out) {
+    checkSizes(in.size(), out.size(), true);
+    instrument::Scope timer(instrument::Probe::SaesMode);
+    instrument::count(instrument::Counter::SaesBytes, in.size());
+    uint16_t chain = iv;
+    for (std::size_t i = 0; i < in.size(); i += 2) {
+        chain = saes.Encrypt(loadBlock(&in[i]) ^ chain);
+        storeBlock(&out[i], chain);
+    }
+    return chain;
+}
+
+inline uint16_t cbcDecrypt(const SimplifiedAES &saes, uint16_t iv, std::span<const uint8_t> in, std::span<uint8_t> out) {
+    checkSizes(in.size(), out.size(), true);
+    instrument::Scope timer(instrument::Probe::SaesMode);
+    instrument::count(instrument::Counter::SaesBytes, in.size());
+    uint16_t chain = iv;
+    for (std::size_t i = 0; i < in.size(); i += 2) {
+        uint16_t c = loadBlock(&in[i]);
+        storeBlock(&out[i], saes.Decrypt(c) ^ chain);
+        chain = c;
+    }
+    return chain;
+}
+
+// --- CTR ---
+// XORs `bytes` bytes with the keystream starting at block counter `counter`.
+inline void ctrRange(const SimplifiedAES &saes, uint16_t counter, const uint8_t *in, uint8_t *out, std::size_t bytes) {
+    const SaesCodebook *book = saes.attachedCodebook();
+    std::size_t i = 0;
+    if (useSimd()) {
+        std::size_t blocks = bytes / 2;
+        saes_simd::ctrBytes(saes, counter, in, out, blocks);
+        i = 2 * blocks;
+        counter = uint16_t(counter + blocks);
+    }
+    for (; i + 2 <= bytes; i += 2, counter++) {
+        uint16_t ks = book ? book->forward[counter] : saes.EncryptTables(counter);
+        storeBlock(out + i, loadBlock(in + i) ^ ks);
+    }
+    if (i < bytes) out[i] = in[i] ^ uint8_t(saes.Encrypt(counter) >> 8);
+}
+
+// CTR is its own inverse. `in` and `out` may alias.
+inline void ctr(const SimplifiedAES &saes, uint16_t iv, std::span<const uint8_t> in, std::span<uint8_t> out,
+                ThreadPool *pool = nullptr) {
+    checkSizes(in.size(), out.size(), false);
+    instrument::Scope timer(instrument::Probe::SaesMode);
+    instrument::count(instrument::Counter::SaesBytes, in.size());
+    if (!pool) {
+        ctrRange(saes, iv, in.data(), out.data(), in.size());
+        return;
+    }
+    std::size_t blocks = (in.size() + 1) / 2;
+    pool->parallelFor(blocks, PARALLEL_GRAIN, [&](std::size_t begin, std::size_t end, unsigned) {
+        std::size_t first = 2 * begin, last = std::min(in.size(), 2 * end);
+        ctrRange(saes, uint16_t(iv + begin), in.data() + first, out.data() + first, last - first);
+    });
+}
+
+} // namespace saes_modes
@@ -0,0 +1,282 @@
+#pragma once
+
+/*
+ * SIMD S-AES kernels
+ * ------------------
+ * The S-AES S-box and the GF(2^4) multiply-by-constant steps are all
+ * 16-entry nibble tables, which is exactly what a byte shuffle looks up:
+ * PSHUFB on x86, TBL on AArch64. One vector holds 8 (SSSE3, NEON),
+ * 16 (AVX2) or 32 (AVX-512BW) blocks. The round kernel is written once in
+ * saes_simd_kernel.inc and compiled per instruction set; the best one the
+ * CPU supports is chosen at runtime, with the scalar class as fallback.
+ *
+ * Blocks are processed as byte pairs in memory. The cipher steps do not
+ * care which byte of a block comes first, only the round keys do, so the
+ * same kernel serves big-endian byte streams (saes_modes) and native
+ * uint16_t arrays.
+ */
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "saes.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SAES_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define SAES_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace saes_simd {
+
+enum class Kernel { Scalar, SSSE3, AVX2, AVX512BW, NEON };
+
+inline const char *kernelName(Kernel k) {
+    switch (k) {
+    case Kernel::Scalar: return "scalar";
+    case Kernel::SSSE3: return "ssse3";
+    case Kernel::AVX2: return "avx2";
+    case Kernel::AVX512BW: return "avx512bw";
+    case Kernel::NEON: return "neon";
+    }
+    return "?";
+}
+
+// Round keys as the 16-bit value a little-endian load of one block sees.
+struct LaneKeys {
+    uint16_t k0, k1, k2;
+};
+
+inline LaneKeys laneKeys(const SimplifiedAES &saes, bool bigEndianBytes) {
+    bool swap = bigEndianBytes == (std::endian::native == std::endian::little);
+    auto lane = [swap](uint16_t k) { return swap ? uint16_t((k << 8) | (k >> 8)) : k; };
+    return {lane(saes.preRoundKey), lane(saes.round1Key), lane(saes.round2Key)};
+}
+
+#if defined(SAES_SIMD_X86)
+
+#if defined(__clang__)
+#define SAES_TARGET_BEGIN(T) _Pragma("clang attribute push(__attribute__((target(" #T "))), apply_to = function)")
+#define SAES_TARGET_END _Pragma("clang attribute pop")
+#else
+#define SAES_TARGET_PRAGMA(X) _Pragma(#X)
+#define SAES_TARGET_BEGIN(T) _Pragma("GCC push_options") SAES_TARGET_PRAGMA(GCC target(T))
+#define SAES_TARGET_END _Pragma("GCC pop_options")
+#endif
+
+SAES_TARGET_BEGIN("ssse3")
+namespace ssse3 {
+struct Ops {
+    using V = __m128i;
+    static constexpr std::size_t BYTES = 16;
+    static V load(const uint8_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+    static void store(uint8_t *p, V v) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v); }
+    static V table(const uint8_t *t) { return load(t); }
+    static V set1(uint8_t b) { return _mm_set1_epi8(char(b)); }
+    static V lanes16(uint16_t w) { return _mm_set1_epi16(short(w)); }
+    static V andv(V a, V b) { return _mm_and_si128(a, b); }
+    static V orv(V a, V b) { return _mm_or_si128(a, b); }
+    static V xorv(V a, V b) { return _mm_xor_si128(a, b); }
+    static V shr4(V x) { return _mm_srli_epi16(x, 4); }
+    static V shl4(V x) { return _mm_slli_epi16(x, 4); } // bytes hold nibbles, nothing crosses a byte
+    static V swapPairs(V x) { return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)); }
+    static V lookup(V t, V idx) { return _mm_shuffle_epi8(t, idx); }
+    static V add16(V a, V b) { return _mm_add_epi16(a, b); }
+};
+#include "saes_simd_kernel.inc"
+} // namespace ssse3
+SAES_TARGET_END
+
+SAES_TARGET_BEGIN("avx2")
+namespace avx2 {
+struct Ops {
+    using V = __m256i;
+    static constexpr std::size_t BYTES = 32;
+    static V load(const uint8_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+    static void store(uint8_t *p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+    static V table(const uint8_t *t) {
+        return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(t)));
+    }
+    static V set1(uint8_t b) { return _mm256_set1_epi8(char(b)); }
+    static V lanes16(uint16_t w) { return _mm256_set1_epi16(short(w)); }
+    static V andv(V a, V b) { return _mm256_and_si256(a, b); }
+    static V orv(V a, V b) { return _mm256_or_si256(a, b); }
+    static V xorv(V a, V b) { return _mm256_xor_si256(a, b); }
+    static V shr4(V x) { return _mm256_srli_epi16(x, 4); }
+    static V shl4(V x) { return _mm256_slli_epi16(x, 4); }
+    static V swapPairs(V x) { return _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8)); }
+    static V lookup(V t, V idx) { return _mm256_shuffle_epi8(t, idx); }
+    static V add16(V a, V b) { return _mm256_add_epi16(a, b); }
+};
+#include "saes_simd_kernel.inc"
+} // namespace avx2
+SAES_TARGET_END
+
+SAES_TARGET_BEGIN("avx512f,avx512bw")
+namespace avx512bw {
+struct Ops {
+    using V = __m512i;
+    static constexpr std::size_t BYTES = 64;
+    static V load(const uint8_t *p) { return _mm512_loadu_si512(p); }
+    static void store(uint8_t *p, V v) { _mm512_storeu_si512(p, v); }
+    static V table(const uint8_t *t) {
+        alignas(64) uint8_t wide[64];
+        for (int i = 0; i < 4; i++) std::memcpy(wide + 16 * i, t, 16);
+        return _mm512_load_si512(wide);
+    }
+    static V set1(uint8_t b) { return _mm512_set1_epi8(char(b)); }
+    static V lanes16(uint16_t w) { return _mm512_set1_epi16(short(w)); }
+    static V andv(V a, V b) { return _mm512_and_si512(a, b); }
+    static V orv(V a, V b) { return _mm512_or_si512(a, b); }
+    static V xorv(V a, V b) { return _mm512_xor_si512(a, b); }
+    static V shr4(V x) { return _mm512_srli_epi16(x, 4); }
+    static V shl4(V x) { return _mm512_slli_epi16(x, 4); }
+    static V swapPairs(V x) { return _mm512_or_si512(_mm512_slli_epi16(x, 8), _mm512_srli_epi16(x, 8)); }
+    static V lookup(V t, V idx) { return _mm512_shuffle_epi8(t, idx); }
+    static V add16(V a, V b) { return _mm512_add_epi16(a, b); }
+};
+#include "saes_simd_kernel.inc"
+} // namespace avx512bw
+SAES_TARGET_END
+
+#undef SAES_TARGET_BEGIN
+#undef SAES_TARGET_END
+
+#elif defined(SAES_SIMD_NEON)
+
+namespace neon {
+struct Ops {
+    using V = uint8x16_t;
+    static constexpr std::size_t BYTES = 16;
+    static V load(const uint8_t *p) { return vld1q_u8(p); }
+    static void store(uint8_t *p, V v) { vst1q_u8(p, v); }
+    static V table(const uint8_t *t) { return vld1q_u8(t); }
+    static V set1(uint8_t b) { return vdupq_n_u8(b); }
+    static V lanes16(uint16_t w) { return vreinterpretq_u8_u16(vdupq_n_u16(w)); }
+    static V andv(V a, V b) { return vandq_u8(a, b); }
+    static V orv(V a, V b) { return vorrq_u8(a, b); }
+    static V xorv(V a, V b) { return veorq_u8(a, b); }
+    static V shr4(V x) { return vshrq_n_u8(x, 4); }
+    static V shl4(V x) { return vshlq_n_u8(x, 4); }
+    static V swapPairs(V x) { return vrev16q_u8(x); }
+    static V lookup(V t, V idx) { return vqtbl1q_u8(t, idx); }
+    static V add16(V a, V b) { return vreinterpretq_u8_u16(vaddq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b))); }
+};
+#include "saes_simd_kernel.inc"
+} // namespace neon
+
+#endif
+
+namespace detail {
+
+using BlockFn = std::size_t (*)(const uint8_t *, uint8_t *, std::size_t, LaneKeys);
+using CtrFn = std::size_t (*)(uint16_t, const uint8_t *, uint8_t *, std::size_t, LaneKeys);
+
+struct KernelTable {
+    Kernel kind;
+    BlockFn encrypt, decrypt;
+    CtrFn ctr;
+};
+
+inline KernelTable kernelTable(Kernel k) {
+    switch (k) {
+#if defined(SAES_SIMD_X86)
+    case Kernel::AVX512BW: return {k, avx512bw::encryptBlocks, avx512bw::decryptBlocks, avx512bw::ctrBlocks};
+    case Kernel::AVX2: return {k, avx2::encryptBlocks, avx2::decryptBlocks, avx2::ctrBlocks};
+    case Kernel::SSSE3: return {k, ssse3::encryptBlocks, ssse3::decryptBlocks, ssse3::ctrBlocks};
+#elif defined(SAES_SIMD_NEON)
+    case Kernel::NEON: return {k, neon::encryptBlocks, neon::decryptBlocks, neon::ctrBlocks};
+#endif
+    default: return {Kernel::Scalar, nullptr, nullptr, nullptr};
+    }
+}
+
+inline Kernel detectKernel() {
+#if defined(SAES_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) return Kernel::AVX512BW;
+    if (__builtin_cpu_supports("avx2")) return Kernel::AVX2;
+    if (__builtin_cpu_supports("ssse3")) return Kernel::SSSE3;
+    return Kernel::Scalar;
+#elif defined(SAES_SIMD_NEON)
+    return Kernel::NEON;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+inline KernelTable &active() {
+    static KernelTable table = kernelTable(detectKernel());
+    return table;
+}
+
+inline void scalarBytes(const SimplifiedAES &saes, const uint8_t *in, uint8_t *out, std::size_t blocks,
+                        bool decrypting) {
+    for (std::size_t i = 0; i < blocks; i++) {
+        uint16_t b = uint16_t((in[2 * i] << 8) | in[2 * i + 1]);
+        b = decrypting ? saes.Decrypt(b) : saes.Encrypt(b);
+        out[2 * i] = uint8_t(b >> 8);
+        out[2 * i + 1] = uint8_t(b);
+    }
+}
+
+inline void scalarWords(const SimplifiedAES &saes, const uint16_t *in, uint16_t *out, std::size_t blocks,
+                        bool decrypting) {
+    for (std::size_t i = 0; i < blocks; i++) out[i] = decrypting ? saes.Decrypt(in[i]) : saes.Encrypt(in[i]);
+}
+
+} // namespace detail
+
+inline Kernel activeKernel() { return detail::active().kind; }
+
+// Overrides runtime detection, e.g. to compare kernels. Not thread-safe.
+inline void selectKernel(Kernel k) { detail::active() = detail::kernelTable(k); }
+
+// Blocks stored as big-endian byte pairs; `in` and `out` may alias.
+inline void encryptBytes(const SimplifiedAES &saes, const uint8_t *in, uint8_t *out, std::size_t blocks) {
+    std::size_t done = 0;
+    if (detail::active().encrypt) done = detail::active().encrypt(in, out, blocks, laneKeys(saes, true));
+    detail::scalarBytes(saes, in + 2 * done, out + 2 * done, blocks - done, false);
+}
+
+inline void decryptBytes(const SimplifiedAES &saes, const uint8_t *in, uint8_t *out, std::size_t blocks) {
+    std::size_t done = 0;
+    if (detail::active().decrypt) done = detail::active().decrypt(in, out, blocks, laneKeys(saes, true));
+    detail::scalarBytes(saes, in + 2 * done, out + 2 * done, blocks - done, true);
+}
+
+// XORs the CTR keystream for `blocks` big-endian blocks starting at `counter`.
+inline void ctrBytes(const SimplifiedAES &saes, uint16_t counter, const uint8_t *in, uint8_t *out,
+                     std::size_t blocks) {
+    std::size_t done = 0;
+    if (detail::active().ctr && std::endian::native == std::endian::little)
+        done = detail::active().ctr(counter, in, out, blocks, laneKeys(saes, true));
+    for (std::size_t i = done; i < blocks; i++) {
+        uint16_t ks = saes.Encrypt(uint16_t(counter + i));
+        out[2 * i] = uint8_t(in[2 * i] ^ (ks >> 8));
+        out[2 * i + 1] = uint8_t(in[2 * i + 1] ^ ks);
+    }
+}
+
+// Blocks stored as native uint16_t values.
+inline void encryptWords(const SimplifiedAES &saes, const uint16_t *in, uint16_t *out, std::size_t blocks) {
+    std::size_t done = 0;
+    if (detail::active().encrypt)
+        done = detail::active().encrypt(reinterpret_cast<const uint8_t *>(in), reinterpret_cast<uint8_t *>(out),
+                                        blocks, laneKeys(saes, false));
+    detail::scalarWords(saes, in + done, out + done, blocks - done, false);
+}
+
+inline void decryptWords(const SimplifiedAES &saes, const uint16_t *in, uint16_t *out, std::size_t blocks) {
+    std::size_t done = 0;
+    if (detail::active().decrypt)
+        done = detail::active().decrypt(reinterpret_cast<const uint8_t *>(in), reinterpret_cast<uint8_t *>(out),
+                                        blocks, laneKeys(saes, false));
+    detail::scalarWords(saes, in + done, out + done, blocks - done, true);
+}
+
+} // namespace saes_simd
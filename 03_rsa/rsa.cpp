@@ -1,65 +1,367 @@
+// To compile and run this code, open a terminal in this folder and run:
+// g++ -O2 -std=c++17 -pthread rsa.cpp -o rsa && ./rsa
+
 #include <iostream>
-#include <cmath>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "rsa.hpp"
+#include "rsa_keygen.hpp"
+#include "../common/bignum_tune.hpp"
 using namespace std;
 
-// Function to calculate GCD (Greatest Common Divisor)
-long long gcd(long long a, long long h) {
-    while (h != 0) {
-        long long temp = h;
-        h = a % h;
-        a = temp;
+// --- Known-answer test: a 2048-bit key with e = 65537 ---
+const char *KAT_N =
+    "e09de1969bdc13d98d264d27e151fde40d56608451b456ecdc46d2454d7e6a2b3460143f624c0e342d42f6eb7933070208f517cff9733df3"
+    "18c7225f32ec4f176ea86f5093603dc00e54016cf4c7d6ae118ccc3bbecb20636da93c1556bc9f4702a5b9814484ccf110da6fa29fa4f530"
+    "b314d117e4b8678d0a8104927b2f85a5a5ba3337ff28ff947759c47d5946dd4fe02f0a67414a59019971f4cf3187745d47e1d54bf7df39f6"
+    "2caf52398b60d123455b8b1695ea9221f8cd8a870f7420e03a4a20ab60a6e67106cec9d5a116907fc8e83ba805e26a28cd7f231b3ba204fa"
+    "5b8dc8c61904c2eda05ec0cf0e28f6a7b3a164ba5573d74fc6453051392a6623";
+const char *KAT_D =
+    "2237eb260698806da41331ade1a59c08220006b421be577fbe0f0bf982d4bf57d5a2cd72da86bba33741fc5be31ae2f66c66ea39c4c6c9a9"
+    "3f1d171f69a29669fb71ad8398f0107831b69a80fec972eb11c1615bb8b53939ec7adbac648a57b979adc594ebdb4f5d6a33dccde98437d6"
+    "3371f868ab6f6c571042976fb95484076f274724763a462e174314b4a0c64a6032141dd2be502a423f9a5fcc4d8d3487859d2229a19115f6"
+    "a94cf510b4957323fe7acb29f32176ae61b4015fc183ff4aefe60d92f359fe2f341e4fca9e2d491091779bca65761a726e9b00f68862e1bb"
+    "c43d0e07ae927a1da84de2e6c5cf176a83c443c058a06bcb0f11ae5b8c50701";
+const char *KAT_M =
+    "532d414553206973206120746f792c20746869732069732061206b6e6f776e2d616e73776572207465737420766563746f7220666f722052"
+    "53412d323034382e532d414553206973206120746f792c20746869732069732061206b6e6f776e2d616e73776572207465737420766563"
+    "746f7220666f72205253412d323034382e532d414553206973206120746f792c20746869732069732061206b6e6f776e2d616e73776572"
+    "207465737420766563746f7220666f72205253412d323034382e";
+const char *KAT_C =
+    "8bcece9a750d62c3086d20395792e347bfb2aac9695b09848b4b914bac6e440757a462b00894ca8abe2f09df3e1f67a876d9149a7f0742a4"
+    "c5d47b9722727f329338a34773b6c42e4ad8b7dc61d001a298b7157055feddc2bb8a79e3bb845201eb6e1e9945db7b1cfe4fe3a2d066ef7d"
+    "b05dc284ba063e5929b257ef070f08109d7367b0f70c1fffc23f9f52efbd041a14ba9bf8cff777cf9016e8322aed4f3cba543bd7e3f6cc87"
+    "98e0903d4d15f45b22191af08b00a63f5cb995abd7f3aac2204e0f27e5ab392e517dec9ced3d8bd822d4209579f5c91ff2043bd45649655c"
+    "b730dd8f984a6503161bd3b4d842189258a3bed04892df3169aa5677934bd105";
+
+const char *KAT_P =
+    "eddfb58038728036c3fd8e560ed288afb2f7560baaaa15e0401a66b4381255b4a32607d3549637c64df3dbb80056455109999ab7c64701e8"
+    "fe948e9a5f80114fa739b95d3d810e5a0cb0597ff1c9531386ae8277bdbb11e969309f837fa097d771b16e3bf8a54904f60a3fc14860ec7a"
+    "7329eb86181772c19078260be93f4ae9";
+const char *KAT_Q =
+    "f1bb8f77d7f9df26cab6fb4a05a960c45ebf807d5417044c955377c7c2a64c1375d852388ace261746062be63802f6a7ef7b20a8b372e6ca"
+    "674a22cd6f095f9791ced3cad4de028546e68b2ec3339e4c661e4e787472d591360372bb98e472ea251f2ad40f4abd99037851c13dd60f43"
+    "8778ebf5272ff8c62303428c034da92b";
+
+RsaKey<32> katKey() {
+    using Int = bignum::BigInt<32>;
+    using Half = bignum::BigInt<16>;
+    return RsaKey<32>::withCrt(Int::fromHex(KAT_N), Int(65537), Int::fromHex(KAT_D), Half::fromHex(KAT_P),
+                               Half::fromHex(KAT_Q));
+}
+
+template <size_t L>
+bignum::BigInt<L> randomBelow(const bignum::BigInt<L> &n, mt19937_64 &rng) {
+    bignum::BigInt<L> v;
+    do {
+        for (auto &w : v.limb) w = rng();
+        size_t top = n.bitLength();
+        for (size_t i = top; i < v.BITS; i++) v.limb[i / 64] &= ~(uint64_t(1) << (i % 64));
+    } while (v >= n);
+    return v;
+}
+
+// a * b mod n by shift-and-add: slow, but shares no code with Montgomery.
+template <size_t L>
+bignum::BigInt<L> mulModSlow(const bignum::BigInt<L> &a, const bignum::BigInt<L> &b, const bignum::BigInt<L> &n) {
+    bignum::BigInt<L> r;
+    for (size_t i = b.bitLength(); i-- > 0;) {
+        if (r.shiftLeft1() || r >= n) r.sub(n);
+        if (b.bit(i) && (r.add(a) || r >= n)) r.sub(n);
     }
-    return a;
+    return r;
 }
 
-int main() {
-    // Prime numbers
-    long long p = 3;
-    long long q = 7;
+template <size_t L>
+bool checkAgainstSlow(mt19937_64 &rng) {
+    bignum::BigInt<L> n;
+    for (auto &w : n.limb) w = rng();
+    n.limb[0] |= 1;
+    n.limb[L - 1] |= uint64_t(1) << 63;
+    bignum::Montgomery<L> mont(n);
+    for (int t = 0; t < 4; t++) {
+        auto base = randomBelow(n, rng);
+        bignum::BigInt<1> exp(rng() >> (t * 16)); // short exponents keep the reference fast
+        bignum::BigInt<L> expect(1);
+        for (size_t i = exp.bitLength(); i-- > 0;) {
+            expect = mulModSlow(expect, expect, n);
+            if (exp.bit(i)) expect = mulModSlow(expect, base, n);
+        }
+        if (mont.modexp(base, exp) != expect) return false;
+        if (mont.modexp(base, exp, bignum::ExpMode::ConstantTime) != expect) return false;
+    }
+    return true;
+}
 
-    // Public key exponent and multiplier
-    long long e = 2;
-    long long k = 2;
+// Karatsuba at the smallest threshold against schoolbook, products and Montgomery squares.
+template <size_t L>
+bool checkKaratsuba(mt19937_64 &rng) {
+    bignum::BigInt<L> n, a, b;
+    for (auto &w : n.limb) w = rng();
+    n.limb[0] |= 1;
+    bignum::Montgomery<L> mont(n);
+    bignum::MulThresholds saved = bignum::mulThresholds(), never, eager;
+    never.karatsubaMul = never.karatsubaSqr = never.montgomeryMul = bignum::MulThresholds::NEVER;
+    eager.karatsubaMul = eager.karatsubaSqr = eager.montgomeryMul = 4;
+    bool ok = true;
+    for (int t = 0; t < 8 && ok; t++) {
+        a = randomBelow(n, rng);
+        b = t == 0 ? a : randomBelow(n, rng);
+        if (t == 1) { // n - 1, the largest operand
+            b = n;
+            b.sub(bignum::BigInt<L>(1));
+            a = b;
+        }
+        bignum::mulThresholds() = never;
+        auto wide = bignum::mulWide(a, b);
+        auto prod = mont.mul(a, b), sq = mont.sqr(a);
+        bignum::mulThresholds() = eager;
+        ok = bignum::mulWide(a, b) == wide && mont.mul(a, b) == prod && mont.sqr(a) == sq;
+    }
+    bignum::mulThresholds() = saved;
+    return ok;
+}
 
-    // Message to encrypt
-    long long msg = 12;
+// With n = 2^BITS - 1 and a = n - 1, every word of a^2 above the low limb
+// is all ones, so the carry out of the first reduction step runs through
+// every word up to the top.
+// Squares go through reduce() once LIMBS > SQR_VIA_MUL; check them against
+// the shift-and-add product.
+template <size_t L>
+bool checkReduceCarryChain() {
+    bignum::BigInt<L> n;
+    for (auto &w : n.limb) w = ~uint64_t(0);
+    bignum::Montgomery<L> mont(n);
+    bool ok = true;
+    for (uint64_t d = 1; d <= 4 && ok; d++) {
+        bignum::BigInt<L> a = n;
+        a.sub(bignum::BigInt<L>(d));
+        ok = mont.fromMont(mont.sqr(mont.toMont(a))) == mulModSlow(a, a, n);
+    }
+    return ok;
+}
 
-    // Calculate n = p * q
-    long long n = p * q;
-    cout << "Calculated n (p * q) = " << n << endl;
+bool selfTest() {
+    bool ok = true;
+    auto report = [&](const string &name, bool pass) {
+        cout << left << setw(38) << name << (pass ? "ok" : "FAILED") << "\n";
+        ok = ok && pass;
+    };
 
-    // Calculate phi = (p - 1) * (q - 1)
-    long long phi = (p - 1) * (q - 1);
-    cout << "Calculated phi ((p - 1) * (q - 1)) = " << phi << endl;
+    Rsa2048 rsa(katKey());
+    auto m = bignum::BigInt<32>::fromHex(KAT_M), c = bignum::BigInt<32>::fromHex(KAT_C);
+    report("RSA-2048 known-answer encrypt", rsa.encrypt(m) == c);
+    report("RSA-2048 known-answer decrypt", rsa.decryptPlain(c) == m);
+    report("RSA-2048 known-answer decrypt (CRT)", rsa.decryptCrt(c) == m);
+    rsa.setExpMode(bignum::ExpMode::ConstantTime);
+    report("RSA-2048 known-answer, constant-time", rsa.decryptPlain(c) == m && rsa.decryptCrt(c) == m);
+    rsa.setExpMode(bignum::ExpMode::SlidingWindow);
 
-    // Find e such that gcd(e, phi) == 1
-    if (gcd(e, phi) != 1) {
-        cout << "e = " << e << " is not coprime with phi. Incrementing e..." << endl;
+    mt19937_64 rng(2024);
+    bool roundTrip = true;
+    for (int i = 0; i < 8; i++) {
+        auto msg = randomBelow(rsa.publicKey().n, rng);
+        roundTrip = roundTrip && rsa.decrypt(rsa.encrypt(msg)) == msg && rsa.decryptPlain(msg) == rsa.decryptCrt(msg);
     }
+    report("RSA-2048 random round trips", roundTrip);
 
-    for (; e < phi; e++) {
-        if (gcd(e, phi) == 1) {
-            cout << "Chosen e = " << e << " as it is coprime with phi" << endl;
-            break;
+    report("modexp vs shift-and-add, 1024-bit", checkAgainstSlow<16>(rng));
+    report("modexp vs shift-and-add, 2048-bit", checkAgainstSlow<32>(rng));
+    report("modexp vs shift-and-add, 3072-bit", checkAgainstSlow<48>(rng));
+    report("modexp vs shift-and-add, 4096-bit", checkAgainstSlow<64>(rng));
+    report("Karatsuba vs schoolbook, 5-128 limbs",
+           checkKaratsuba<5>(rng) && checkKaratsuba<7>(rng) && checkKaratsuba<33>(rng) && checkKaratsuba<64>(rng) &&
+               checkKaratsuba<128>(rng));
+    report("Montgomery reduce, full carry chain", checkReduceCarryChain<16>() && checkReduceCarryChain<64>());
+    {
+        ThreadPool pool(2);
+        Rsa1024 generated(rsa_keygen::generateKey<16>(&pool));
+        const auto &key = generated.publicKey();
+        bool good = key.n.bitLength() == 1024 && key.e == bignum::BigInt<16>(65537) &&
+                    rsa_keygen::millerRabin(key.p, 20, rng) && rsa_keygen::millerRabin(key.q, 20, rng);
+        bignum::Montgomery<8> mp(key.p);
+        good = good && mp.mulMod(bignum::mod(key.q, key.p), key.qInv) == bignum::BigInt<8>(1);
+        for (int i = 0; i < 4 && good; i++) {
+            auto msg = randomBelow(key.n, rng);
+            good = generated.decryptPlain(generated.encrypt(msg)) == msg && generated.decryptCrt(msg) == generated.decryptPlain(msg);
         }
+        report("RSA-1024 keygen (2 threads)", good);
     }
+    {
+        ThreadPool pool(3);
+        vector<bignum::BigInt<32>> msgs(200);
+        for (auto &x : msgs) x = randomBelow(rsa.publicKey().n, rng);
+        auto cts = rsa.encryptBatch(msgs, &pool);
+        bool good = true;
+        for (size_t i = 0; i < msgs.size(); i++) good = good && cts[i] == rsa.encrypt(msgs[i]);
+        // msgs[i] is a valid signature on cts[i] = msgs[i]^e mod n.
+        auto ok = rsa.verifyBatch(msgs, cts, &pool);
+        cts[17].limb[0] ^= 1;
+        auto bad = rsa.verifyBatch(msgs, cts, &pool);
+        for (size_t i = 0; i < msgs.size(); i++) good = good && ok[i] && bad[i] == (i != 17);
+        report("RSA-2048 batch encrypt/verify", good);
+    }
+    report("Miller-Rabin vs Carmichael numbers", !rsa_keygen::millerRabin(bignum::BigInt<1>(561), 8, rng) &&
+                                                           !rsa_keygen::millerRabin(bignum::BigInt<1>(3215031751), 8, rng));
+    report("decimal round trip", bignum::BigInt<4>::fromDecimal("123456789012345678901234567890").toDecimal() ==
+                                     "123456789012345678901234567890");
+    return ok;
+}
 
-    // Calculate d = (1 + (k * phi)) / e
-    long long d = (1 + (k * phi)) / e;
-    cout << "Calculated d (private key) = " << d << endl;
+// --- Throughput ---
+template <class F>
+double benchRow(const string &name, F &&f, size_t opsPerCall = 1) {
+    size_t calls = 0;
+    auto start = chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        f();
+        calls++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.5);
+    cout << left << setw(38) << name << right << setw(12) << fixed << setprecision(1)
+         << calls * opsPerCall / seconds << " ops/s\n";
+    return calls * opsPerCall / seconds;
+}
+
+template <class F>
+void latencyRow(const string &name, int runs, F &&f) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) f();
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / runs;
+    cout << left << setw(38) << name << right << setw(12) << fixed << setprecision(1) << ms << " ms\n";
+}
 
-    // Original message
-    cout << "Message data = " << msg << endl;
+const size_t BATCH = 1024;
+
+template <size_t L>
+void benchSize(ThreadPool &pool, int keygenRuns, mt19937_64 &rng) {
+    string bits = to_string(64 * L);
+    ThreadPool single(1);
+    latencyRow("RSA-" + bits + " keygen, 1 thread", keygenRuns, [&] { rsa_keygen::generateKey<L>(&single); });
+    if (pool.size() > 1)
+        latencyRow("RSA-" + bits + " keygen, pool of " + to_string(pool.size()), keygenRuns,
+                   [&] { rsa_keygen::generateKey<L>(&pool); });
+
+    Rsa<L> rsa(rsa_keygen::generateKey<L>(&pool));
+    auto msg = randomBelow(rsa.publicKey().n, rng);
+    benchRow("RSA-" + bits + " public (e = 65537)", [&] { msg = rsa.encrypt(msg); });
+    benchRow("RSA-" + bits + " private, plain c^d", [&] { msg = rsa.decryptPlain(msg); });
+    double crt = benchRow("RSA-" + bits + " private, CRT + Garner", [&] { msg = rsa.decryptCrt(msg); });
+    rsa.setExpMode(bignum::ExpMode::ConstantTime);
+    double ct = benchRow("RSA-" + bits + " private, CRT constant-time", [&] { msg = rsa.decryptCrt(msg); });
+    rsa.setExpMode(bignum::ExpMode::SlidingWindow);
+    cout << left << setw(38) << "  constant-time overhead" << right << setw(12) << fixed << setprecision(1)
+         << (crt / ct - 1) * 100 << " %\n";
+
+    // Public-key batches: a context per message against one shared context.
+    RsaKey<L> publicOnly;
+    publicOnly.n = rsa.publicKey().n;
+    publicOnly.e = rsa.publicKey().e;
+    vector<bignum::BigInt<L>> batch(BATCH);
+    for (auto &m : batch) m = randomBelow(publicOnly.n, rng);
+    benchRow("RSA-" + bits + " public, context per message", [&] { msg = Rsa<L>(publicOnly).encrypt(batch[0]); });
+    benchRow("RSA-" + bits + " encryptBatch, 1 thread", [&] { batch = rsa.encryptBatch(batch); }, BATCH);
+    if (pool.size() > 1)
+        benchRow("RSA-" + bits + " encryptBatch, pool of " + to_string(pool.size()),
+                 [&] { batch = rsa.encryptBatch(batch, &pool); }, BATCH);
+}
+
+void runBench() {
+    mt19937_64 rng(7);
+    ThreadPool pool;
+    benchSize<16>(pool, 16, rng);
+    benchSize<32>(pool, 8, rng);
+    benchSize<48>(pool, 4, rng);
+    benchSize<64>(pool, 2, rng);
+}
+
+// --- Karatsuba tuning: time both algorithms, print the crossovers and use them ---
+void runTune() {
+    vector<bignum::TuneRow> rows;
+    bignum::MulThresholds t = bignum::tuneMulThresholds(&rows);
+    cout << right << setw(6) << "limbs" << setw(12) << "mul school" << setw(12) << "mul karat." << setw(12)
+         << "sqr school" << setw(12) << "sqr karat." << setw(12) << "mont CIOS" << setw(12) << "mont karat."
+         << "   (ns)\n";
+    for (const auto &row : rows) {
+        cout << setw(6) << row.limbs << fixed << setprecision(0) << setw(12) << row.mulBasecaseNs << setw(12)
+             << row.mulKaratsubaNs << setw(12) << row.sqrBasecaseNs << setw(12) << row.sqrKaratsubaNs;
+        if (row.montCiosNs > 0) cout << setw(12) << row.montCiosNs << setw(12) << row.montKaratsubaNs;
+        cout << "\n";
+    }
+    auto show = [](size_t v) { return v == bignum::MulThresholds::NEVER ? string("never") : to_string(v) + " limbs"; };
+    cout << "Karatsuba product threshold:  " << show(t.karatsubaMul) << "\n";
+    cout << "Karatsuba square threshold:   " << show(t.karatsubaSqr) << "\n";
+    cout << "Montgomery product threshold: " << show(t.montgomeryMul) << "\n";
+    bignum::mulThresholds() = t;
+}
+
+// --- Demo: generate a key, then encrypt and decrypt a message ---
+template <size_t L>
+void runDemo(ThreadPool &pool) {
+    using Int = bignum::BigInt<L>;
+    auto start = chrono::steady_clock::now();
+    RsaKey<L> key = rsa_keygen::generateKey<L>(&pool);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Generated a " << 64 * L << "-bit key in " << fixed << setprecision(1) << ms << " ms (pool of "
+         << pool.size() << ")" << endl;
+    cout << "p = " << key.p.toHex() << endl;
+    cout << "q = " << key.q.toHex() << endl;
+    cout << "Calculated n (p * q) = " << key.n.toHex() << endl;
+    cout << "Chosen e = " << key.e.toDecimal() << endl;
+    cout << "Calculated d (e^-1 mod phi) = " << key.d.toHex() << endl;
+
+    Rsa<L> rsa(key);
+    Int msg(12);
+    cout << "Message data = " << msg.toDecimal() << endl;
 
     // Encrypt message: c = (msg ^ e) % n
-    double pow1 = pow((double)msg, (double)e);
-    long long c = (long long)fmod(pow1, (double)n);
-    cout << "Encrypted data = " << c << endl;
+    Int c = rsa.encrypt(msg);
+    cout << "Encrypted data = " << c.toHex() << endl;
 
     // Decrypt message: m = (c ^ d) % n
-    double pow2 = pow((double)c, (double)d);
-    long long m = (long long)fmod(pow2, (double)n);
-    cout << "Original Message Sent = " << m << endl;
+    Int m = rsa.decrypt(c);
+    cout << "Original Message Sent = " << m.toDecimal() << endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && string(argv[1]) == "--selftest") return selfTest() ? 0 : 1;
+    if (argc > 1 && string(argv[1]) == "--tune") {
+        runTune();
+        if (argc > 2 && string(argv[2]) == "--bench") runBench();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        runBench();
+        return 0;
+    }
 
+    int bits = 2048;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; i += 2) {
+        string arg = argv[i];
+        bool parsed = i + 1 < argc && (arg == "--bits" || arg == "--threads");
+        try {
+            if (parsed && arg == "--bits") bits = stoi(argv[i + 1]);
+            else if (parsed) threads = parseThreadCount(argv[i + 1]);
+        } catch (const logic_error &) { // not a number, or out of range
+            parsed = false;
+        }
+        if (!parsed) {
+            cerr << "usage: rsa [--bits 1024|2048|3072|4096] [--threads N] | --selftest | --bench | --tune [--bench]\n";
+            return 1;
+        }
+    }
+    ThreadPool pool(threads);
+    switch (bits) {
+    case 1024: runDemo<16>(pool); break;
+    case 2048: runDemo<32>(pool); break;
+    case 3072: runDemo<48>(pool); break;
+    case 4096: runDemo<64>(pool); break;
+    default: cerr << "unsupported key size " << bits << "\n"; return 1;
+    }
     return 0;
 }
@@ -0,0 +1,174 @@
+#pragma once
+
+/*
+ * RSA on fixed-width big integers
+ * -------------------------------
+ * Rsa<LIMBS> holds one key and the Montgomery context for its modulus, so
+ * every encrypt/decrypt is a single modexp with no setup. Messages and
+ * ciphertexts are numbers below n; padding is out of scope here.
+ *
+ * When the key carries its primes, private-key operations use the CRT:
+ * two exponentiations with half-size numbers and exponents, c^dP mod p and
+ * c^dQ mod q, joined by Garner's formula. Each half costs about 1/8 of the
+ * full c^d mod n, so the pair is roughly 4x faster.
+ *
+ * setExpMode(ExpMode::ConstantTime) hardens the private-key path: the
+ * exponentiations use the fixed-window constant-time modexp and Garner's
+ * step uses masked corrections instead of branches. Public-key operations
+ * always take the fast path, since e is public.
+ *
+ * encryptBatch()/verifyBatch() run many public-key operations against the
+ * context built once in the constructor and split the batch across a
+ * ThreadPool, instead of paying for R^2 mod n and -n^-1 on every message.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "../common/instrument.hpp"
+#include "../common/modmath.hpp"
+#include "../common/thread_pool.hpp"
+
+template <std::size_t LIMBS>
+struct RsaKey {
+    static_assert(LIMBS % 2 == 0, "RSA keys need an even number of limbs for the CRT halves");
+    using Int = bignum::BigInt<LIMBS>;
+    using Half = bignum::BigInt<LIMBS / 2>;
+
+    Int n, e, d; // d is zero for a public-only key
+
+    // CRT parameters; all zero when the primes are unknown.
+    Half p, q, dP, dQ, qInv; // dP = d mod (p-1), dQ = d mod (q-1), qInv = q^-1 mod p
+
+    bool hasCrt() const { return !p.isZero(); }
+
+    // Fills in dP, dQ and qInv from n, d and the primes.
+    static RsaKey withCrt(const Int &n, const Int &e, const Int &d, const Half &p, const Half &q) {
+        if (bignum::mulWide(p, q) != bignum::resize<2 * (LIMBS / 2)>(n))
+            throw std::invalid_argument("RSA: p * q does not match n");
+        if (p.bitLength() != q.bitLength()) throw std::invalid_argument("RSA: p and q must have the same size");
+        RsaKey k{n, e, d, p, q, {}, {}, {}};
+        Half pm1 = p, qm1 = q;
+        pm1.sub(Half(1));
+        qm1.sub(Half(1));
+        k.dP = bignum::mod(d, pm1);
+        k.dQ = bignum::mod(d, qm1);
+        k.qInv = bignum::modInverse(q, p);
+        return k;
+    }
+};
+
+template <std::size_t LIMBS>
+class Rsa {
+public:
+    using Int = bignum::BigInt<LIMBS>;
+    using Half = bignum::BigInt<LIMBS / 2>;
+    using Key = RsaKey<LIMBS>;
+
+    explicit Rsa(const Key &k) : key(k), mont(k.n) {
+        if (key.hasCrt()) {
+            montP.emplace(key.p);
+            montQ.emplace(key.q);
+        }
+    }
+
+    const Key &publicKey() const { return key; }
+
+    void setExpMode(bignum::ExpMode m) { mode = m; }
+    bignum::ExpMode expMode() const { return mode; }
+    bool hasPrivateKey() const { return !key.d.isZero(); }
+    bool usesCrt() const { return montP.has_value(); }
+
+    // c = m^e mod n
+    Int encrypt(const Int &m) const {
+        instrument::Scope timer(instrument::Probe::RsaPublic);
+        return mont.modexp(checked(m), key.e);
+    }
+
+    // Messages per parallel work item; one public-key operation is tens of microseconds.
+    static constexpr std::size_t BATCH_GRAIN = 64;
+
+    // c[i] = m[i]^e mod n for every message.
+    std::vector<Int> encryptBatch(const std::vector<Int> &messages, ThreadPool *pool = nullptr) const {
+        for (const Int &m : messages) checked(m); // throw here, not on a pool worker
+        std::vector<Int> out(messages.size());
+        forEachChunk(messages.size(), pool, [&](std::size_t i) { out[i] = encrypt(messages[i]); });
+        return out;
+    }
+
+    // ok[i] = 1 when signatures[i]^e mod n equals messages[i].
+    std::vector<uint8_t> verifyBatch(const std::vector<Int> &signatures, const std::vector<Int> &messages,
+                                     ThreadPool *pool = nullptr) const {
+        if (signatures.size() != messages.size()) throw std::invalid_argument("RSA: batch sizes differ");
+        std::vector<uint8_t> ok(messages.size());
+        forEachChunk(messages.size(), pool, [&](std::size_t i) {
+            ok[i] = signatures[i] < key.n && mont.modexp(signatures[i], key.e) == messages[i];
+        });
+        return ok;
+    }
+
+    // m = c^d mod n, through the CRT when the primes are known.
+    Int decrypt(const Int &c) const { return usesCrt() ? decryptCrt(c) : decryptPlain(c); }
+
+    // Signing is the same private-key operation on the (already padded) message.
+    Int sign(const Int &m) const { return decrypt(m); }
+
+    // c^d mod n with the full exponent, ignoring any CRT parameters.
+    Int decryptPlain(const Int &c) const {
+        if (!hasPrivateKey()) throw std::logic_error("RSA: decrypt needs the private exponent");
+        instrument::Scope timer(instrument::Probe::RsaPrivate);
+        return mont.modexp(checked(c), key.d, mode);
+    }
+
+    Int decryptCrt(const Int &c) const {
+        if (!usesCrt()) throw std::logic_error("RSA: key has no CRT parameters");
+        checked(c);
+        instrument::Scope timer(instrument::Probe::RsaPrivateCrt);
+        auto wide = bignum::resize<2 * (LIMBS / 2)>(c); // LIMBS is even, so this is c itself
+        Half m1 = montP->modexp(montP->reduceWide(wide), key.dP, mode);
+        Half m2 = montQ->modexp(montQ->reduceWide(wide), key.dQ, mode);
+
+        // Garner: m = m2 + q * ((m1 - m2) * qInv mod p). p and q have the same
+        // size, so m2 < q < 2p and one masked subtraction reduces it mod p.
+        Half m2p = m2;
+        uint64_t below = m2p.sub(key.p);
+        m2p = Half::select(0 - below, m2, m2p);
+        Half diff = m1;
+        uint64_t negative = diff.sub(m2p);
+        diff.add(Half::select(0 - negative, key.p, Half()));
+        Half h = montP->mulMod(diff, key.qInv);
+        Int m = bignum::resize<LIMBS>(bignum::mulWide(key.q, h));
+        m.add(bignum::resize<LIMBS>(m2));
+        return m;
+    }
+
+    const bignum::Montgomery<LIMBS> &context() const { return mont; }
+
+private:
+    template <class F>
+    static void forEachChunk(std::size_t count, ThreadPool *pool, F &&f) {
+        auto run = [&](std::size_t begin, std::size_t end, unsigned) {
+            for (std::size_t i = begin; i < end; i++) f(i);
+        };
+        if (pool) pool->parallelFor(count, BATCH_GRAIN, run);
+        else run(0, count, 0);
+    }
+
+    const Int &checked(const Int &v) const {
+        if (v >= key.n) throw std::invalid_argument("RSA: message must be below the modulus");
+        return v;
+    }
+
+    Key key;
+    bignum::ExpMode mode = bignum::ExpMode::SlidingWindow;
+    bignum::Montgomery<LIMBS> mont;
+    std::optional<bignum::Montgomery<LIMBS / 2>> montP, montQ;
+};
+
+using Rsa1024 = Rsa<16>;
+using Rsa2048 = Rsa<32>;
+using Rsa3072 = Rsa<48>;
+using Rsa4096 = Rsa<64>;
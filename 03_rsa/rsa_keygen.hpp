@@ -0,0 +1,209 @@
+#pragma once
+
+/*
+ * RSA key generation
+ * ------------------
+ * Primes are found by an incremental sieve followed by Miller-Rabin:
+ *
+ *   1. Pick a random odd start x with the top two bits set, so p * q has
+ *      exactly the requested size.
+ *   2. Compute x mod s once for every small prime s < 2^16. Candidates
+ *      x, x+2, x+4, ... in a window are crossed off wherever a residue hits
+ *      zero; moving to the next window only updates the residues.
+ *   3. Survivors get Miller-Rabin rounds with random bases, the round count
+ *      taken from FIPS 186-4 table C.3 for the prime size.
+ *
+ * The sieve also drops candidates with p = 1 mod e, so e is always
+ * invertible. Workers of a ThreadPool each run their own search and the
+ * first two primes found become p and q.
+ *
+ * d = e^-1 mod (p-1)(q-1) is computed with extended Euclid on the 64-bit
+ * residue phi mod e: with k = -phi^-1 mod e, (1 + k*phi) is divisible by e
+ * and d = (1 + k*phi) / e exactly.
+ *
+ * Randomness comes from std::random_device seeding std::mt19937_64, which
+ * is fine for exercising the code and not a CSPRNG.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "rsa.hpp"
+#include "../common/thread_pool.hpp"
+
+namespace rsa_keygen {
+
+// Odd primes below 2^16.
+inline const std::vector<uint32_t> &smallPrimes() {
+    static const std::vector<uint32_t> primes = [] {
+        const uint32_t LIMIT = 1 << 16;
+        std::vector<bool> composite(LIMIT);
+        std::vector<uint32_t> out;
+        for (uint32_t i = 3; i < LIMIT; i += 2) {
+            if (composite[i]) continue;
+            out.push_back(i);
+            for (uint64_t j = uint64_t(i) * i; j < LIMIT; j += 2 * i) composite[j] = true;
+        }
+        return out;
+    }();
+    return primes;
+}
+
+// Miller-Rabin rounds for an error probability below 2^-100 (FIPS 186-4, C.3).
+inline int millerRabinRounds(std::size_t bits) {
+    if (bits >= 1536) return 4;
+    if (bits >= 1024) return 5;
+    if (bits >= 512) return 8;
+    return 40;
+}
+
+template <std::size_t L>
+bool millerRabin(const bignum::BigInt<L> &w, int rounds, std::mt19937_64 &rng) {
+    using Int = bignum::BigInt<L>;
+    if (compare(w, Int(3)) <= 0) return w == Int(2) || w == Int(3);
+    if (!w.isOdd()) return false;
+    bignum::Montgomery<L> mont(w);
+    Int wm1 = w;
+    wm1.sub(Int(1));
+    std::size_t s = 0;
+    while (!wm1.bit(s)) s++;
+    Int r = wm1;
+    for (std::size_t i = 0; i < s; i++) r.shiftRight1();
+
+    const Int one = mont.one();
+    Int minusOne = w; // w - 1 in Montgomery form is n - R mod n
+    minusOne.sub(one);
+    std::size_t bits = w.bitLength();
+    for (int round = 0; round < rounds; round++) {
+        Int a;
+        do {
+            for (auto &limb : a.limb) limb = rng();
+            for (std::size_t i = bits; i < Int::BITS; i++) a.limb[i / 64] &= ~(uint64_t(1) << (i % 64));
+        } while (compare(a, Int(2)) < 0 || a >= wm1);
+        Int x = mont.modexpMont(mont.toMont(a), r);
+        if (x == one || x == minusOne) continue;
+        bool witness = true;
+        for (std::size_t i = 1; i < s && witness; i++) {
+            x = mont.sqr(x);
+            if (x == minusOne) witness = false;
+        }
+        if (witness) return false;
+    }
+    return true;
+}
+
+// Searches upward from a random start; `stop` lets another worker cancel the search.
+template <std::size_t L>
+bignum::BigInt<L> findPrime(std::size_t bits, uint64_t e, std::mt19937_64 &rng, const std::atomic<bool> &stop) {
+    using Int = bignum::BigInt<L>;
+    if (bits < 16 || bits > Int::BITS) throw std::invalid_argument("RSA keygen: unsupported prime size");
+    const auto &primes = smallPrimes();
+    const std::size_t WINDOW = 4096; // candidates x + 2j, j < WINDOW
+    std::vector<uint32_t> residues(primes.size());
+    std::vector<uint8_t> sieve(WINDOW);
+
+    for (;;) {
+        Int x;
+        for (auto &limb : x.limb) limb = rng();
+        for (std::size_t i = bits; i < Int::BITS; i++) x.limb[i / 64] &= ~(uint64_t(1) << (i % 64));
+        x.limb[(bits - 1) / 64] |= uint64_t(1) << ((bits - 1) % 64);
+        x.limb[(bits - 2) / 64] |= uint64_t(1) << ((bits - 2) % 64);
+        x.limb[0] |= 1;
+        for (std::size_t i = 0; i < primes.size(); i++) residues[i] = uint32_t(x.modSmall(primes[i]));
+        uint64_t eResidue = x.modSmall(e);
+
+        // Windows until the candidates would outgrow `bits` (then start afresh).
+        for (int window = 0; window < 64; window++) {
+            if (stop.load(std::memory_order_relaxed)) return Int();
+            Int last = x;
+            if (last.addSmall(2 * WINDOW) || last.bitLength() != bits) break;
+            std::fill(sieve.begin(), sieve.end(), 0);
+            for (std::size_t i = 0; i < primes.size(); i++) {
+                uint64_t s = primes[i];
+                // First j with residue + 2j = 0 (mod s); (s + 1) / 2 is 2^-1 mod s.
+                uint64_t j = (s - residues[i]) % s * ((s + 1) / 2) % s;
+                for (; j < WINDOW; j += s) sieve[j] = 1;
+                residues[i] = uint32_t((residues[i] + 2 * WINDOW) % s);
+            }
+            if (e > 2) { // p = 1 (mod e) would leave e without an inverse mod p - 1
+                uint64_t j = uint64_t(bignum::u128((e + 1 - eResidue) % e) * ((e + 1) / 2) % e);
+                for (; j < WINDOW; j += e) sieve[j] = 1;
+                eResidue = (eResidue + 2 * WINDOW) % e;
+            }
+            for (std::size_t j = 0; j < WINDOW; j++) {
+                if (sieve[j]) continue;
+                Int candidate = x;
+                candidate.addSmall(2 * j);
+                if (millerRabin(candidate, millerRabinRounds(bits), rng)) return candidate;
+                if (stop.load(std::memory_order_relaxed)) return Int();
+            }
+            x.addSmall(2 * WINDOW);
+        }
+    }
+}
+
+// d = e^-1 mod phi for a small odd e coprime to phi.
+template <std::size_t L>
+bignum::BigInt<L> privateExponent(const bignum::BigInt<L> &phi, uint64_t e) {
+    uint64_t inv = modmath::modInverse64(phi.modSmall(e), e);
+    if (inv == 0) throw std::invalid_argument("RSA keygen: e is not coprime to phi");
+    uint64_t k = (e - inv) % e; // k * phi = -1 (mod e)
+    bignum::BigInt<L + 1> t = bignum::resize<L + 1>(phi);
+    t.mulSmall(k);
+    t.addSmall(1);
+    t.divSmall(e);
+    return bignum::resize<L>(t);
+}
+
+// Generates a key with a modulus of exactly 64 * LIMBS bits. With a pool, every
+// worker searches independently and the first two primes found are used.
+template <std::size_t LIMBS>
+RsaKey<LIMBS> generateKey(ThreadPool *pool = nullptr, uint64_t e = 65537) {
+    using Int = bignum::BigInt<LIMBS>;
+    using Half = bignum::BigInt<LIMBS / 2>;
+    if (e < 3 || e % 2 == 0) throw std::invalid_argument("RSA keygen: e must be odd and >= 3");
+    const std::size_t HALF_BITS = Half::BITS;
+
+    std::random_device device;
+    std::vector<uint64_t> seeds(pool ? pool->size() : 1);
+    for (auto &s : seeds) s = (uint64_t(device()) << 32) ^ device();
+
+    for (;;) {
+        std::mutex found;
+        std::vector<Half> primes;
+        std::atomic<bool> done{false};
+        auto search = [&](unsigned worker) {
+            std::mt19937_64 rng(seeds[worker]++);
+            while (!done.load()) {
+                Half p = findPrime<LIMBS / 2>(HALF_BITS, e, rng, done);
+                if (p.isZero()) return;
+                std::lock_guard<std::mutex> lock(found);
+                if (primes.size() < 2 && (primes.empty() || primes[0] != p)) primes.push_back(p);
+                if (primes.size() == 2) done = true;
+            }
+        };
+        if (pool) pool->runOnAll(search);
+        else search(0);
+
+        Half p = primes[0], q = primes[1];
+        if (p < q) std::swap(p, q); // with p > q, Garner's m2 is already below p
+        Int n = bignum::mulWide(p, q);
+        if (n.bitLength() != Int::BITS) continue; // cannot happen with the top two bits set
+
+        Half pm1 = p, qm1 = q;
+        pm1.sub(Half(1));
+        qm1.sub(Half(1));
+        Int phi = bignum::mulWide(pm1, qm1);
+        if (modmath::modInverse64(phi.modSmall(e), e) == 0) continue; // only possible for composite e
+        Int d = privateExponent(phi, e);
+        return RsaKey<LIMBS>::withCrt(n, Int(e), d, p, q);
+    }
+}
+
+} // namespace rsa_keygen
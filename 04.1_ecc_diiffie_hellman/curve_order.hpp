@@ -0,0 +1,195 @@
+#pragma once
+
+/*
+ * Counting points on y^2 = x^3 + ax + b over F_p without listing them
+ * -------------------------------------------------------------------
+ * Hasse: #E = p + 1 - t with |t| <= 2 sqrt(p), so the order lies in an
+ * interval of width about 4 sqrt(p). For a random point P, baby-step
+ * giant-step finds some m in that interval with mP = O in about
+ * 2 * 2 p^(1/4) group operations; factoring m (Pollard rho) strips it
+ * down to the exact order of P. #E is a multiple of the lcm L of the
+ * orders seen so far, and once only one multiple of L fits the interval
+ * that multiple is #E.
+ *
+ * The points of E can all have small order (E is not always cyclic), so
+ * Mestre's trick runs the same search on the quadratic twist E', whose
+ * order is 2p + 2 - #E: for p > 229 one of E or E' always has a point that
+ * pins the answer down. Points are drawn alternately from both.
+ *
+ * Below BSGS_MIN_P the count is the plain character sum over x from
+ * PointScanner. Schoof's algorithm (polynomial in log p) is not needed
+ * here: p^(1/4) stays under 10^5 steps up to p = 2^62.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "curve_points.hpp"
+#include "../common/modmath.hpp"
+
+struct CurvePoint {
+    uint64_t x = 0, y = 0;
+    bool infinity = true;
+};
+
+// Affine arithmetic on y^2 = x^3 + ax + b mod a prime p > 3, coefficients in [0, p).
+class SmallCurve {
+public:
+    SmallCurve(uint64_t prime, uint64_t coeffA, uint64_t coeffB) : p(prime), a(coeffA), b(coeffB) {}
+
+    uint64_t modulus() const { return p; }
+
+    bool contains(const CurvePoint &pt) const {
+        if (pt.infinity) return true;
+        uint64_t rhs = modmath::mulMod(modmath::mulMod(pt.x, pt.x, p), pt.x, p);
+        rhs = modmath::addMod(modmath::addMod(rhs, modmath::mulMod(a, pt.x, p), p), b, p);
+        return modmath::mulMod(pt.y, pt.y, p) == rhs;
+    }
+
+    CurvePoint negate(const CurvePoint &pt) const {
+        return pt.infinity ? pt : CurvePoint{pt.x, pt.y ? p - pt.y : 0, false};
+    }
+
+    CurvePoint dbl(const CurvePoint &pt) const {
+        if (pt.infinity || pt.y == 0) return {};
+        uint64_t num = modmath::addMod(modmath::mulMod(3, modmath::mulMod(pt.x, pt.x, p), p), a, p);
+        return chord(pt, pt.x, modmath::mulMod(num, modmath::modInverse64(modmath::addMod(pt.y, pt.y, p), p), p));
+    }
+
+    CurvePoint add(const CurvePoint &P, const CurvePoint &Q) const {
+        if (P.infinity) return Q;
+        if (Q.infinity) return P;
+        if (P.x == Q.x) return P.y == Q.y ? dbl(P) : CurvePoint{};
+        uint64_t lambda = modmath::mulMod(modmath::subMod(Q.y, P.y, p),
+                                          modmath::modInverse64(modmath::subMod(Q.x, P.x, p), p), p);
+        return chord(P, Q.x, lambda);
+    }
+
+    // k * pt, double-and-add from the top bit.
+    CurvePoint mul(const CurvePoint &pt, uint64_t k) const {
+        CurvePoint r;
+        for (int i = 63 - (k ? __builtin_clzll(k) : 63); i >= 0; i--) {
+            r = dbl(r);
+            if ((k >> i) & 1) r = add(r, pt);
+        }
+        return k ? r : CurvePoint{};
+    }
+
+    // A uniformly random finite point: random x until x^3 + ax + b is a square.
+    CurvePoint randomPoint(std::mt19937_64 &rng, const modmath::SqrtMod64 &roots) const {
+        for (;;) {
+            uint64_t x = rng() % p, y;
+            uint64_t rhs = modmath::mulMod(modmath::mulMod(x, x, p), x, p);
+            rhs = modmath::addMod(modmath::addMod(rhs, modmath::mulMod(a, x, p), p), b, p);
+            if (!roots.sqrt(rhs, y)) continue;
+            if (rng() & 1) y = y ? p - y : 0;
+            return {x, y, false};
+        }
+    }
+
+private:
+    // The third intersection of the line through P with slope lambda, reflected.
+    CurvePoint chord(const CurvePoint &P, uint64_t otherX, uint64_t lambda) const {
+        uint64_t x3 = modmath::subMod(modmath::subMod(modmath::mulMod(lambda, lambda, p), P.x, p), otherX, p);
+        uint64_t y3 = modmath::subMod(modmath::mulMod(lambda, modmath::subMod(P.x, x3, p), p), P.y, p);
+        return {x3, y3, false};
+    }
+
+    uint64_t p, a, b;
+};
+
+// Some m > 0 with m * P = O, searched for in [lo, hi] by baby-step giant-step
+// (a smaller multiple is returned if the baby steps already run into one).
+inline uint64_t orderMultiple(const SmallCurve &curve, const CurvePoint &P, uint64_t lo, uint64_t hi) {
+    uint64_t s = uint64_t(std::sqrt(double(hi - lo + 1))) + 1;
+    std::unordered_map<uint64_t, uint32_t> babyX; // x of jP -> j
+    std::vector<uint64_t> babyY(s + 1);
+    babyX.reserve(std::size_t(s));
+    CurvePoint R;
+    for (uint64_t j = 1; j <= s; j++) {
+        R = curve.add(R, P);
+        if (R.infinity) return j;
+        auto [it, fresh] = babyX.emplace(R.x, uint32_t(j));
+        if (!fresh) return j + it->second; // jP = -j'P, since jP = j'P would have hit O at j - j'
+        babyY[j] = R.y;
+    }
+    const CurvePoint stride = R; // s * P
+    CurvePoint G = curve.mul(P, lo);
+    for (uint64_t m = lo; m <= hi + s; m += s) { // G = m * P
+        if (G.infinity) return m;
+        auto it = babyX.find(G.x);
+        if (it != babyX.end()) return babyY[it->second] == G.y ? m - it->second : m + it->second;
+        G = curve.add(G, stride);
+    }
+    throw std::logic_error("curve order: no multiple of the point order in the Hasse interval");
+}
+
+// The exact order of P from a multiple m of it.
+inline uint64_t pointOrder(const SmallCurve &curve, const CurvePoint &P, uint64_t m) {
+    uint64_t order = m;
+    std::vector<uint64_t> primes = modmath::factor64(m);
+    for (std::size_t i = 0; i < primes.size(); i++) {
+        if (i && primes[i] == primes[i - 1]) continue;
+        while (order % primes[i] == 0 && curve.mul(P, order / primes[i]).infinity) order /= primes[i];
+    }
+    return order;
+}
+
+inline constexpr uint64_t BSGS_MIN_P = uint64_t(1) << 16;
+inline constexpr uint64_t COUNT_MAX_P = uint64_t(1) << 62;
+
+// #E(F_p) including the point at infinity, for a prime 3 < p < 2^62 and a
+// nonsingular curve (4a^3 + 27b^2 != 0 mod p).
+inline uint64_t curveOrder(uint64_t p, int64_t coeffA, int64_t coeffB) {
+    if (p <= 3 || p >= COUNT_MAX_P || !modmath::isPrime64(p))
+        throw std::invalid_argument("curve order: p must be a prime with 3 < p < 2^62");
+    uint64_t a = modmath::reduceSigned(coeffA, p), b = modmath::reduceSigned(coeffB, p);
+    uint64_t disc = modmath::addMod(modmath::mulMod(4, modmath::mulMod(modmath::mulMod(a, a, p), a, p), p),
+                                    modmath::mulMod(27, modmath::mulMod(b, b, p), p), p);
+    if (disc == 0) throw std::invalid_argument("curve order: the curve is singular");
+
+    if (p < BSGS_MIN_P) {
+        uint64_t count = 1;
+        PointScanner(p, int64_t(a), int64_t(b)).scan(0, p, [&](uint64_t, uint64_t) { count++; });
+        return count;
+    }
+
+    modmath::SqrtMod64 roots(p);
+    uint64_t d = 2; // twist by a non-residue: y^2 = x^3 + a d^2 x + b d^3
+    while (roots.legendre(d) != -1) d++;
+    uint64_t d2 = modmath::mulMod(d, d, p);
+    const SmallCurve curves[2] = {SmallCurve(p, a, b),
+                                  SmallCurve(p, modmath::mulMod(a, d2, p), modmath::mulMod(b, modmath::mulMod(d2, d, p), p))};
+
+    uint64_t r = uint64_t(std::sqrt(double(4 * p))); // floor(2 sqrt(p)), fixed up for rounding
+    while (r * r > 4 * p) r--;
+    while (modmath::u128(r + 1) * (r + 1) <= 4 * p) r++;
+    const uint64_t lo = p + 1 - r, hi = p + 1 + r, sum = 2 * p + 2;
+
+    std::mt19937_64 rng(p ^ (a << 1) ^ (b << 2));
+    uint64_t lcm[2] = {1, 1};
+    for (int draw = 0; draw < 200; draw++) {
+        int side = draw % 2;
+        CurvePoint P = curves[side].randomPoint(rng, roots);
+        uint64_t order = pointOrder(curves[side], P, orderMultiple(curves[side], P, lo, hi));
+        lcm[side] = lcm[side] / modmath::gcd64(lcm[side], order) * order;
+
+        // Walk the multiples of the larger lcm; the other side must divide 2p + 2 - N.
+        int lead = lcm[0] >= lcm[1] ? 0 : 1;
+        uint64_t step = lcm[lead];
+        if ((hi - lo) / step > 64) continue;
+        uint64_t found = 0, matches = 0;
+        for (uint64_t n = (lo + step - 1) / step * step; n <= hi; n += step) {
+            if ((sum - n) % lcm[1 - lead]) continue;
+            found = lead == 0 ? n : sum - n;
+            matches++;
+        }
+        if (matches == 1) return found;
+    }
+    throw std::runtime_error("curve order: no unique candidate");
+}
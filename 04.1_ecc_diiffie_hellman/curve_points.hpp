@@ -0,0 +1,90 @@
+#pragma once
+
+/*
+ * Affine points of y^2 = x^3 + ax + b over a prime field
+ * ------------------------------------------------------
+ * Testing every (x, y) pair costs p^2 evaluations. PointScanner walks x
+ * once instead: the right-hand side f(x) = x^3 + ax + b is stepped with
+ * finite differences (three modular additions per x, no products), and
+ * each value is either a square with roots y and p - y, zero with the
+ * single root y = 0, or not a square at all.
+ *
+ * For p up to QR_BITMAP_MAX the squares mod p are marked in a bitmap
+ * first (p/8 bytes, built by stepping y^2 the same way), so a non-residue
+ * costs one bit test and Tonelli-Shanks only runs for the half of the x
+ * values that have points. Above that the bitmap would not fit in cache
+ * and SqrtMod64::sqrt() does the residue test as part of the root.
+ *
+ * scan() reports points in the order of the old pair loop: x ascending
+ * and, for each x, the smaller y first.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../common/modmath.hpp"
+
+class PointScanner {
+public:
+    static constexpr uint64_t QR_BITMAP_MAX = uint64_t(1) << 27; // 16 MiB of bitmap
+
+    // p must be an odd prime; a and b may be negative.
+    PointScanner(uint64_t prime, int64_t coeffA, int64_t coeffB, bool useBitmap = true)
+        : p(prime), a(modmath::reduceSigned(coeffA, prime)), b(modmath::reduceSigned(coeffB, prime)), roots(prime) {
+        if (useBitmap && p <= QR_BITMAP_MAX) {
+            squares.assign(std::size_t(p / 64 + 1), 0);
+            uint64_t sq = 0; // y^2, stepped by (y + 1)^2 = y^2 + 2y + 1
+            for (uint64_t y = 0; y <= p / 2; y++) {
+                squares[std::size_t(sq / 64)] |= uint64_t(1) << (sq % 64);
+                sq = modmath::addMod(sq, (2 * y + 1) % p, p);
+            }
+        }
+    }
+
+    uint64_t modulus() const { return p; }
+    bool hasBitmap() const { return !squares.empty(); }
+
+    // f(x) = x^3 + ax + b mod p.
+    uint64_t rhs(uint64_t x) const {
+        x %= p;
+        uint64_t r = modmath::mulMod(modmath::mulMod(x, x, p), x, p);
+        return modmath::addMod(modmath::addMod(r, modmath::mulMod(a, x, p), p), b, p);
+    }
+
+    // Calls emit(x, y) for every point with xBegin <= x < xEnd.
+    template <class F>
+    void scan(uint64_t xBegin, uint64_t xEnd, F &&emit) const {
+        if (xEnd > p) xEnd = p;
+        if (xBegin >= xEnd) return;
+        // f(x + 1) = f(x) + d(x), d(x) = 3x^2 + 3x + 1 + a, d(x + 1) = d(x) + 6x + 6.
+        uint64_t x0 = xBegin;
+        uint64_t f = rhs(x0);
+        uint64_t d = modmath::addMod(modmath::mulMod(3 % p, modmath::addMod(modmath::mulMod(x0, x0, p), x0, p), p),
+                                     modmath::addMod(1 % p, a, p), p);
+        uint64_t e = modmath::mulMod(6 % p, modmath::addMod(x0, 1 % p, p), p);
+        uint64_t six = 6 % p;
+        for (uint64_t x = xBegin; x < xEnd; x++) {
+            uint64_t y;
+            if (f == 0) {
+                emit(x, uint64_t(0));
+            } else if ((squares.empty() || isSquare(f)) && roots.sqrt(f, y)) {
+                uint64_t other = p - y;
+                if (other < y) std::swap(y, other);
+                emit(x, y);
+                emit(x, other);
+            }
+            f = modmath::addMod(f, d, p);
+            d = modmath::addMod(d, e, p);
+            e = modmath::addMod(e, six, p);
+        }
+    }
+
+private:
+    bool isSquare(uint64_t v) const { return (squares[std::size_t(v / 64)] >> (v % 64)) & 1; }
+
+    uint64_t p, a, b;
+    modmath::SqrtMod64 roots;
+    std::vector<uint64_t> squares; // bit v set when v is a square mod p
+};
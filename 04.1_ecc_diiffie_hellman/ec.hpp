@@ -0,0 +1,630 @@
+#pragma once
+
+/*
+ * Elliptic-curve arithmetic and ECDH over prime fields
+ * ----------------------------------------------------
+ * EcCurve<LIMBS> holds y^2 = x^3 + ax + b over F_p, a base point G of
+ * prime order n, and the Montgomery context for p from modmath. Field
+ * elements inside the engine stay in Montgomery form.
+ *
+ * Affine addition needs a field inversion per step, which costs as much
+ * as dozens of products. Points are therefore kept in Jacobian
+ * coordinates (X : Y : Z) for x = X/Z^2, y = Y/Z^3 while a scalar
+ * multiplication runs, and converted back with a single inversion at the
+ * end. The formulas are dbl-2007-bl (dbl-2001-b when a = -3, three
+ * squarings fewer), add-2007-bl and madd-2007-bl, where the second point
+ * is affine (Z = 1).
+ *
+ * mulWnaf() recodes the scalar in width-w non-adjacent form: digits are
+ * odd and in (-2^(w-1), 2^(w-1)), and any w consecutive digits hold at
+ * most one nonzero. With a table of P, 3P, ..., (2^(w-1) - 1)P that is
+ * about one addition per w + 1 bits, against one per two bits for plain
+ * double-and-add. Negating a point is free, so negative digits cost
+ * nothing extra.
+ *
+ * Key generation always multiplies the same G, so publicKey() goes
+ * through a Lim-Lee comb built once per curve, the same layout as the
+ * MODP comb in 04.2_diffie_hellman: h = 8 rows and v = 2 tables of 256
+ * affine points (32 KiB at 256 bits). A 256-bit scalar then costs 16
+ * doublings and at most 32 mixed additions.
+ *
+ * Batches. toAffineBatch() uses Montgomery's trick: invert the product of
+ * all the Z coordinates once, then peel the individual inverses off with
+ * three products each. A sum of many multiples, sum k_i * P_i, shares its
+ * doublings: Straus interleaves one wNAF per point over a single doubling
+ * chain (tables normalised in one batch, so all additions are mixed), and
+ * Pippenger sorts the points into 2^c buckets per c-bit window of the
+ * scalars and adds each bucket total into the result with a running sum.
+ * multiScalarMul() picks whichever a simple operation count favours.
+ *
+ * wNAF, double-and-add, the comb and the batch paths branch on scalar bits. mulLadder()
+ * is the constant-time path: the scalar is reduced mod n bit by bit with
+ * masked subtractions, then a Montgomery ladder runs over a fixed bit
+ * count, with the two running points swapped by masks instead of branches,
+ * and field additions that select rather than branch. The binary GCD
+ * behind the usual inversion branches on Z, so toAffine() in
+ * ExpMode::ConstantTime inverts by Fermat, Z^(p-2) with the fixed-window
+ * modexp. ExpMode::ConstantTime selects both for key generation and the
+ * shared secret.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../common/instrument.hpp"
+#include "../common/modmath.hpp"
+#include "ec_curves.hpp"
+
+template <std::size_t LIMBS>
+class EcFixedBaseComb;
+
+template <std::size_t LIMBS>
+class EcCurve {
+public:
+    using Int = modmath::BigInt<LIMBS>;
+
+    struct Affine {
+        Int x, y; // normal form
+        bool infinity = true;
+    };
+
+    struct Jacobian {
+        Int X, Y, Z; // Montgomery form; Z = 0 is the point at infinity
+    };
+
+    // Affine in Montgomery form and never O: table entries and the second
+    // operand of mixed additions.
+    struct Precomputed {
+        Int x, y;
+    };
+
+    // Width of the wNAF window used by mul(): 8 table points for a 256-bit scalar.
+    static constexpr int WNAF_WIDTH = 5;
+
+    EcCurve(const Int &prime, const Int &a, const Int &b, const Affine &base, const Int &groupOrder)
+        : p(prime), n(groupOrder), g(base), field(prime) {
+        if (a >= p || b >= p) throw std::invalid_argument("EC: coefficients must be below p");
+        aM = field.toMont(a);
+        bM = field.toMont(b);
+        Int minus3 = p;
+        minus3.sub(Int(3));
+        aShape = a.isZero() ? AShape::Zero : a == minus3 ? AShape::MinusThree : AShape::Generic;
+        if (g.infinity || !onCurve(g)) throw std::invalid_argument("EC: base point is not on the curve");
+    }
+
+    explicit EcCurve(const ec_curves::CurveSpec &spec)
+        : EcCurve(Int::fromHex(spec.prime), Int::fromHex(spec.a), Int::fromHex(spec.b),
+                  Affine{Int::fromHex(spec.gx), Int::fromHex(spec.gy), false}, Int::fromHex(spec.order)) {}
+
+    EcCurve(const EcCurve &) = delete;
+    EcCurve &operator=(const EcCurve &) = delete;
+
+    const Int &prime() const { return p; }
+    const Int &order() const { return n; }
+    const Affine &generator() const { return g; }
+    std::size_t bits() const { return p.bitLength(); }
+    const modmath::Montgomery<LIMBS> &context() const { return field; }
+
+    bool onCurve(const Affine &P) const {
+        if (P.infinity) return true;
+        if (P.x >= p || P.y >= p) return false;
+        Int x = field.toMont(P.x), y = field.toMont(P.y);
+        Int rhs = add(field.mul(add(field.sqr(x), aM), x), bM); // (x^2 + a) x + b
+        return field.sqr(y) == rhs;
+    }
+
+    // --- Coordinates ---
+
+    Jacobian infinity() const { return {field.one(), field.one(), Int()}; }
+    static bool isInfinity(const Jacobian &P) { return P.Z.isZero(); }
+
+    Jacobian toJacobian(const Affine &P) const {
+        if (P.infinity) return infinity();
+        return {field.toMont(P.x), field.toMont(P.y), field.one()};
+    }
+
+    // One inversion: x = X / Z^2, y = Y / Z^3. ConstantTime inverts by Fermat
+    // instead of the binary GCD, whose steps depend on Z.
+    Affine toAffine(const Jacobian &P, modmath::ExpMode mode = modmath::ExpMode::SlidingWindow) const {
+        if (isInfinity(P)) return {};
+        Int zInv = mode == modmath::ExpMode::ConstantTime ? inverseConstTime(P.Z) : inverse(P.Z);
+        Int zInv2 = field.sqr(zInv);
+        return {field.fromMont(field.mul(P.X, zInv2)), field.fromMont(field.mul(P.Y, field.mul(zInv2, zInv))), false};
+    }
+
+    // Montgomery's trick: N conversions for one inversion and about 3N products.
+    // Points at infinity come back as infinity.
+    std::vector<Affine> toAffineBatch(const std::vector<Jacobian> &points) const {
+        std::vector<Int> zInv(points.size());
+        std::vector<Affine> out(points.size());
+        toAffineBatch(points.data(), out.data(), points.size(), zInv.data());
+        return out;
+    }
+
+    // The same into caller-owned storage; `scratch` holds n field elements.
+    void toAffineBatch(const Jacobian *points, Affine *out, std::size_t n, Int *scratch) const {
+        inverseZ(points, n, scratch);
+        for (std::size_t i = 0; i < n; i++) {
+            if (isInfinity(points[i])) {
+                out[i] = {};
+                continue;
+            }
+            Int zInv2 = field.sqr(scratch[i]);
+            out[i] = {field.fromMont(field.mul(points[i].X, zInv2)),
+                      field.fromMont(field.mul(points[i].Y, field.mul(zInv2, scratch[i]))), false};
+        }
+    }
+
+    // The same, to Montgomery-form affine points for tables. Entries for O are
+    // left zero, so only finite points should be looked up afterwards.
+    std::vector<Precomputed> precomputeBatch(const std::vector<Jacobian> &points) const {
+        std::vector<Int> zInv(points.size());
+        inverseZ(points.data(), points.size(), zInv.data());
+        std::vector<Precomputed> out(points.size());
+        for (std::size_t i = 0; i < points.size(); i++) {
+            if (isInfinity(points[i])) continue;
+            Int zInv2 = field.sqr(zInv[i]);
+            out[i] = {field.mul(points[i].X, zInv2), field.mul(points[i].Y, field.mul(zInv2, zInv[i]))};
+        }
+        return out;
+    }
+
+    Precomputed precompute(const Affine &P) const {
+        if (P.infinity) throw std::invalid_argument("EC: the point at infinity has no affine form");
+        return {field.toMont(P.x), field.toMont(P.y)};
+    }
+
+    Jacobian negate(const Jacobian &P) const { return {P.X, sub(Int(), P.Y), P.Z}; }
+
+    // --- Group law ---
+
+    Jacobian dbl(const Jacobian &P) const {
+        if (isInfinity(P) || P.Y.isZero()) return infinity();
+        Int xx = field.sqr(P.X), yy = field.sqr(P.Y), yyyy = field.sqr(yy), zz = field.sqr(P.Z);
+        Int s = add(P.X, yy);
+        s = twice(sub(sub(field.sqr(s), xx), yyyy));
+        Int m;
+        if (aShape == AShape::MinusThree) {
+            m = field.mul(sub(P.X, zz), add(P.X, zz)); // 3 (X - Z^2)(X + Z^2) = 3X^2 - 3Z^4
+            m = add(m, twice(m));
+        } else {
+            m = add(xx, twice(xx));
+            if (aShape == AShape::Generic) m = add(m, field.mul(aM, field.sqr(zz)));
+        }
+        Jacobian r;
+        r.X = sub(field.sqr(m), twice(s));
+        r.Y = sub(field.mul(m, sub(s, r.X)), twice(twice(twice(yyyy))));
+        r.Z = sub(sub(field.sqr(add(P.Y, P.Z)), yy), zz);
+        return r;
+    }
+
+    Jacobian add(const Jacobian &P, const Jacobian &Q) const {
+        if (isInfinity(P)) return Q;
+        if (isInfinity(Q)) return P;
+        Int z1z1 = field.sqr(P.Z), z2z2 = field.sqr(Q.Z);
+        Int u1 = field.mul(P.X, z2z2), u2 = field.mul(Q.X, z1z1);
+        Int s1 = field.mul(P.Y, field.mul(Q.Z, z2z2)), s2 = field.mul(Q.Y, field.mul(P.Z, z1z1));
+        Int h = sub(u2, u1), r = twice(sub(s2, s1));
+        if (h.isZero()) return r.isZero() ? dbl(P) : infinity();
+        Int i = field.sqr(twice(h)), j = field.mul(h, i), v = field.mul(u1, i);
+        Jacobian out;
+        out.X = sub(sub(field.sqr(r), j), twice(v));
+        out.Y = sub(field.mul(r, sub(v, out.X)), twice(field.mul(s1, j)));
+        out.Z = field.mul(sub(sub(field.sqr(add(P.Z, Q.Z)), z1z1), z2z2), h);
+        return out;
+    }
+
+    // P + Q with Q affine: madd-2007-bl.
+    Jacobian addMixed(const Jacobian &P, const Precomputed &Q) const {
+        if (isInfinity(P)) return {Q.x, Q.y, field.one()};
+        Int z1z1 = field.sqr(P.Z);
+        Int u2 = field.mul(Q.x, z1z1), s2 = field.mul(Q.y, field.mul(P.Z, z1z1));
+        Int h = sub(u2, P.X), r = twice(sub(s2, P.Y));
+        if (h.isZero()) return r.isZero() ? dbl(P) : infinity();
+        Int hh = field.sqr(h), i = twice(twice(hh)), j = field.mul(h, i), v = field.mul(P.X, i);
+        Jacobian out;
+        out.X = sub(sub(field.sqr(r), j), twice(v));
+        out.Y = sub(field.mul(r, sub(v, out.X)), twice(field.mul(P.Y, j)));
+        out.Z = sub(sub(field.sqr(add(P.Z, h)), z1z1), hh);
+        return out;
+    }
+
+    // --- Scalar multiplication ---
+
+    // Textbook affine double-and-add: an inversion in every step. Reference only.
+    Affine mulAffine(const Affine &P, const Int &k) const {
+        Affine r;
+        for (std::size_t i = k.bitLength(); i-- > 0;) {
+            r = affineAdd(r, r);
+            if (k.bit(i)) r = affineAdd(r, P);
+        }
+        return r;
+    }
+
+    // Left-to-right double-and-add in Jacobian coordinates, mixed additions of P.
+    Jacobian mulDoubleAdd(const Affine &P, const Int &k) const {
+        if (P.infinity) return infinity();
+        Precomputed pm = precompute(P);
+        Jacobian r = infinity();
+        for (std::size_t i = k.bitLength(); i-- > 0;) {
+            r = dbl(r);
+            if (k.bit(i)) r = addMixed(r, pm);
+        }
+        return r;
+    }
+
+    // Width-w NAF, 2 <= w <= 8.
+    Jacobian mulWnaf(const Affine &P, const Int &k, int w = WNAF_WIDTH) const {
+        if (w < 2 || w > 8) throw std::invalid_argument("EC: wNAF width must be in [2, 8]");
+        if (P.infinity) return infinity();
+        std::vector<Jacobian> odd(std::size_t(1) << (w - 2)); // P, 3P, 5P, ...
+        odd[0] = toJacobian(P);
+        Jacobian twoP = dbl(odd[0]);
+        for (std::size_t i = 1; i < odd.size(); i++) odd[i] = add(odd[i - 1], twoP);
+        int8_t digits[Int::BITS + 1];
+        std::size_t len = wnaf(k, w, digits);
+        Jacobian r = infinity();
+        for (std::size_t i = len; i-- > 0;) {
+            r = dbl(r);
+            if (digits[i] > 0) r = add(r, odd[std::size_t(digits[i] / 2)]);
+            else if (digits[i] < 0) r = add(r, negate(odd[std::size_t(-digits[i] / 2)]));
+        }
+        return r;
+    }
+
+    // Montgomery ladder: one addition and one doubling per bit of n whatever
+    // the scalar. k + n or k + 2n (the same multiple of P) has its top bit at
+    // position bitLength(n), so the bit count is fixed and the ladder can
+    // start from (P, 2P) without touching the point at infinity.
+    Jacobian mulLadder(const Affine &P, const Int &k) const {
+        if (P.infinity) return infinity();
+        using Wide = modmath::BigInt<LIMBS + 1>;
+        const std::size_t top = n.bitLength();
+        Wide nw = modmath::resize<LIMBS + 1>(n);
+        Wide s1 = reduceScalar(k), s2;
+        s1.add(nw);
+        s2 = s1;
+        s2.add(nw);
+        Wide s = Wide::select(0 - uint64_t(s1.bit(top)), s1, s2);
+        Jacobian r0 = toJacobian(P), r1 = dbl(r0);
+        for (std::size_t i = top; i-- > 0;) {
+            uint64_t mask = 0 - uint64_t(s.bit(i));
+            conditionalSwap(mask, r0, r1);
+            r1 = add(r0, r1);
+            r0 = dbl(r0);
+            conditionalSwap(mask, r0, r1);
+        }
+        return r0;
+    }
+
+    Affine mul(const Affine &P, const Int &k) const { return toAffine(mulWnaf(P, k)); }
+
+    // --- Multi-scalar multiplication ---
+
+    // sum k_i * P_i by Straus: one doubling chain, one wNAF digit stream per point.
+    Jacobian msmStraus(const std::vector<Affine> &points, const std::vector<Int> &scalars, int w = WNAF_WIDTH) const {
+        checkBatch(points, scalars);
+        if (w < 2 || w > 8) throw std::invalid_argument("EC: wNAF width must be in [2, 8]");
+        const std::size_t T = std::size_t(1) << (w - 2), N = points.size(), STRIDE = Int::BITS + 1;
+        std::vector<Jacobian> odd(N * T, infinity());
+        std::vector<int8_t> digits(N * STRIDE, 0);
+        std::size_t top = 0;
+        for (std::size_t i = 0; i < N; i++) {
+            if (points[i].infinity) continue; // its digits stay zero
+            odd[i * T] = toJacobian(points[i]);
+            Jacobian twoP = dbl(odd[i * T]);
+            for (std::size_t j = 1; j < T; j++) odd[i * T + j] = add(odd[i * T + j - 1], twoP);
+            top = std::max(top, wnaf(scalars[i], w, &digits[i * STRIDE]));
+        }
+        std::vector<Precomputed> table = precomputeBatch(odd);
+        Jacobian r = infinity();
+        for (std::size_t bit = top; bit-- > 0;) {
+            r = dbl(r);
+            for (std::size_t i = 0; i < N; i++) {
+                int d = digits[i * STRIDE + bit];
+                if (d > 0) r = addMixed(r, table[i * T + std::size_t(d / 2)]);
+                else if (d < 0) r = addMixed(r, negate(table[i * T + std::size_t(-d / 2)]));
+            }
+        }
+        return r;
+    }
+
+    // sum k_i * P_i by Pippenger's bucket method with c-bit windows (0: pick c from N).
+    Jacobian msmPippenger(const std::vector<Affine> &points, const std::vector<Int> &scalars, int c = 0) const {
+        checkBatch(points, scalars);
+        const std::size_t N = points.size();
+        std::size_t bits = 0;
+        for (const Int &k : scalars) bits = std::max(bits, k.bitLength());
+        if (c == 0) c = int(pippengerWindow(N, bits));
+        if (c < 1 || c > 16) throw std::invalid_argument("EC: Pippenger window must be in [1, 16]");
+        std::vector<Precomputed> pre(N);
+        for (std::size_t i = 0; i < N; i++)
+            if (!points[i].infinity) pre[i] = precompute(points[i]);
+        std::vector<Jacobian> buckets(std::size_t(1) << c);
+        Jacobian r = infinity();
+        for (std::size_t win = (bits + std::size_t(c) - 1) / std::size_t(c); win-- > 0;) {
+            for (int i = 0; i < c; i++) r = dbl(r);
+            std::fill(buckets.begin(), buckets.end(), infinity());
+            for (std::size_t i = 0; i < N; i++) {
+                uint64_t d = scalars[i].bits(win * std::size_t(c), std::size_t(c));
+                if (d && !points[i].infinity) buckets[d] = addMixed(buckets[d], pre[i]);
+            }
+            // sum_d d * bucket[d] as a running sum from the top bucket down.
+            Jacobian running = infinity(), total = infinity();
+            for (std::size_t d = buckets.size(); d-- > 1;) {
+                running = add(running, buckets[d]);
+                total = add(total, running);
+            }
+            r = add(r, total);
+        }
+        return r;
+    }
+
+    // sum k_i * P_i by Straus or Pippenger, whichever needs fewer group operations.
+    Jacobian multiScalarMul(const std::vector<Affine> &points, const std::vector<Int> &scalars) const {
+        std::size_t bits = 0;
+        for (const Int &k : scalars) bits = std::max(bits, k.bitLength());
+        return pippengerCost(points.size(), bits, pippengerWindow(points.size(), bits)) <
+                       strausCost(points.size(), bits)
+                   ? msmPippenger(points, scalars)
+                   : msmStraus(points, scalars);
+    }
+
+    // Operation counts behind multiScalarMul(): additions plus doublings.
+    static double strausCost(std::size_t n, std::size_t bits) {
+        return double(n) * (double(bits) / (WNAF_WIDTH + 1) + double(1 << (WNAF_WIDTH - 2))) + double(bits);
+    }
+    static double pippengerCost(std::size_t n, std::size_t bits, std::size_t c) {
+        return double((bits + c - 1) / c) * (double(n) + 2.0 * double(std::size_t(1) << c)) + double(bits);
+    }
+    static std::size_t pippengerWindow(std::size_t n, std::size_t bits) {
+        std::size_t best = 1;
+        for (std::size_t c = 2; c <= 16; c++)
+            if (pippengerCost(n, bits, c) < pippengerCost(n, bits, best)) best = c;
+        return best;
+    }
+
+    // d * G through the comb tables (built on the first call).
+    Affine mulBase(const Int &d) const { return toAffine(comb().mul(d >= n ? modmath::mod(d, n) : d)); }
+
+    const EcFixedBaseComb<LIMBS> &comb() const {
+        std::call_once(combOnce, [this] { combTable = std::make_unique<EcFixedBaseComb<LIMBS>>(*this, g, n.bitLength()); });
+        return *combTable;
+    }
+
+    // --- ECDH ---
+
+    // A uniformly random private key in [1, n - 1].
+    Int randomPrivateKey(std::mt19937_64 &rng) const {
+        const std::size_t nBits = n.bitLength();
+        Int d;
+        do {
+            for (auto &limb : d.limb) limb = rng();
+            for (std::size_t i = nBits; i < Int::BITS; i++) d.limb[i / 64] &= ~(uint64_t(1) << (i % 64));
+        } while (d.isZero() || d >= n);
+        return d;
+    }
+
+    // Q = d * G, through the comb unless the constant-time ladder is asked for.
+    Affine publicKey(const Int &d, modmath::ExpMode mode = modmath::ExpMode::SlidingWindow) const {
+        instrument::Scope timer(instrument::Probe::EcdhKeygen);
+        if (mode == modmath::ExpMode::ConstantTime) return toAffine(mulLadder(g, d), mode);
+        return mulBase(d);
+    }
+
+    // d * G by wNAF on G like any other point, for comparison.
+    Affine publicKeyGeneric(const Int &d) const { return mul(g, d); }
+
+    // A finite point on the curve with coordinates below p. The curves here
+    // have cofactor 1, so that already puts it in the group of order n.
+    bool validPublic(const Affine &Q) const { return !Q.infinity && onCurve(Q); }
+
+    // x(d * peer); throws on a peer point that is not a valid public key.
+    Int sharedSecret(const Affine &peer, const Int &d, modmath::ExpMode mode = modmath::ExpMode::SlidingWindow) const {
+        if (!validPublic(peer)) throw std::invalid_argument("EC: peer public key is not on the curve");
+        instrument::Scope timer(instrument::Probe::EcdhShared);
+        Affine s = mode == modmath::ExpMode::ConstantTime ? toAffine(mulLadder(peer, d), mode) : mul(peer, d);
+        if (s.infinity) throw std::invalid_argument("EC: shared point is the point at infinity");
+        return s.x;
+    }
+
+private:
+    enum class AShape { Zero, MinusThree, Generic };
+
+    // Field addition and subtraction pick the reduced value with a mask, so
+    // the ladder's timing does not depend on the values it adds.
+    Int add(const Int &a, const Int &b) const {
+        Int r = a, d;
+        uint64_t carry = r.add(b);
+        d = r;
+        uint64_t borrow = d.sub(p);
+        return Int::select(0 - (borrow & (carry ^ 1)), r, d); // keep r when a + b < p
+    }
+
+    Int sub(const Int &a, const Int &b) const {
+        Int r = a, d;
+        uint64_t borrow = r.sub(b);
+        d = r;
+        d.add(p);
+        return Int::select(0 - borrow, d, r);
+    }
+
+    Precomputed negate(const Precomputed &P) const { return {P.x, sub(Int(), P.y)}; }
+
+    static void checkBatch(const std::vector<Affine> &points, const std::vector<Int> &scalars) {
+        if (points.size() != scalars.size()) throw std::invalid_argument("EC: one scalar per point");
+    }
+
+    // Z^-1 of every finite point with a single inversion; entries for O are left zero.
+    void inverseZ(const Jacobian *points, std::size_t n, Int *inv) const {
+        Int acc = field.one();
+        for (std::size_t i = 0; i < n; i++) {
+            inv[i] = Int();
+            if (isInfinity(points[i])) continue;
+            inv[i] = acc; // product of the earlier Z
+            acc = field.mul(acc, points[i].Z);
+        }
+        Int t = inverse(acc); // inverse of the product of all Z
+        for (std::size_t i = n; i-- > 0;) {
+            if (isInfinity(points[i])) continue;
+            inv[i] = field.mul(inv[i], t);
+            t = field.mul(t, points[i].Z);
+        }
+    }
+
+    // k mod n one bit at a time, every bit with a masked subtraction, so the
+    // time does not depend on k. r stays below n, and 2r + 1 fits the extra limb.
+    modmath::BigInt<LIMBS + 1> reduceScalar(const Int &k) const {
+        using Wide = modmath::BigInt<LIMBS + 1>;
+        Wide nw = modmath::resize<LIMBS + 1>(n), r, d;
+        for (std::size_t i = Int::BITS; i-- > 0;) {
+            r.shiftLeft1();
+            r.limb[0] |= uint64_t(k.bit(i));
+            d = r;
+            uint64_t borrow = d.sub(nw);
+            r = Wide::select(0 - borrow, r, d); // keep r when r < n
+        }
+        return r;
+    }
+
+    void conditionalSwap(uint64_t mask, Jacobian &a, Jacobian &b) const {
+        Jacobian t = a;
+        a = {Int::select(mask, b.X, a.X), Int::select(mask, b.Y, a.Y), Int::select(mask, b.Z, a.Z)};
+        b = {Int::select(mask, t.X, b.X), Int::select(mask, t.Y, b.Y), Int::select(mask, t.Z, b.Z)};
+    }
+
+    Int twice(const Int &a) const { return add(a, a); }
+
+    // Montgomery-form inverse: (aR)^-1 R^2 = a^-1 R.
+    Int inverse(const Int &aM) const { return field.toMont(modmath::modInverse(field.fromMont(aM), p)); }
+
+    // The same by Fermat, (aR)^(p-2) in Montgomery form: the same products for every a.
+    Int inverseConstTime(const Int &aM) const {
+        Int e = p;
+        e.sub(Int(2));
+        return field.modexpConstTime(aM, e);
+    }
+
+    // Affine chord-and-tangent step with one inversion, for mulAffine().
+    Affine affineAdd(const Affine &P, const Affine &Q) const {
+        if (P.infinity) return Q;
+        if (Q.infinity) return P;
+        Int x1 = field.toMont(P.x), y1 = field.toMont(P.y), x2 = field.toMont(Q.x), y2 = field.toMont(Q.y);
+        Int lambda;
+        if (x1 == x2) {
+            if (y1 != y2 || y1.isZero()) return {};
+            Int xx = field.sqr(x1);
+            lambda = field.mul(add(add(xx, twice(xx)), aM), inverse(twice(y1)));
+        } else {
+            lambda = field.mul(sub(y2, y1), inverse(sub(x2, x1)));
+        }
+        Int x3 = sub(sub(field.sqr(lambda), x1), x2);
+        Int y3 = sub(field.mul(lambda, sub(x1, x3)), y1);
+        return {field.fromMont(x3), field.fromMont(y3), false};
+    }
+
+    // Width-w NAF digits of k, least significant first; returns the count.
+    static std::size_t wnaf(const Int &k, int w, int8_t *digits) {
+        modmath::BigInt<LIMBS + 1> v = modmath::resize<LIMBS + 1>(k); // room for the carry of a negative digit
+        const int64_t full = int64_t(1) << w, half = full / 2;
+        std::size_t len = 0;
+        while (!v.isZero()) {
+            int64_t d = 0;
+            if (v.isOdd()) {
+                d = int64_t(v.limb[0] & uint64_t(full - 1));
+                if (d >= half) d -= full;
+                if (d > 0) v.sub(modmath::BigInt<LIMBS + 1>(uint64_t(d)));
+                else v.add(modmath::BigInt<LIMBS + 1>(uint64_t(-d)));
+            }
+            digits[len++] = int8_t(d);
+            v.shiftRight1();
+        }
+        return len;
+    }
+
+    Int p, n;
+    Affine g;
+    modmath::Montgomery<LIMBS> field;
+    Int aM, bM;
+    AShape aShape = AShape::Generic;
+    mutable std::once_flag combOnce;
+    mutable std::unique_ptr<EcFixedBaseComb<LIMBS>> combTable;
+};
+
+// Lim-Lee comb for multiples of one fixed point: the scalar is cut into h
+// rows of a bits and each row into v columns of b bits; table k holds, for
+// each h-bit index i, the sum of 2^(j*a + k*b) * base over the set bits j
+// of i, as affine points for mixed additions.
+template <std::size_t LIMBS>
+class EcFixedBaseComb {
+public:
+    using Curve = EcCurve<LIMBS>;
+    using Int = typename Curve::Int;
+
+    EcFixedBaseComb(const Curve &curve, const typename Curve::Affine &base, std::size_t scalarBits, int teeth = 8,
+                    int tables = 2)
+        : curve(&curve), h(std::size_t(teeth)), v(std::size_t(tables)) {
+        if (teeth < 1 || teeth > 12 || tables < 1) throw std::invalid_argument("comb: unsupported table shape");
+        a = (scalarBits + h - 1) / h;
+        b = (a + v - 1) / v;
+        std::vector<typename Curve::Jacobian> powers(h * a); // 2^m * base
+        powers[0] = curve.toJacobian(base);
+        for (std::size_t m = 1; m < powers.size(); m++) powers[m] = curve.dbl(powers[m - 1]);
+        const std::size_t ENTRIES = std::size_t(1) << h;
+        std::vector<typename Curve::Jacobian> sums(v * ENTRIES);
+        for (std::size_t k = 0; k < v; k++) {
+            typename Curve::Jacobian *t = &sums[k * ENTRIES];
+            t[0] = curve.infinity();
+            for (std::size_t i = 1; i < ENTRIES; i++) {
+                std::size_t j = std::size_t(__builtin_ctzll(i)); // lowest set bit of i
+                std::size_t pos = j * a + k * b;
+                std::size_t rest = i & (i - 1);
+                t[i] = pos < powers.size() ? curve.add(t[rest], powers[pos]) : t[rest];
+            }
+        }
+        table = curve.precomputeBatch(sums); // one inversion; O only in unused entries
+    }
+
+    std::size_t tableBytes() const { return table.size() * sizeof(typename Curve::Precomputed); }
+
+    // k * base for k below 2^scalarBits: b doublings and up to v * b mixed additions.
+    typename Curve::Jacobian mul(const Int &k) const {
+        const std::size_t ENTRIES = std::size_t(1) << h;
+        typename Curve::Jacobian acc = curve->infinity();
+        for (std::size_t col = b; col-- > 0;) {
+            acc = curve->dbl(acc);
+            for (std::size_t t = v; t-- > 0;) {
+                std::size_t offset = t * b + col;
+                if (offset >= a) continue; // the last column of a row can be short
+                std::size_t index = 0;
+                for (std::size_t j = 0; j < h; j++) {
+                    std::size_t pos = j * a + offset;
+                    if (pos < Int::BITS && k.bit(pos)) index |= std::size_t(1) << j;
+                }
+                if (index) acc = curve->addMixed(acc, table[t * ENTRIES + index]);
+            }
+        }
+        return acc;
+    }
+
+private:
+    const Curve *curve;
+    std::size_t h, v, a = 0, b = 0;
+    std::vector<typename Curve::Precomputed> table; // v tables of 2^h entries
+};
+
+// Process-wide curves, built on first use like the MODP groups.
+inline const EcCurve<4> &p256() {
+    static const EcCurve<4> curve(ec_curves::P256);
+    return curve;
+}
+inline const EcCurve<4> &secp256k1() {
+    static const EcCurve<4> curve(ec_curves::SECP256K1);
+    return curve;
+}
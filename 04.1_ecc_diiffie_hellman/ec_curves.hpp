@@ -0,0 +1,43 @@
+#pragma once
+
+/*
+ * Named short-Weierstrass curves y^2 = x^3 + ax + b
+ * -------------------------------------------------
+ * NIST P-256 (FIPS 186-4, D.1.2.3; a = -3) and secp256k1 (SEC 2, 2.4.1;
+ * a = 0). Both have cofactor 1, so every point other than O on the curve
+ * has the prime order n.
+ */
+
+#include <cstddef>
+
+namespace ec_curves {
+
+struct CurveSpec {
+    const char *name;
+    std::size_t bits;
+    const char *prime, *a, *b, *gx, *gy, *order; // hex
+};
+
+inline constexpr CurveSpec P256 = {
+    "P-256",
+    256,
+    "ffffffff00000001000000000000000000000000ffffffffffffffffffffffff",
+    "ffffffff00000001000000000000000000000000fffffffffffffffffffffffc",
+    "5ac635d8aa3a93e7b3ebbd55769886bc651d06b0cc53b0f63bce3c3e27d2604b",
+    "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296",
+    "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5",
+    "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551",
+};
+
+inline constexpr CurveSpec SECP256K1 = {
+    "secp256k1",
+    256,
+    "fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f",
+    "0",
+    "7",
+    "79be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798",
+    "483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8",
+    "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141",
+};
+
+} // namespace ec_curves
@@ -1,4 +1,26 @@
-#include <bits/stdc++.h>
+// To compile and run this code, open a terminal in this folder and run:
+// g++ -O2 -std=c++17 -pthread main.cpp -o main && ./main
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "curve_order.hpp"
+#include "ec.hpp"
+#include "curve_points.hpp"
+#include "point_stream.hpp"
+#include "../common/modmath.hpp"
 using namespace std;
 
 struct Point {
@@ -6,14 +28,19 @@ struct Point {
 };
 
 // Check if point lies on the curve
+// y^2 = x^3 + ax + b (mod p); negative coefficients are reduced into [0, p) first.
 bool isPoint(Point a1, int a, int b, int p) {
-    int y = (1LL * a1.y * a1.y) % p;
-    int x = ((1LL * a1.x * a1.x % p * a1.x % p) + (1LL * a * a1.x % p) + b) % p;
-    return x == y;
+    uint64_t m = p;
+    uint64_t x = modmath::reduceSigned(a1.x, m), y = modmath::reduceSigned(a1.y, m);
+    uint64_t lhs = modmath::mulMod(y, y, m);
+    uint64_t rhs = modmath::mulMod(modmath::mulMod(x, x, m), x, m);
+    rhs = modmath::addMod(rhs, modmath::mulMod(modmath::reduceSigned(a, m), x, m), m);
+    rhs = modmath::addMod(rhs, modmath::reduceSigned(b, m), m);
+    return lhs == rhs;
 }
 
-// Print all points on the curve
-void allPoints(int p, int a, int b) {
+// Print all points on the curve by testing every (x, y) pair: p^2 evaluations.
+void allPointsNaive(int p, int a, int b) {
     for (int i = 0; i < p; i++) {
         for (int j = 0; j < p; j++) {
             Point a2 = {i, j};
@@ -24,17 +51,533 @@ void allPoints(int p, int a, int b) {
     }
 }
 
-int main() {
+struct ListOptions {
+    unsigned threads = 0; // 0: one per hardware thread
+    PointFormat format = PointFormat::Text;
+    FILE *out = stdout;
+};
+
+// Print all points on the curve: one evaluation per x and Tonelli-Shanks for y,
+// split over threads and written in order. Same text as allPointsNaive();
+// moduli that are not odd primes fall back to the pair loop.
+void allPoints(int p, int a, int b, const ListOptions &opt = {}) {
+    if (p < 3 || !modmath::isPrime64(uint64_t(p))) {
+        PointBuffer buf(opt.format);
+        for (int i = 0; i < p; i++) {
+            for (int j = 0; j < p; j++)
+                if (isPoint({i, j}, a, b, p)) buf.add(uint64_t(i), uint64_t(j));
+            if (buf.bytes() > (1 << 20)) {
+                buf.writeTo(opt.out);
+                buf.clear();
+            }
+        }
+        buf.writeTo(opt.out);
+    } else {
+        ThreadPool pool(opt.threads);
+        streamPoints(PointScanner(uint64_t(p), a, b), pool, opt.out, opt.format);
+    }
+    fflush(opt.out);
+}
+
+// Print the number of points on the curve, the point at infinity included,
+// and its factorisation; a usable curve has a large prime factor.
+void countPoints(int64_t p, int64_t a, int64_t b) {
+    uint64_t n = curveOrder(uint64_t(p), a, b);
+    cout << "#E = " << n << " (trace " << int64_t(uint64_t(p) + 1 - n) << ")\n";
+    cout << "#E =";
+    vector<uint64_t> primes = modmath::factor64(n);
+    for (size_t i = 0; i < primes.size();) {
+        size_t j = i;
+        while (j < primes.size() && primes[j] == primes[i]) j++;
+        cout << (i ? " *" : "") << " " << primes[i];
+        if (j - i > 1) cout << "^" << j - i;
+        i = j;
+    }
+    cout << "\n";
+}
+
+// ECDH between two parties on a named curve, with fresh keys.
+void runEcdh(const EcCurve<4> &curve, const string &name) {
+    mt19937_64 rng(random_device{}());
+    auto alicePrivate = curve.randomPrivateKey(rng), bobPrivate = curve.randomPrivateKey(rng);
+    auto alicePublic = curve.publicKey(alicePrivate), bobPublic = curve.publicKey(bobPrivate);
+    cout << "Curve: " << name << "\n";
+    cout << "Alice public key: (" << alicePublic.x.toHex() << ", " << alicePublic.y.toHex() << ")\n";
+    cout << "Bob public key:   (" << bobPublic.x.toHex() << ", " << bobPublic.y.toHex() << ")\n";
+    auto aliceSecret = curve.sharedSecret(bobPublic, alicePrivate);
+    auto bobSecret = curve.sharedSecret(alicePublic, bobPrivate);
+    cout << "Alice's shared secret: " << aliceSecret.toHex() << "\n";
+    cout << "Bob's shared secret:   " << bobSecret.toHex() << "\n";
+    cout << (aliceSecret == bobSecret ? "Shared secrets match.\n" : "Shared secrets DO NOT match.\n");
+}
+
+// --- Self-test ---
+
+// Known answers computed independently: d = SHA-256(curve name) mod n, Q = d * G,
+// and the x of d * (e * G).
+struct EcdhKat {
+    const EcCurve<4> &curve;
+    const char *d, *qx, *qy, *e, *sharedX;
+};
+
+bool checkEcdhKat(const EcdhKat &kat) {
+    using Int = EcCurve<4>::Int;
+    Int d = Int::fromHex(kat.d), e = Int::fromHex(kat.e);
+    auto q = kat.curve.publicKey(d);
+    bool ok = q.x == Int::fromHex(kat.qx) && q.y == Int::fromHex(kat.qy) && kat.curve.validPublic(q);
+    auto ct = modmath::ExpMode::ConstantTime;
+    auto qLadder = kat.curve.publicKey(d, ct);
+    ok = ok && qLadder.x == q.x && qLadder.y == q.y;
+    return ok && kat.curve.sharedSecret(kat.curve.publicKey(e), d) == Int::fromHex(kat.sharedX) &&
+           kat.curve.sharedSecret(q, e) == Int::fromHex(kat.sharedX) &&
+           kat.curve.sharedSecret(kat.curve.publicKey(e, ct), d, ct) == Int::fromHex(kat.sharedX);
+}
+
+// wNAF at every width, Jacobian double-and-add and the affine reference agree.
+bool checkScalarMul(const EcCurve<4> &curve, mt19937_64 &rng) {
+    bool ok = true;
+    auto P = curve.publicKey(curve.randomPrivateKey(rng));
+    for (int i = 0; i < 6 && ok; i++) {
+        auto k = curve.randomPrivateKey(rng);
+        if (i == 0) k = EcCurve<4>::Int(1);
+        auto expect = curve.mulAffine(P, k);
+        auto ladder = curve.toAffine(curve.mulLadder(P, k));
+        ok = curve.toAffine(curve.mulDoubleAdd(P, k)).x == expect.x && ladder.x == expect.x && ladder.y == expect.y;
+        for (int w = 2; w <= 8 && ok; w++) {
+            auto got = curve.toAffine(curve.mulWnaf(P, k, w));
+            ok = !got.infinity && got.x == expect.x && got.y == expect.y;
+        }
+    }
+    // n * G = O and (n - 1) * G = -G.
+    auto n = curve.order(), nm1 = n;
+    nm1.sub(EcCurve<4>::Int(1));
+    // Scalars at and above n go through the ladder's masked reduction, and
+    // the Fermat inverse of toAffine(ConstantTime) matches the binary GCD.
+    EcCurve<4>::Int big, nPlus = n;
+    for (auto &w : big.limb) w = ~uint64_t(0);
+    nPlus.add(EcCurve<4>::Int(5));
+    for (const auto &k : {n, nPlus, big}) {
+        auto expect = curve.toAffine(curve.mulWnaf(P, k));
+        auto jac = curve.mulLadder(P, k);
+        auto ct = curve.toAffine(jac, modmath::ExpMode::ConstantTime), plain = curve.toAffine(jac);
+        ok = ok && ct.infinity == expect.infinity && ct.x == expect.x && ct.y == expect.y && plain.x == ct.x &&
+             plain.y == ct.y;
+    }
+    auto minusG = curve.mul(curve.generator(), nm1);
+    auto yNeg = curve.prime();
+    yNeg.sub(curve.generator().y);
+    return ok && curve.mul(curve.generator(), n).infinity && minusG.x == curve.generator().x && minusG.y == yNeg;
+}
+
+// Comb multiples of G equal wNAF ones, including the ends of the scalar range.
+bool checkComb(const EcCurve<4> &curve, mt19937_64 &rng) {
+    auto nm1 = curve.order();
+    nm1.sub(EcCurve<4>::Int(1));
+    bool ok = true;
+    for (int i = 0; i < 10 && ok; i++) {
+        auto k = i == 0 ? EcCurve<4>::Int(1) : i == 1 ? nm1 : curve.randomPrivateKey(rng);
+        auto comb = curve.publicKey(k), wnaf = curve.publicKeyGeneric(k);
+        ok = comb.x == wnaf.x && comb.y == wnaf.y;
+    }
+    return ok;
+}
+
+// Batch normalisation equals one toAffine() per point; each MSM equals the sum of single products.
+bool checkBatch(const EcCurve<4> &curve, mt19937_64 &rng) {
+    using Curve = EcCurve<4>;
+    vector<Curve::Jacobian> js;
+    for (int i = 0; i < 7; i++) js.push_back(curve.mulWnaf(curve.generator(), curve.randomPrivateKey(rng)));
+    js.insert(js.begin() + 3, curve.infinity());
+    auto batch = curve.toAffineBatch(js);
+    bool ok = batch[3].infinity;
+    for (size_t i = 0; i < js.size() && ok; i++) {
+        auto one = curve.toAffine(js[i]);
+        ok = one.infinity == batch[i].infinity && one.x == batch[i].x && one.y == batch[i].y;
+    }
+    for (size_t n : {1, 5, 40, 300}) {
+        vector<Curve::Affine> pts;
+        vector<Curve::Int> ks;
+        Curve::Jacobian expect = curve.infinity();
+        for (size_t i = 0; i < n; i++) {
+            pts.push_back(i == 2 ? Curve::Affine{} : curve.mulBase(curve.randomPrivateKey(rng)));
+            ks.push_back(i == 1 ? Curve::Int() : curve.randomPrivateKey(rng));
+            expect = curve.add(expect, curve.mulWnaf(pts[i], ks[i]));
+        }
+        auto e = curve.toAffine(expect);
+        for (auto got : {curve.msmStraus(pts, ks), curve.msmPippenger(pts, ks), curve.multiScalarMul(pts, ks)}) {
+            auto g = curve.toAffine(got);
+            ok = ok && g.infinity == e.infinity && g.x == e.x && g.y == e.y;
+        }
+    }
+    return ok;
+}
+
+// Points from the pair loop over isPoint(), for checking the scanner.
+vector<pair<uint64_t, uint64_t>> naivePoints(int p, int a, int b) {
+    vector<pair<uint64_t, uint64_t>> pts;
+    for (int i = 0; i < p; i++)
+        for (int j = 0; j < p; j++)
+            if (isPoint({i, j}, a, b, p)) pts.push_back({uint64_t(i), uint64_t(j)});
+    return pts;
+}
+
+vector<pair<uint64_t, uint64_t>> scannedPoints(uint64_t p, int64_t a, int64_t b, bool bitmap) {
+    vector<pair<uint64_t, uint64_t>> pts;
+    PointScanner(p, a, b, bitmap).scan(0, p, [&](uint64_t x, uint64_t y) { pts.push_back({x, y}); });
+    return pts;
+}
+
+bool selfTest() {
+    bool ok = true;
+    auto report = [&](const string &name, bool pass) {
+        cout << left << setw(38) << name << (pass ? "ok" : "FAILED") << "\n";
+        ok = ok && pass;
+    };
+
+    bool same = true;
+    const int COEFFS[][2] = {{2, 3}, {-1, 0}, {0, 7}, {-3, 5}, {0, 0}, {1, -1}};
+    for (int p = 3; p < 400; p += 2) {
+        if (!modmath::isPrime64(uint64_t(p))) continue;
+        for (auto &c : COEFFS) {
+            auto expect = naivePoints(p, c[0], c[1]);
+            same = same && scannedPoints(uint64_t(p), c[0], c[1], true) == expect &&
+                   scannedPoints(uint64_t(p), c[0], c[1], false) == expect;
+        }
+    }
+    report("scan vs pair loop, primes < 400", same);
+
+    bool onCurve = true;
+    size_t count = 0;
+    const int P = 1000003;
+    PointScanner(P, -3, 7).scan(0, P, [&](uint64_t x, uint64_t y) {
+        onCurve = onCurve && isPoint({int(x), int(y)}, -3, 7, P);
+        count++;
+    });
+    // Hasse: |#E - (p + 1)| <= 2 sqrt(p), with #E counting the point at infinity.
+    report("scan of p = 1000003 on the curve", onCurve && fabs(double(count + 1) - (P + 1)) <= 2 * sqrt(double(P)));
+
+    bool roots = true;
+    mt19937_64 rng(21);
+    for (uint64_t p : {998244353ull, 2305843009213693951ull, 18446744073709551557ull}) { // s = 23, 1, 1
+        modmath::SqrtMod64 sq(p);
+        for (int i = 0; i < 200; i++) {
+            uint64_t v = rng() % p, r;
+            uint64_t square = modmath::mulMod(v, v, p);
+            roots = roots && sq.sqrt(square, r) && modmath::mulMod(r, r, p) == square && sq.legendre(square) >= 0;
+            uint64_t w = rng() % p;
+            bool residue = sq.legendre(w) >= 0;
+            roots = roots && sq.sqrt(w, r) == residue;
+        }
+    }
+    report("Tonelli-Shanks, 30- to 64-bit primes", roots);
+
+    {
+        const int P = 200003;
+        string expect;
+        vector<pair<uint64_t, uint64_t>> pts = scannedPoints(P, -3, 7, true);
+        for (auto &pt : pts) expect += to_string(pt.first) + " " + to_string(pt.second) + "\n";
+        bool same = true;
+        for (PointFormat format : {PointFormat::Text, PointFormat::Binary}) {
+            for (unsigned threads : {1u, 3u}) {
+                FILE *tmp = tmpfile();
+                ThreadPool pool(threads);
+                uint64_t n = streamPoints(PointScanner(P, -3, 7), pool, tmp, format);
+                string got(size_t(ftell(tmp)), '\0');
+                rewind(tmp);
+                same = same && fread(&got[0], 1, got.size(), tmp) == got.size() && n == pts.size();
+                fclose(tmp);
+                if (format == PointFormat::Text) {
+                    same = same && got == expect;
+                } else {
+                    same = same && got.size() == 16 * pts.size();
+                    for (size_t i = 0; i < pts.size() && same; i++) {
+                        uint64_t x, y;
+                        memcpy(&x, &got[16 * i], 8); // little-endian host
+                        memcpy(&y, &got[16 * i + 8], 8);
+                        same = pts[i] == make_pair(x, y);
+                    }
+                }
+            }
+        }
+        report("ordered output, 1 and 3 threads", same);
+    }
+    {
+        bool digits = true;
+        char text[24];
+        for (uint64_t v : {0ull, 7ull, 10ull, 99ull, 100ull, 4294967296ull, 18446744073709551615ull})
+            digits = digits && string(text, formatDecimal(text, v)) == to_string(v);
+        report("decimal formatter", digits);
+    }
+    {
+        bool same = true;
+        for (uint64_t p = BSGS_MIN_P + 1; p < BSGS_MIN_P + 400; p += 2) {
+            if (!modmath::isPrime64(p)) continue;
+            for (auto &c : COEFFS) {
+                if (c[0] == 0 && c[1] == 0) continue; // singular
+                uint64_t count = 1;
+                PointScanner(p, c[0], c[1]).scan(0, p, [&](uint64_t, uint64_t) { count++; });
+                same = same && curveOrder(p, c[0], c[1]) == count;
+            }
+        }
+        report("BSGS count vs scan, p near 2^16", same);
+    }
+    {
+        // N * P = O on E and (2p + 2 - N) * P = O on the twist, for random P.
+        bool annihilates = true;
+        mt19937_64 pts(23);
+        for (uint64_t p : {1000000007ull, 2305843009213693951ull, 4611686018427387847ull}) {
+            uint64_t n = curveOrder(p, -3, 5);
+            modmath::SqrtMod64 roots(p);
+            uint64_t d = 2;
+            while (roots.legendre(d) != -1) d++;
+            uint64_t a = p - 3, d2 = modmath::mulMod(d, d, p);
+            SmallCurve e(p, a, 5), twist(p, modmath::mulMod(a, d2, p), modmath::mulMod(5, modmath::mulMod(d2, d, p), p));
+            for (int i = 0; i < 4; i++) {
+                CurvePoint P = e.randomPoint(pts, roots), Q = twist.randomPoint(pts, roots);
+                annihilates = annihilates && e.contains(P) && e.mul(P, n).infinity && twist.mul(Q, 2 * p + 2 - n).infinity;
+            }
+        }
+        report("BSGS count, 30- to 62-bit primes", annihilates);
+    }
+    {
+        bool factors = true;
+        for (uint64_t n : {1ull, 2ull, 97ull, 561ull, 1ull << 40, 999999000001ull * 3, 4611686014132420609ull,
+                           18446744073709551615ull}) {
+            uint64_t product = 1;
+            for (uint64_t q : modmath::factor64(n)) {
+                factors = factors && modmath::isPrime64(q);
+                product *= q;
+            }
+            factors = factors && product == n;
+        }
+        report("Pollard rho factorisation", factors);
+    }
+    report("P-256 ECDH known answer", checkEcdhKat({p256(),
+        "7985ebd3da40d5187d6d3ef3d626abf3c2b81c285ffb4e73104a472066c443b9",
+        "30af58b087f0183425203c072b3a70e871e3b99be1f43c6fc5418842810c4001",
+        "a5f0eb9940d92f397adc4d984893e11ceda12cc0361ef4069196bb5a14011c5e",
+        "1c51d1c265bcb0aac80251590d9b790c54e16d9cd366cae05e5e49920615527c",
+        "1025b9c2e43bb56feb0136094eb6d043f729be963c23fd8dd97d02ad27d2b76d"}));
+    report("secp256k1 ECDH known answer", checkEcdhKat({secp256k1(),
+        "6ab9f1eb8f7d3388f4f9d586f66e99fd54080df2c446f0e58668b09c08a16dd0",
+        "669b8afcec803a0d323e9a17f3ea8e68e8abe5a278020a929adbec52421adbd0",
+        "aab114c000d9df3220ded4a4576d29024f5c2b709ec3573ac96f9e768f8648ed",
+        "58e08f69ba8386e2db875b1a2d92734a4c9c4f62e44962fd29e59a546fadb366",
+        "f373e9e28a78656253134fb8d4a50c6b2b26a0779829fe09c6ea4ededebdcc7a"}));
+    report("wNAF, ladder, double-and-add, affine", checkScalarMul(p256(), rng) && checkScalarMul(secp256k1(), rng));
+    report("fixed-base comb vs wNAF", checkComb(p256(), rng) && checkComb(secp256k1(), rng));
+    report("batch affine, Straus, Pippenger", checkBatch(p256(), rng) && checkBatch(secp256k1(), rng));
+    {
+        auto q = p256().publicKey(p256().randomPrivateKey(rng));
+        auto offCurve = q, outOfRange = q;
+        offCurve.y.limb[0] ^= 1;
+        outOfRange.x.add(p256().prime());
+        bool rejected = !p256().validPublic(offCurve) && !p256().validPublic(outOfRange) &&
+                        !p256().validPublic(EcCurve<4>::Affine{});
+        try {
+            p256().sharedSecret(offCurve, EcCurve<4>::Int(5));
+            rejected = false;
+        } catch (const invalid_argument &) {
+        }
+        report("ECDH rejects invalid peer keys", rejected);
+    }
+    report("Miller-Rabin, 64-bit", modmath::isPrime64(18446744073709551557ull) &&
+                                     !modmath::isPrime64(3215031751ull) && !modmath::isPrime64(1ull << 61) &&
+                                     modmath::isPrime64(2305843009213693951ull) && !modmath::isPrime64(561));
+    return ok;
+}
+
+// --- Throughput ---
+template <class F>
+double benchRow(const string &name, F &&f, double opsPerCall = 1, const char *unit = "ops/s") {
+    size_t calls = 0;
+    auto start = chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        f();
+        calls++;
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.5);
+    cout << left << setw(38) << name << right << setw(14) << fixed << setprecision(1)
+         << calls * opsPerCall / seconds << " " << unit << "\n";
+    return calls * opsPerCall / seconds;
+}
+
+void runBench() {
+    volatile uint64_t sink = 0;
+    const int SMALL = 2003;
+    benchRow("pair loop, p = 2003", [&] {
+        for (int i = 0; i < SMALL; i++)
+            for (int j = 0; j < SMALL; j++) sink = sink + isPoint({i, j}, 2, 3, SMALL);
+    }, SMALL, "x values/s");
+    for (uint64_t p : {2003ull, 1000003ull, 100000007ull}) {
+        for (bool bitmap : {true, false}) {
+            if (!bitmap && p > 1000003) continue; // a Tonelli-Shanks run per x: seconds at 10^8
+            PointScanner scanner(p, 2, 3, bitmap);
+            string name = "scan, p = " + to_string(p) + (bitmap ? " (bitmap)" : " (no bitmap)");
+            benchRow(name, [&] { scanner.scan(0, p, [&](uint64_t x, uint64_t y) { sink = sink + x + y; }); }, double(p),
+                     "x values/s");
+        }
+    }
+
+    // Listing to /dev/null: formatting and writing on top of the scan.
+    const uint64_t P = 1000003;
+    PointScanner scanner(P, 2, 3);
+    ofstream devNull("/dev/null");
+    FILE *null = fopen("/dev/null", "wb");
+    benchRow("list with ostream <<, p = 1000003", [&] {
+        scanner.scan(0, P, [&](uint64_t x, uint64_t y) { devNull << x << " " << y << "\n"; });
+    }, double(P), "x values/s");
+    ThreadPool single(1), all(0);
+    benchRow("streamPoints text, 1 thread", [&] { streamPoints(scanner, single, null); }, double(P), "x values/s");
+    benchRow("streamPoints binary, 1 thread", [&] { streamPoints(scanner, single, null, PointFormat::Binary); },
+             double(P), "x values/s");
+    if (all.size() > 1)
+        benchRow("streamPoints text, " + to_string(all.size()) + " threads", [&] { streamPoints(scanner, all, null); },
+                 double(P), "x values/s");
+    fclose(null);
+
+    mt19937_64 rng(24);
+    for (auto [curve, name] : {pair<const EcCurve<4> *, string>{&p256(), "P-256"}, {&secp256k1(), "secp256k1"}}) {
+        auto P = curve->publicKeyGeneric(curve->randomPrivateKey(rng)), G = curve->generator();
+        auto k = curve->randomPrivateKey(rng);
+        benchRow(name + " k*P affine (inversions)", [&] { k.limb[0] ^= curve->mulAffine(P, k).x.limb[0] & 1; });
+        benchRow(name + " k*P Jacobian dbl-and-add", [&] { k.limb[0] ^= curve->mulDoubleAdd(P, k).X.limb[0] & 1; });
+        benchRow(name + " k*P Jacobian wNAF-5", [&] { k.limb[0] ^= curve->toAffine(curve->mulWnaf(P, k)).x.limb[0] & 1; });
+        benchRow(name + " k*P Montgomery ladder", [&] {
+            k.limb[0] ^= curve->toAffine(curve->mulLadder(P, k), modmath::ExpMode::ConstantTime).x.limb[0] & 1;
+        });
+        auto start = chrono::steady_clock::now();
+        size_t bytes = curve->comb().tableBytes();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << left << setw(38) << name + " comb table build" << right << setw(14) << fixed << setprecision(1) << ms
+             << " ms  (" << bytes / 1024 << " KiB)\n";
+        benchRow(name + " k*G comb", [&] { k.limb[0] ^= curve->mulBase(k).x.limb[0] & 1; });
+        benchRow(name + " k*G double-and-add", [&] { k.limb[0] ^= curve->toAffine(curve->mulDoubleAdd(G, k)).x.limb[0] & 1; });
+        benchRow(name + " ECDH keygen (comb)", [&] { P = curve->publicKey(curve->randomPrivateKey(rng)); });
+        benchRow(name + " ECDH keygen (ladder)", [&] {
+            P = curve->publicKey(curve->randomPrivateKey(rng), modmath::ExpMode::ConstantTime);
+        });
+        benchRow(name + " ECDH shared secret (wNAF)", [&] { k.limb[1] ^= curve->sharedSecret(P, k).limb[0] & 1; });
+        benchRow(name + " ECDH shared secret (ladder)", [&] {
+            k.limb[1] ^= curve->sharedSecret(P, k, modmath::ExpMode::ConstantTime).limb[0] & 1;
+        });
+    }
+
+    // Batches on P-256: normalising many points, and sums of many products.
+    {
+        using Curve = EcCurve<4>;
+        const Curve &curve = p256();
+        vector<Curve::Jacobian> js;
+        for (int i = 0; i < 1000; i++) js.push_back(curve.mulWnaf(curve.generator(), curve.randomPrivateKey(rng)));
+        benchRow("P-256 toAffine x1000, one by one", [&] {
+            for (auto &j : js) sink = sink + curve.toAffine(j).x.limb[0];
+        }, 1000, "points/s");
+        benchRow("P-256 toAffineBatch x1000", [&] { sink = sink + curve.toAffineBatch(js)[999].x.limb[0]; }, 1000,
+                 "points/s");
+        for (size_t n : {16, 128, 1024}) {
+            vector<Curve::Affine> pts;
+            vector<Curve::Int> ks;
+            for (size_t i = 0; i < n; i++) {
+                pts.push_back(curve.mulBase(curve.randomPrivateKey(rng)));
+                ks.push_back(curve.randomPrivateKey(rng));
+            }
+            string suffix = ", N = " + to_string(n);
+            benchRow("P-256 sum of wNAF muls" + suffix, [&] {
+                Curve::Jacobian r = curve.infinity();
+                for (size_t i = 0; i < n; i++) r = curve.add(r, curve.mulWnaf(pts[i], ks[i]));
+                sink = sink + r.X.limb[0];
+            }, double(n), "terms/s");
+            benchRow("P-256 MSM Straus" + suffix, [&] { sink = sink + curve.msmStraus(pts, ks).X.limb[0]; }, double(n),
+                     "terms/s");
+            benchRow("P-256 MSM Pippenger" + suffix, [&] { sink = sink + curve.msmPippenger(pts, ks).X.limb[0]; },
+                     double(n), "terms/s");
+        }
+    }
+
+    for (uint64_t p : {1000003ull, 2147483647ull, 1099511627791ull, 1125899906842597ull, 2305843009213693951ull}) {
+        auto start = chrono::steady_clock::now();
+        uint64_t n = curveOrder(p, -3, 5);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << left << setw(38) << "count, p ~ 2^" + to_string(64 - __builtin_clzll(p)) << right << setw(14) << fixed
+             << setprecision(1) << ms << " ms  (#E = " << n << ")\n";
+    }
+}
+
+const char *USAGE =
+    "usage: main [--naive | --threads N] [--binary] | --count | --ecdh [p256|secp256k1] | --selftest | --bench\n";
+
+int main(int argc, char *argv[]) {
+    bool naive = false, count = false;
+    ListOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--selftest") return selfTest() ? 0 : 1;
+        if (arg == "--bench") {
+            runBench();
+            return 0;
+        }
+        if (arg == "--ecdh") {
+            string curve = i + 1 < argc ? argv[i + 1] : "p256";
+            if (curve == "p256") runEcdh(p256(), "P-256");
+            else if (curve == "secp256k1") runEcdh(secp256k1(), "secp256k1");
+            else {
+                cerr << "unknown curve " << curve << " (p256 or secp256k1)\n";
+                return 1;
+            }
+            return 0;
+        }
+        if (arg == "--naive") naive = true;
+        else if (arg == "--count") count = true;
+        else if (arg == "--binary") opt.format = PointFormat::Binary;
+        else if (arg == "--threads" && i + 1 < argc) {
+            try {
+                opt.threads = parseThreadCount(argv[++i]);
+            } catch (const invalid_argument &) {
+                cerr << USAGE;
+                return 1;
+            }
+        } else {
+            cerr << USAGE;
+            return 1;
+        }
+    }
+
+    if (count) { // p up to 2^62, beyond the int the listing reads
+        long long a, b, p;
+        cout << "Enter a: ";
+        cin >> a;
+        cout << "Enter b: ";
+        cin >> b;
+        cout << "Enter p: ";
+        cin >> p;
+        try {
+            countPoints(p, a, b);
+        } catch (const exception &e) {
+            cerr << e.what() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Binary records own stdout; the prompts move to stderr.
+    ostream &prompt = opt.format == PointFormat::Binary ? cerr : cout;
     int a, b, p;
-    cout << "Enter a: ";
+    prompt << "Enter a: ";
     cin >> a;
-    cout << "Enter b: ";
+    prompt << "Enter b: ";
     cin >> b;
-    cout << "Enter p: ";
+    prompt << "Enter p: ";
     cin >> p;
 
-    cout << "All Points on the curve are:\n";
-    allPoints(p, a, b);
+    prompt << "All Points on the curve are:\n";
+    if (naive && opt.format == PointFormat::Text) allPointsNaive(p, a, b);
+    else if (naive) {
+        cerr << "--naive prints text only\n";
+        return 1;
+    } else {
+        allPoints(p, a, b, opt);
+    }
 
     return 0;
 }
@@ -0,0 +1,126 @@
+#pragma once
+
+/*
+ * Parallel point listing with ordered, buffered output
+ * ----------------------------------------------------
+ * Once the scan is linear, printing dominates: a stream insertion per
+ * number costs more than the Tonelli-Shanks run behind it. streamPoints()
+ * cuts the x range into chunks of STREAM_CHUNK values and fills one
+ * PointBuffer per chunk on the ThreadPool. Each window of chunks is then
+ * written out in x order with one fwrite() per chunk, so the output is
+ * byte-for-byte the single-threaded listing whatever the thread count.
+ *
+ * Formats:
+ *   Text    "x y\n" per point, digits produced two at a time from a table.
+ *   Binary  x and y as little-endian uint64, 16 bytes per point.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "curve_points.hpp"
+#include "../common/instrument.hpp"
+#include "../common/thread_pool.hpp"
+
+enum class PointFormat { Text, Binary };
+
+// Writes the decimal digits of v at out and returns the end.
+inline char *formatDecimal(char *out, uint64_t v) {
+    static const char PAIRS[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                "8081828384858687888990919293949596979899";
+    char tmp[20];
+    char *end = tmp + sizeof tmp, *p = end;
+    while (v >= 100) {
+        std::memcpy(p -= 2, PAIRS + 2 * (v % 100), 2);
+        v /= 100;
+    }
+    if (v >= 10) std::memcpy(p -= 2, PAIRS + 2 * v, 2);
+    else *--p = char('0' + v);
+    std::size_t n = std::size_t(end - p);
+    std::memcpy(out, p, n);
+    return out + n;
+}
+
+class PointBuffer {
+public:
+    static constexpr std::size_t MAX_RECORD = 42; // two 20-digit numbers, a space and a newline
+
+    explicit PointBuffer(PointFormat format = PointFormat::Text) : format(format) {}
+
+    void add(uint64_t x, uint64_t y) {
+        if (data.size() - used < MAX_RECORD) {
+            instrument::count(instrument::Counter::Allocations);
+            data.resize(std::max<std::size_t>(2 * data.size(), 1 << 16));
+        }
+        char *out = data.data() + used;
+        if (format == PointFormat::Text) {
+            out = formatDecimal(out, x);
+            *out++ = ' ';
+            out = formatDecimal(out, y);
+            *out++ = '\n';
+        } else {
+            for (int i = 0; i < 8; i++) out[i] = char(x >> (8 * i));
+            for (int i = 0; i < 8; i++) out[8 + i] = char(y >> (8 * i));
+            out += 16;
+        }
+        used = std::size_t(out - data.data());
+        count++;
+    }
+
+    std::size_t bytes() const { return used; }
+    uint64_t points() const { return count; }
+
+    void clear() {
+        used = 0;
+        count = 0;
+    }
+
+    void writeTo(std::FILE *out) const {
+        if (used && std::fwrite(data.data(), 1, used, out) != used) throw std::runtime_error("points: write failed");
+    }
+
+private:
+    PointFormat format;
+    std::vector<char> data;
+    std::size_t used = 0;
+    uint64_t count = 0;
+};
+
+// x values per buffer: large enough that a chunk's start-up (three products
+// for the finite differences) and its fwrite() are noise, small enough that
+// a window of them stays a few MiB.
+inline constexpr uint64_t STREAM_CHUNK = uint64_t(1) << 15;
+
+// Writes every point of the curve to `out` in x order; returns the number of points.
+inline uint64_t streamPoints(const PointScanner &scanner, ThreadPool &pool, std::FILE *out,
+                             PointFormat format = PointFormat::Text) {
+    const uint64_t p = scanner.modulus();
+    const std::size_t window = 4 * std::size_t(pool.size());
+    std::vector<PointBuffer> buffers(window, PointBuffer(format));
+    uint64_t total = 0;
+    for (uint64_t base = 0; base < p;) {
+        uint64_t left = p - base;
+        std::size_t chunks = std::size_t(std::min<uint64_t>(window, left / STREAM_CHUNK + (left % STREAM_CHUNK != 0)));
+        pool.parallelFor(chunks, 1, [&](std::size_t begin, std::size_t end, unsigned) {
+            for (std::size_t c = begin; c < end; c++) {
+                PointBuffer &buf = buffers[c];
+                buf.clear();
+                uint64_t x0 = base + c * STREAM_CHUNK;
+                uint64_t x1 = p - x0 > STREAM_CHUNK ? x0 + STREAM_CHUNK : p;
+                scanner.scan(x0, x1, [&](uint64_t x, uint64_t y) { buf.add(x, y); });
+            }
+        });
+        for (std::size_t c = 0; c < chunks; c++) {
+            buffers[c].writeTo(out);
+            total += buffers[c].points();
+        }
+        base = left > chunks * STREAM_CHUNK ? base + chunks * STREAM_CHUNK : p;
+    }
+    return total;
+}
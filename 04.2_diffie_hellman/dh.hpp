@@ -0,0 +1,197 @@
+#pragma once
+
+/*
+ * Diffie-Hellman over MODP groups
+ * -------------------------------
+ * DhGroup<LIMBS> holds a prime p, the generator g and the Montgomery
+ * context for p. The other party's half of the exchange, peer^x mod p,
+ * has a different base every time and uses the generic sliding-window
+ * modexp. Our public value g^x mod p always has the same base, so it goes
+ * through a fixed-base comb built once per group:
+ *
+ *   Lim-Lee comb. Cut the t-bit exponent into h rows of a = t/h bits, and
+ *   every row into v columns of b = a/v bits. Table k holds, for each h-bit
+ *   index i, the product of g^(2^(j*a + k*b)) over the set bits j of i.
+ *   One pass over the b bit positions then needs b squarings and v*b
+ *   products, against roughly t squarings for a generic modexp.
+ *
+ * With h = 8 and v = 2 a 2048-bit exponent takes 128 squarings and 256
+ * products. The tables hold v * 2^h = 512 entries, 128 KiB at 2048 bits.
+ * They are built on first use, under std::call_once, so a group shared
+ * by many threads builds them once.
+ *
+ * The comb picks table entries by exponent bits, like the sliding window.
+ * ExpMode::ConstantTime routes both directions through the fixed-window
+ * constant-time modexp instead.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../common/modmath.hpp"
+#include "dh_groups.hpp"
+
+template <std::size_t LIMBS>
+class FixedBaseComb {
+public:
+    using Int = modmath::BigInt<LIMBS>;
+
+    // Tables for base^e with e below 2^expBits; `teeth` is h, `tables` is v.
+    FixedBaseComb(const modmath::Montgomery<LIMBS> &mont, const Int &base, std::size_t expBits, int teeth = 8,
+                  int tables = 2)
+        : mont(&mont), h(std::size_t(teeth)), v(std::size_t(tables)) {
+        if (teeth < 1 || teeth > 12 || tables < 1) throw std::invalid_argument("comb: unsupported table shape");
+        a = (expBits + h - 1) / h;
+        b = (a + v - 1) / v;
+        // powers[m] = base^(2^m) in Montgomery form, for every bit position used.
+        std::vector<Int> powers(h * a);
+        powers[0] = mont.toMont(base);
+        for (std::size_t m = 1; m < powers.size(); m++) powers[m] = mont.sqr(powers[m - 1]);
+        const std::size_t ENTRIES = std::size_t(1) << h;
+        table.resize(v * ENTRIES);
+        for (std::size_t k = 0; k < v; k++) {
+            Int *t = &table[k * ENTRIES];
+            t[0] = mont.one();
+            for (std::size_t i = 1; i < ENTRIES; i++) {
+                std::size_t j = std::size_t(__builtin_ctzll(i)); // lowest set bit of i
+                std::size_t pos = j * a + k * b;
+                std::size_t rest = i & (i - 1);
+                t[i] = pos < powers.size() ? (rest ? mont.mul(t[rest], powers[pos]) : powers[pos]) : t[rest];
+            }
+        }
+    }
+
+    std::size_t tableBytes() const { return table.size() * sizeof(Int); }
+
+    // base^exp in Montgomery form; exp must be below 2^expBits.
+    Int powMont(const Int &exp) const {
+        const std::size_t ENTRIES = std::size_t(1) << h;
+        Int acc = mont->one();
+        bool started = false;
+        for (std::size_t col = b; col-- > 0;) {
+            if (started) acc = mont->sqr(acc);
+            for (std::size_t k = v; k-- > 0;) {
+                std::size_t offset = k * b + col;
+                if (offset >= a) continue; // the last column of a row can be short
+                std::size_t index = 0;
+                for (std::size_t j = 0; j < h; j++) {
+                    std::size_t pos = j * a + offset;
+                    if (pos < Int::BITS && exp.bit(pos)) index |= std::size_t(1) << j;
+                }
+                if (!index) continue;
+                acc = started ? mont->mul(acc, table[k * ENTRIES + index]) : table[k * ENTRIES + index];
+                started = true;
+            }
+        }
+        return acc;
+    }
+
+    Int pow(const Int &exp) const { return mont->fromMont(powMont(exp)); }
+
+private:
+    const modmath::Montgomery<LIMBS> *mont;
+    std::size_t h, v, a = 0, b = 0;
+    std::vector<Int> table; // v tables of 2^h entries, Montgomery form
+};
+
+template <std::size_t LIMBS>
+class DhGroup {
+public:
+    using Int = modmath::BigInt<LIMBS>;
+
+    DhGroup(const Int &prime, uint64_t generator) : p(prime), g(generator), mont(prime) {
+        Int pm1 = p;
+        pm1.sub(Int(1));
+        if (g < Int(2) || g >= pm1) throw std::invalid_argument("DH: generator out of range");
+    }
+
+    explicit DhGroup(const dh_groups::ModpGroup &spec) : DhGroup(Int::fromHex(spec.prime), spec.generator) {
+        if (p.bitLength() != spec.bits) throw std::invalid_argument("DH: group does not match the integer size");
+    }
+
+    DhGroup(const DhGroup &) = delete;
+    DhGroup &operator=(const DhGroup &) = delete;
+
+    const Int &prime() const { return p; }
+    const Int &generator() const { return g; }
+    std::size_t bits() const { return p.bitLength(); }
+    const modmath::Montgomery<LIMBS> &context() const { return mont; }
+
+    // A uniformly random private exponent in [2, p - 2].
+    Int randomPrivateKey(std::mt19937_64 &rng) const {
+        Int x;
+        do {
+            for (auto &limb : x.limb) limb = rng();
+            for (std::size_t i = bits(); i < Int::BITS; i++) x.limb[i / 64] &= ~(uint64_t(1) << (i % 64));
+        } while (!validPublic(x)); // same range as a public value
+        return x;
+    }
+
+    // g^x mod p through the comb tables (built on the first call).
+    Int publicKey(const Int &x, modmath::ExpMode mode = modmath::ExpMode::SlidingWindow) const {
+        if (mode == modmath::ExpMode::ConstantTime) return publicKeyGeneric(x, mode);
+        return comb().pow(x);
+    }
+
+    // g^x mod p with the generic modexp, for comparison.
+    Int publicKeyGeneric(const Int &x, modmath::ExpMode mode = modmath::ExpMode::SlidingWindow) const {
+        return mont.modexp(g, x, mode);
+    }
+
+    // 1 < y < p - 1 rules out the values that would pin the secret to 1 or p - 1.
+    bool validPublic(const Int &y) const {
+        Int pm1 = p;
+        pm1.sub(Int(1));
+        return compare(y, Int(1)) > 0 && y < pm1;
+    }
+
+    // peer^x mod p; throws on a peer value outside (1, p - 1).
+    Int sharedSecret(const Int &peer, const Int &x, modmath::ExpMode mode = modmath::ExpMode::SlidingWindow) const {
+        if (!validPublic(peer)) throw std::invalid_argument("DH: peer public value out of range");
+        return mont.modexp(peer, x, mode);
+    }
+
+    const FixedBaseComb<LIMBS> &comb() const {
+        std::call_once(combOnce, [this] { combTable = std::make_unique<FixedBaseComb<LIMBS>>(mont, g, bits()); });
+        return *combTable;
+    }
+
+private:
+    Int p, g;
+    modmath::Montgomery<LIMBS> mont;
+    mutable std::once_flag combOnce;
+    mutable std::unique_ptr<FixedBaseComb<LIMBS>> combTable;
+};
+
+using Modp2048 = DhGroup<32>;
+using Modp3072 = DhGroup<48>;
+using Modp4096 = DhGroup<64>;
+using Modp6144 = DhGroup<96>;
+using Modp8192 = DhGroup<128>;
+
+// Process-wide groups; the first call builds the group, later calls share it and its tables.
+inline const Modp2048 &modp2048() {
+    static const Modp2048 group(dh_groups::MODP_2048);
+    return group;
+}
+inline const Modp3072 &modp3072() {
+    static const Modp3072 group(dh_groups::MODP_3072);
+    return group;
+}
+inline const Modp4096 &modp4096() {
+    static const Modp4096 group(dh_groups::MODP_4096);
+    return group;
+}
+inline const Modp6144 &modp6144() {
+    static const Modp6144 group(dh_groups::MODP_6144);
+    return group;
+}
+inline const Modp8192 &modp8192() {
+    static const Modp8192 group(dh_groups::MODP_8192);
+    return group;
+}
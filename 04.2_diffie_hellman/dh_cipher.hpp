@@ -0,0 +1,95 @@
+#pragma once
+
+/*
+ * Session encryption from a Diffie-Hellman shared secret
+ * ------------------------------------------------------
+ * The shared secret, big-endian at the byte length of p, goes through
+ * HKDF-SHA-256 (extract with an optional salt, such as nonces from both
+ * sides). The keystream is S-AES in CTR mode from 02_aes.
+ *
+ * An S-AES counter is a 16-bit block, so one key's keystream repeats after
+ * 65536 blocks (128 KiB). The stream is therefore cut into 128 KiB segments
+ * and segment i gets its own 16-bit key and starting counter from
+ * HKDF-Expand(PRK, "dh s-aes ctr" | i).
+ *
+ * apply() XORs the keystream into a caller-owned buffer, in place or from
+ * `in` to `out`, and never allocates. The S-AES SIMD kernel builds keystream
+ * blocks in vector registers and XORs them into the data there, so big
+ * messages are processed a full vector at a time. `offset` is the position
+ * of the buffer in the stream, so a message can be handled in pieces.
+ *
+ * S-AES is a teaching cipher with 16-bit keys. This fixes the structure
+ * (every bit of the secret matters and nothing repeats a one-byte pad), not
+ * the strength.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+#include "../02_aes/saes_modes.hpp"
+#include "../common/modmath.hpp"
+#include "../common/sha256.hpp"
+
+class SessionCipher {
+public:
+    static constexpr std::size_t SEGMENT = 2 * 65536; // bytes under one S-AES key
+
+    explicit SessionCipher(std::span<const uint8_t> secret, std::span<const uint8_t> salt = {})
+        : prk(hkdfExtract(salt.data(), salt.size(), secret.data(), secret.size())) {}
+
+    // Encodes the secret at `bytes` bytes, big-endian, as it travels on the wire.
+    template <std::size_t L>
+    static SessionCipher fromSecret(const modmath::BigInt<L> &secret, std::size_t bytes,
+                                    std::span<const uint8_t> salt = {}) {
+        if (bytes > 8 * L || secret.bitLength() > 8 * bytes) throw std::invalid_argument("cipher: secret does not fit");
+        uint8_t encoded[8 * L];
+        for (std::size_t i = 0; i < bytes; i++) encoded[bytes - 1 - i] = uint8_t(secret.limb[i / 8] >> (8 * (i % 8)));
+        return SessionCipher(std::span<const uint8_t>(encoded, bytes), salt);
+    }
+
+    // CTR is its own inverse: the same call encrypts and decrypts.
+    void apply(std::span<uint8_t> data, uint64_t offset = 0) const { apply(data, data, offset); }
+
+    void apply(std::span<const uint8_t> in, std::span<uint8_t> out, uint64_t offset = 0) const {
+        if (in.size() != out.size()) throw std::invalid_argument("cipher: input and output sizes differ");
+        const uint8_t *src = in.data();
+        uint8_t *dst = out.data();
+        std::size_t left = in.size();
+        while (left) {
+            uint64_t within = offset % SEGMENT;
+            std::size_t take = std::size_t(std::min<uint64_t>(left, SEGMENT - within));
+            SegmentKey seg = segmentKey(offset / SEGMENT);
+            SimplifiedAES saes(seg.key);
+            uint16_t counter = uint16_t(seg.counter + within / 2);
+            std::size_t done = 0;
+            if (within % 2) { // finish the block the previous piece started
+                *dst = uint8_t(*src ^ saes.Encrypt(counter));
+                counter++;
+                done = 1;
+            }
+            saes_modes::ctrRange(saes, counter, src + done, dst + done, take - done);
+            src += take;
+            dst += take;
+            left -= take;
+            offset += take;
+        }
+    }
+
+private:
+    struct SegmentKey {
+        uint16_t key, counter;
+    };
+
+    SegmentKey segmentKey(uint64_t index) const {
+        uint8_t info[20] = {'d', 'h', ' ', 's', '-', 'a', 'e', 's', ' ', 'c', 't', 'r'};
+        for (int i = 0; i < 8; i++) info[12 + i] = uint8_t(index >> (56 - 8 * i));
+        uint8_t okm[4];
+        hkdfExpand(prk, info, sizeof info, okm, sizeof okm);
+        return {uint16_t(okm[0] << 8 | okm[1]), uint16_t(okm[2] << 8 | okm[3])};
+    }
+
+    Sha256::Digest prk;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+/*
+ * Batched Diffie-Hellman key agreement
+ * ------------------------------------
+ * DhService<LIMBS> answers a batch of handshakes the way a TLS terminator
+ * does for ephemeral DH: for every peer public value it draws a fresh
+ * private key x, sends back g^x (through the group's comb tables) and
+ * keeps peer^x as the shared secret. The batch is split across a
+ * ThreadPool in small chunks; every worker has its own random generator.
+ *
+ * Each handshake is timed on its own, so the result carries the service
+ * time of every item besides the wall time of the whole batch, and
+ * latencySummary() turns those into percentiles. Peer values outside
+ * (1, p - 1) are marked as rejected instead of stopping the batch.
+ *
+ * setExpMode(ExpMode::ConstantTime) runs both exponentiations of every
+ * handshake through the fixed-window constant-time modexp, as a
+ * terminator holding long-lived or sensitive keys would; the comb is
+ * skipped then, since its lookups follow the bits of x.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "dh.hpp"
+#include "../common/thread_pool.hpp"
+
+struct LatencySummary {
+    std::size_t count = 0;
+    double p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0, mean = 0; // microseconds
+};
+
+// Nearest-rank percentiles of per-item latencies given in nanoseconds.
+inline LatencySummary latencySummary(std::vector<uint64_t> ns) {
+    LatencySummary s;
+    s.count = ns.size();
+    if (ns.empty()) return s;
+    std::sort(ns.begin(), ns.end());
+    auto rank = [&](double q) {
+        std::size_t i = std::size_t(q * double(ns.size()) + 0.999999);
+        return double(ns[std::min(std::max<std::size_t>(i, 1), ns.size()) - 1]) / 1e3;
+    };
+    s.p50 = rank(0.50);
+    s.p90 = rank(0.90);
+    s.p99 = rank(0.99);
+    s.p999 = rank(0.999);
+    s.max = double(ns.back()) / 1e3;
+    double total = 0;
+    for (uint64_t v : ns) total += double(v);
+    s.mean = total / double(ns.size()) / 1e3;
+    return s;
+}
+
+template <std::size_t LIMBS>
+class DhService {
+public:
+    using Int = modmath::BigInt<LIMBS>;
+
+    struct Result {
+        std::vector<Int> publicValues;  // our g^x for each handshake
+        std::vector<Int> secrets;       // peer^x, zero where the peer was rejected
+        std::vector<uint8_t> accepted;  // 0 for a peer value outside (1, p - 1)
+        std::vector<uint64_t> latencyNs; // service time of each handshake
+        double wallSeconds = 0;
+    };
+
+    // Handshakes per parallel work item; one costs about a millisecond at 2048 bits.
+    static constexpr std::size_t GRAIN = 4;
+
+    explicit DhService(const DhGroup<LIMBS> &g, uint64_t seed = std::random_device{}()) : group(g), seed(seed) {}
+
+    void setExpMode(modmath::ExpMode m) { mode = m; }
+    modmath::ExpMode expMode() const { return mode; }
+
+    Result run(const std::vector<Int> &peers, ThreadPool &pool) {
+        group.comb(); // build the tables before the clock starts
+        Result r;
+        r.publicValues.resize(peers.size());
+        r.secrets.resize(peers.size());
+        r.accepted.resize(peers.size());
+        r.latencyNs.resize(peers.size());
+        std::vector<std::mt19937_64> rngs;
+        for (unsigned w = 0; w < pool.size(); w++) rngs.emplace_back(seed + batches * pool.size() + w);
+        batches++;
+
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        pool.parallelFor(peers.size(), GRAIN, [&](std::size_t begin, std::size_t end, unsigned worker) {
+            for (std::size_t i = begin; i < end; i++) {
+                auto t0 = clock::now();
+                if (group.validPublic(peers[i])) {
+                    Int x = group.randomPrivateKey(rngs[worker]);
+                    r.publicValues[i] = group.publicKey(x, mode);
+                    r.secrets[i] = group.context().modexp(peers[i], x, mode);
+                    r.accepted[i] = 1;
+                }
+                r.latencyNs[i] = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t0).count());
+            }
+        });
+        r.wallSeconds = std::chrono::duration<double>(clock::now() - start).count();
+        return r;
+    }
+
+private:
+    const DhGroup<LIMBS> &group;
+    uint64_t seed;
+    uint64_t batches = 0;
+    modmath::ExpMode mode = modmath::ExpMode::SlidingWindow;
+};
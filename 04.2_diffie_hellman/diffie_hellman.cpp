@@ -1,48 +1,79 @@
 // To compile and run this code, open a terminal in this folder and run:
-// g++ diffie_hellman.cpp -o diffie_hellman && ./diffie_hellman
+// g++ -O2 -std=c++20 -pthread diffie_hellman.cpp -o diffie_hellman && ./diffie_hellman
 
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
-// Use long long for wider integer range, suitable for this example's numbers.
-using ll = long long;
+#include "../common/instrument.hpp"
+#include "../common/modmath.hpp"
+#include "dh.hpp"
+#include "dh_cipher.hpp"
+#include "dh_service.hpp"
+
+// Unsigned 64-bit values; modmath keeps every product in 128 bits, so any
+// modulus below 2^64 works.
+using ll = uint64_t;
 
 /**
  * @brief Power function to return value of (base^exp) mod modulus.
- * * @param base The base of the exponentiation.
+ * * Uses Montgomery reduction for odd moduli (every safe prime) and
+ * * Barrett reduction otherwise, both from the shared modmath library.
+ * @param base The base of the exponentiation.
  * @param exp The exponent.
  * @param modulus The modulus.
  * @return The result of (base^exp) mod modulus.
  */
 ll power(ll base, ll exp, ll modulus) {
-    ll result = 1;
-    base %= modulus;
-    while (exp > 0) {
-        if (exp % 2 == 1) {
-            result = (result * base) % modulus;
-        }
-        exp >>= 1; // equivalent to exp = exp / 2
-        base = (base * base) % modulus;
-    }
-    return result;
+    instrument::Scope timer(instrument::Probe::ModPow64);
+    instrument::count(instrument::Counter::ModExp);
+    return modmath::powMod(base, exp, modulus);
+}
+
+/**
+ * @brief Encrypts or decrypts a buffer in place with the session keystream.
+ * * The keystream is S-AES CTR keyed through HKDF from the shared secret (see
+ * * dh_cipher.hpp). Applying the same function twice with the same cipher
+ * * returns the original message.
+ * @param message The bytes to process, overwritten with the result.
+ * @param cipher The session cipher derived from the shared secret.
+ */
+void encryptDecrypt(std::span<uint8_t> message, const SessionCipher& cipher) {
+    cipher.apply(message);
+}
+
+/**
+ * @brief Views a string's characters as bytes, for in-place encryption.
+ */
+std::span<uint8_t> bytesOf(std::string& s) {
+    return {reinterpret_cast<uint8_t*>(s.data()), s.size()};
 }
 
 /**
- * @brief A simple XOR-based encryption/decryption function.
- * * Applying the same function twice with the same key returns the original message.
- * @param message The string message to be processed.
- * @param key The secret key to use for the XOR operation.
- * @return The processed (encrypted or decrypted) string.
+ * @brief Hex dump of a byte buffer, since ciphertext is not printable.
  */
-std::string encryptDecrypt(const std::string& message, ll key) {
-    std::string result = "";
-    for (char c : message) {
-        result += c ^ key;
+std::string toHex(std::span<const uint8_t> bytes) {
+    static const char *digits = "0123456789abcdef";
+    std::string s;
+    for (uint8_t b : bytes) {
+        s += digits[b >> 4];
+        s += digits[b & 0xF];
     }
-    return result;
+    return s;
 }
 
-int main() {
+/**
+ * @brief The textbook exchange with P = 23 and G = 9, printed step by step.
+ */
+void runToyDemo() {
     ll P, G, x, a, y, b, ka, kb;
 
     // Both parties agree upon the public keys G and P.
@@ -90,13 +121,381 @@ int main() {
     std::string message = "Hello Bob!";
     std::cout << "Original Message: " << message << std::endl;
 
-    // Alice encrypts the message with her key.
-    std::string encryptedMessage = encryptDecrypt(message, ka);
-    std::cout << "Encrypted Message: " << encryptedMessage << std::endl;
+    // Alice encrypts the message in place with a keystream derived from her key.
+    encryptDecrypt(bytesOf(message), SessionCipher::fromSecret(modmath::BigInt<1>(ka), 8));
+    std::cout << "Encrypted Message: " << toHex(bytesOf(message)) << std::endl;
+
+    // Bob derives the same keystream from his key and decrypts.
+    encryptDecrypt(bytesOf(message), SessionCipher::fromSecret(modmath::BigInt<1>(kb), 8));
+    std::cout << "Decrypted Message: " << message << std::endl;
+}
+
+/**
+ * @brief The same exchange over an RFC 3526 group, with random private keys.
+ * * Alice's and Bob's public values go through the group's cached comb tables.
+ */
+template <std::size_t L>
+void runGroupDemo(const DhGroup<L> &group) {
+    std::mt19937_64 rng(std::random_device{}());
+    std::cout << "MODP group of " << group.bits() << " bits, G = " << group.generator().toDecimal() << std::endl;
+    std::cout << "P = " << group.prime().toHex() << std::endl;
+    std::cout << "-------------------------" << std::endl;
+    auto a = group.randomPrivateKey(rng), b = group.randomPrivateKey(rng);
+    auto x = group.publicKey(a), y = group.publicKey(b);
+    std::cout << "The public key 'x' for Alice: " << x.toHex() << std::endl;
+    std::cout << "The public key 'y' for Bob: " << y.toHex() << std::endl;
+    std::cout << "-------------------------" << std::endl;
+    auto ka = group.sharedSecret(y, a), kb = group.sharedSecret(x, b);
+    std::cout << "Secret key for Alice is: " << ka.toHex() << std::endl;
+    std::cout << "Secret keys match: " << (ka == kb ? "yes" : "NO") << std::endl;
+    std::cout << "-------------------------" << std::endl;
+    std::string message = "Hello Bob!";
+    encryptDecrypt(bytesOf(message), SessionCipher::fromSecret(ka, group.bits() / 8));
+    std::cout << "Encrypted Message: " << toHex(bytesOf(message)) << std::endl;
+    encryptDecrypt(bytesOf(message), SessionCipher::fromSecret(kb, group.bits() / 8));
+    std::cout << "Decrypted Message: " << message << std::endl;
+}
+
+// --- Service mode: many handshakes across a worker pool ---
+
+struct ServeOptions {
+    std::size_t peers = 1000;  // generated peer values when no input is given
+    unsigned threads = 0;      // 0: one per hardware thread
+    std::string in, out;       // hex peer values in, "public secret" lines out; "-" is stdin/stdout
+    bool constantTime = false; // both exponentiations through the constant-time modexp
+};
+
+/**
+ * @brief Reads one hex peer value per line, skipping blank lines. A line that
+ * is not a hex number of at most L limbs becomes 0, which the service
+ * rejects like any other invalid peer value, and is reported on stderr.
+ */
+template <std::size_t L>
+std::vector<modmath::BigInt<L>> readPeers(std::istream &in) {
+    std::vector<modmath::BigInt<L>> peers;
+    std::string line;
+    for (std::size_t number = 1; std::getline(in, line); number++) {
+        std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        std::string hex = line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+        try {
+            peers.push_back(modmath::BigInt<L>::fromHex(hex));
+        } catch (const std::exception &e) {
+            std::cerr << "line " << number << ": " << e.what() << ", rejected\n";
+            peers.push_back(modmath::BigInt<L>());
+        }
+    }
+    return peers;
+}
+
+/**
+ * @brief Answers every peer value with a fresh ephemeral key and reports
+ * handshakes per second and the latency percentiles of single handshakes.
+ */
+template <std::size_t L>
+int runServe(const DhGroup<L> &group, const ServeOptions &opt) {
+    std::vector<modmath::BigInt<L>> peers;
+    if (opt.in == "-") {
+        peers = readPeers<L>(std::cin);
+    } else if (!opt.in.empty()) {
+        std::ifstream file(opt.in);
+        if (!file) {
+            std::cerr << "cannot read " << opt.in << "\n";
+            return 1;
+        }
+        peers = readPeers<L>(file);
+    } else {
+        std::mt19937_64 rng(std::random_device{}());
+        for (std::size_t i = 0; i < opt.peers; i++) peers.push_back(group.publicKey(group.randomPrivateKey(rng)));
+    }
 
-    // Bob decrypts the message with his key.
-    std::string decryptedMessage = encryptDecrypt(encryptedMessage, kb);
-    std::cout << "Decrypted Message: " << decryptedMessage << std::endl;
+    ThreadPool pool(opt.threads);
+    DhService<L> service(group);
+    if (opt.constantTime) service.setExpMode(modmath::ExpMode::ConstantTime);
+    auto result = service.run(peers, pool);
 
+    std::ofstream file;
+    std::ostream *secrets = nullptr;
+    if (opt.out == "-") secrets = &std::cout;
+    else if (!opt.out.empty()) {
+        file.open(opt.out);
+        if (!file) {
+            std::cerr << "cannot write " << opt.out << "\n";
+            return 1;
+        }
+        secrets = &file;
+    }
+    if (secrets) {
+        for (std::size_t i = 0; i < peers.size(); i++)
+            *secrets << (result.accepted[i] ? result.publicValues[i].toHex() + " " + result.secrets[i].toHex()
+                                            : std::string("rejected")) << "\n";
+        if (!secrets->flush()) {
+            std::cerr << "error writing " << (opt.out == "-" ? std::string("stdout") : opt.out) << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<uint64_t> handshakeNs; // rejected peers cost nothing worth reporting
+    for (std::size_t i = 0; i < peers.size(); i++)
+        if (result.accepted[i]) handshakeNs.push_back(result.latencyNs[i]);
+    std::size_t accepted = handshakeNs.size(), rejected = peers.size() - accepted;
+    LatencySummary lat = latencySummary(std::move(handshakeNs));
+    std::ostream &report = opt.out == "-" ? std::cerr : std::cout;
+    report << std::fixed << std::setprecision(1);
+    report << "MODP-" << group.bits() << ": " << peers.size() << " handshakes (" << rejected << " rejected) on "
+           << pool.size() << " thread(s) in " << result.wallSeconds * 1e3 << " ms, "
+           << (opt.constantTime ? "constant-time" : "sliding-window") << " modexp\n";
+    report << "throughput: " << double(accepted) / result.wallSeconds << " handshakes/s\n";
+    report << "latency (us): p50 " << lat.p50 << "  p90 " << lat.p90 << "  p99 " << lat.p99 << "  p99.9 " << lat.p999
+           << "  max " << lat.max << "  mean " << lat.mean << "\n";
     return 0;
+}
+
+// --- Self-test ---
+
+/**
+ * @brief Checks one group: 2 has order (p - 1) / 2, the comb agrees with the
+ * generic modexp, and both sides reach the same secret.
+ * * g^((p-1)/2) = 1 holds for a safe prime p = 7 (mod 8) and fails for almost
+ * any mistyped digit of p, so it doubles as a check of the constants.
+ */
+template <std::size_t L>
+bool checkGroup(const DhGroup<L> &group, std::mt19937_64 &rng) {
+    using Int = typename DhGroup<L>::Int;
+    Int q = group.prime();
+    q.shiftRight1();
+    if (group.context().modexp(group.generator(), q) != Int(1)) return false;
+    for (int t = 0; t < 3; t++) {
+        Int a = group.randomPrivateKey(rng), b = group.randomPrivateKey(rng);
+        Int x = group.publicKey(a), y = group.publicKey(b);
+        if (x != group.publicKeyGeneric(a) || y != group.publicKey(b, modmath::ExpMode::ConstantTime)) return false;
+        if (group.sharedSecret(y, a) != group.sharedSecret(x, b)) return false;
+    }
+    // Exponents with set bits only at the edges of the comb rows.
+    Int edge(1);
+    edge.limb[L - 1] = uint64_t(1) << 62;
+    return group.publicKey(edge) == group.publicKeyGeneric(edge) && group.publicKey(Int(2)) == Int(4);
+}
+
+/**
+ * @brief Published vectors for the key derivation under SessionCipher: FIPS
+ * 180-4 "abc" and one million 'a' (fed in uneven pieces), RFC 4231 case 1
+ * for HMAC and RFC 5869 case 1 for HKDF.
+ */
+bool checkSha256() {
+    auto hex = [](const Sha256::Digest &d) { return toHex(d); };
+    const std::string abc = "abc";
+    bool ok = hex(Sha256().update(abc.data(), abc.size()).finish()) ==
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+    std::vector<uint8_t> million(1000000, 'a');
+    Sha256 h;
+    for (std::size_t pos = 0, piece = 1; pos < million.size(); pos += piece, piece = piece % 200 + 37)
+        h.update(million.data() + pos, std::min(piece, million.size() - pos));
+    ok = ok && hex(h.finish()) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+
+    std::vector<uint8_t> hmacKey(20, 0x0b);
+    const std::string hiThere = "Hi There";
+    ok = ok && hex(hmacSha256(hmacKey.data(), hmacKey.size(), reinterpret_cast<const uint8_t *>(hiThere.data()),
+                              hiThere.size())) == "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7";
+
+    std::vector<uint8_t> ikm(22, 0x0b), salt(13), info(10), okm(42);
+    for (std::size_t i = 0; i < salt.size(); i++) salt[i] = uint8_t(i);
+    for (std::size_t i = 0; i < info.size(); i++) info[i] = uint8_t(0xf0 + i);
+    Sha256::Digest prk = hkdfExtract(salt.data(), salt.size(), ikm.data(), ikm.size());
+    hkdfExpand(prk, info.data(), info.size(), okm.data(), okm.size());
+    return ok && hex(prk) == "077709362c2e32df0ddc3f0dc47bba6390b6c73bb50f9c3122ec844ad7c2b3e5" &&
+           toHex(okm) == "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865";
+}
+
+bool selfTest() {
+    bool ok = true;
+    auto report = [&](const std::string &name, bool pass) {
+        std::cout << std::left << std::setw(38) << name << (pass ? "ok" : "FAILED") << "\n";
+        ok = ok && pass;
+    };
+    std::mt19937_64 rng(99);
+    report("toy group: 9^4 mod 23, 9^3 mod 23", power(9, 4, 23) == 6 && power(9, 3, 23) == 16);
+    report("power() with a 62-bit modulus", power(3, 4611686018427387902ull, 4611686018427387847ull) ==
+                                                639558608944335505ull &&
+                                            power(2, 61, 4611686018427387847ull) == (1ull << 61));
+    report("MODP-2048 comb, generic, exchange", checkGroup(modp2048(), rng));
+    report("MODP-3072 comb, generic, exchange", checkGroup(modp3072(), rng));
+    report("MODP-4096 comb, generic, exchange", checkGroup(modp4096(), rng));
+    report("MODP-6144 comb, generic, exchange", checkGroup(modp6144(), rng));
+    report("MODP-8192 comb, generic, exchange", checkGroup(modp8192(), rng));
+    bool rejected = false;
+    try {
+        modp2048().sharedSecret(modp2048().prime(), Modp2048::Int(5)); // p itself is not a valid peer value
+    } catch (const std::invalid_argument &) {
+        rejected = true;
+    }
+    report("peer value p is rejected", rejected);
+    report("SHA-256, HMAC, HKDF known answers", checkSha256());
+    {
+        ThreadPool pool(3);
+        std::vector<Modp2048::Int> peers(40);
+        std::vector<Modp2048::Int> keys(peers.size());
+        for (std::size_t i = 0; i < peers.size(); i++) {
+            keys[i] = modp2048().randomPrivateKey(rng);
+            peers[i] = modp2048().publicKey(keys[i]);
+        }
+        peers[7] = Modp2048::Int(1);
+        DhService<32> service(modp2048(), 11);
+        bool good = true;
+        for (auto mode : {modmath::ExpMode::SlidingWindow, modmath::ExpMode::ConstantTime}) {
+            service.setExpMode(mode);
+            auto result = service.run(peers, pool);
+            good = good && result.latencyNs.size() == peers.size();
+            for (std::size_t i = 0; i < peers.size(); i++) {
+                bool expectOk = i != 7;
+                good = good && result.accepted[i] == expectOk;
+                // Our secret peer^x must equal what the peer computes from our public value.
+                if (expectOk)
+                    good = good && result.secrets[i] == modp2048().sharedSecret(result.publicValues[i], keys[i]);
+            }
+        }
+        report("MODP-2048 batched service, both modes", good);
+    }
+    {
+        // A message longer than two key segments, processed in place in odd-sized pieces.
+        std::vector<uint8_t> plain(2 * SessionCipher::SEGMENT + 12345), data;
+        for (auto &b : plain) b = uint8_t(rng());
+        auto secret = modp2048().sharedSecret(modp2048().publicKey(Modp2048::Int(3)), Modp2048::Int(5));
+        SessionCipher cipher = SessionCipher::fromSecret(secret, 256);
+        std::vector<uint8_t> whole(plain.size());
+        cipher.apply(plain, whole);
+        data = plain;
+        std::span<uint8_t> view(data);
+        for (std::size_t pos = 0, piece = 1; pos < data.size(); pos += piece, piece = piece * 3 + 1) {
+            std::size_t n = std::min(piece, data.size() - pos);
+            cipher.apply(view.subspan(pos, n), pos);
+        }
+        bool good = data == whole;
+        // No 128 KiB repeat: segment 1 must not reuse segment 0's keystream.
+        std::vector<uint8_t> zeros(2 * SessionCipher::SEGMENT, 0);
+        cipher.apply(zeros);
+        good = good && !std::equal(zeros.begin(), zeros.begin() + 4096, zeros.begin() + SessionCipher::SEGMENT);
+        cipher.apply(whole);
+        good = good && whole == plain;
+        auto flipped = secret;
+        flipped.limb[0] ^= 1;
+        SessionCipher other = SessionCipher::fromSecret(flipped, 256);
+        std::vector<uint8_t> a(64, 0), b(64, 0);
+        cipher.apply(a);
+        other.apply(b);
+        report("session cipher pieces/segments/keys", good && a != b);
+    }
+    return ok;
+}
+
+// --- Throughput ---
+
+template <class F>
+double benchRow(const std::string &name, F &&f) {
+    std::size_t calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        f();
+        calls++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < 0.5);
+    std::cout << std::left << std::setw(38) << name << std::right << std::setw(12) << std::fixed
+              << std::setprecision(1) << calls / seconds << " ops/s\n";
+    return calls / seconds;
+}
+
+template <std::size_t L>
+void benchGroup(const DhGroup<L> &group, std::mt19937_64 &rng) {
+    std::string name = "MODP-" + std::to_string(group.bits());
+    auto start = std::chrono::steady_clock::now();
+    const auto &comb = group.comb(); // the first use builds the tables
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::left << std::setw(38) << name + " comb tables (" + std::to_string(comb.tableBytes() >> 10) + " KiB)"
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1) << ms << " ms\n";
+    auto x = group.randomPrivateKey(rng), peer = group.publicKey(group.randomPrivateKey(rng));
+    typename DhGroup<L>::Int out;
+    double generic = benchRow(name + " g^x, generic modexp", [&] { out = group.publicKeyGeneric(x); });
+    double fixed = benchRow(name + " g^x, fixed-base comb", [&] { out = group.publicKey(x); });
+    std::cout << std::left << std::setw(38) << "  comb speedup" << std::right << std::setw(12) << std::fixed
+              << std::setprecision(1) << fixed / generic << " x\n";
+    benchRow(name + " peer^x, shared secret", [&] { out = group.sharedSecret(peer, x); });
+}
+
+void benchCipher() {
+    std::vector<uint8_t> data(1 << 20, 0x5a);
+    auto secret = modp2048().sharedSecret(modp2048().publicKey(Modp2048::Int(3)), Modp2048::Int(5));
+    SessionCipher cipher = SessionCipher::fromSecret(secret, 256);
+    double calls = benchRow("session cipher, 1 MiB in place", [&] { cipher.apply(data); });
+    std::cout << std::left << std::setw(38) << "  throughput" << std::right << std::setw(12) << std::fixed
+              << std::setprecision(1) << calls * double(data.size()) / 1e6 << " MB/s\n";
+    benchRow("session cipher setup (HKDF)", [&] { cipher = SessionCipher::fromSecret(secret, 256); });
+}
+
+void runBench() {
+    std::mt19937_64 rng(5);
+    benchGroup(modp2048(), rng);
+    benchGroup(modp3072(), rng);
+    benchGroup(modp4096(), rng);
+    benchGroup(modp6144(), rng);
+    benchGroup(modp8192(), rng);
+    benchCipher();
+}
+
+int main(int argc, char *argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--selftest") return selfTest() ? 0 : 1;
+    if (mode == "--bench") {
+        runBench();
+        return 0;
+    }
+    if (mode.empty()) {
+        runToyDemo();
+        return 0;
+    }
+
+    int bits = 2048;
+    bool serve = false;
+    ServeOptions opt;
+    auto count = [](const std::string &v) { // stoul alone would wrap "-1"
+        if (v.empty() || v.find_first_not_of("0123456789") != std::string::npos)
+            throw std::invalid_argument("not a count: " + v);
+        return std::stoul(v);
+    };
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc, parsed = true;
+        try {
+            if (arg == "--serve") serve = true;
+            else if (arg == "--group" && hasValue) bits = std::stoi(argv[++i]);
+            else if (arg == "--peers" && hasValue) opt.peers = count(argv[++i]);
+            else if (arg == "--threads" && hasValue) opt.threads = parseThreadCount(argv[++i]);
+            else if (arg == "--constant-time") opt.constantTime = true;
+            else if (arg == "--in" && hasValue) opt.in = argv[++i];
+            else if (arg == "--out" && hasValue) opt.out = argv[++i];
+            else parsed = false;
+        } catch (const std::logic_error &) { // not a number, or out of range
+            parsed = false;
+        }
+        if (!parsed) {
+            std::cerr << "usage: diffie_hellman [--group 2048|3072|4096|6144|8192]\n"
+                         "       diffie_hellman --serve [--group BITS] [--peers N | --in FILE|-] [--out FILE|-] [--threads N]\n"
+                         "                        [--constant-time]\n"
+                         "       diffie_hellman --selftest | --bench\n";
+            return 1;
+        }
+    }
+    auto dispatch = [&](const auto &group) {
+        if (serve) return runServe(group, opt);
+        runGroupDemo(group);
+        return 0;
+    };
+    switch (bits) {
+    case 2048: return dispatch(modp2048());
+    case 3072: return dispatch(modp3072());
+    case 4096: return dispatch(modp4096());
+    case 6144: return dispatch(modp6144());
+    case 8192: return dispatch(modp8192());
+    default: std::cerr << "unsupported group size " << bits << "\n"; return 1;
+    }
 }
\ No newline at end of file
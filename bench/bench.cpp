@@ -0,0 +1,486 @@
+// To compile and run this code, open a terminal in this folder and run:
+// g++ -O2 -std=c++20 -pthread bench.cpp -o bench && ./bench --benchmark_format=json > results.json
+
+/*
+ * Benchmarks for every C++ module
+ * -------------------------------
+ * Fixed workloads, one family per engine, with the scalar, table, SIMD and
+ * threaded variants registered side by side so a single run compares them:
+ *
+ *   sdes/...   S-DES blocks/s (packed, 256-byte table, bitsliced kernels),
+ *              MB/s per stream mode, and the 1024-key brute force.
+ *   saes/...   S-AES blocks/s (rounds, T-tables, codebook) and MB/s per
+ *              mode for every SIMD kernel this CPU runs, plus pooled CTR.
+ *   rsaN/...   RSA keygen, sign (CRT, constant-time CRT) and verify per key
+ *              size, and batched verification on the thread pool.
+ *   dh/...     MODP group key generation and agreement per group, and the
+ *              session cipher.
+ *   ecdh/...   P-256 and secp256k1 key generation and agreement, and
+ *              multi-scalar multiplication.
+ *   ecc/...    curve point enumeration and listing, points/s.
+ *   batch/...  the cybersec/ scheduler: a mixed round of cipher buffers and
+ *              handshakes, and batched ECDH, requests/s.
+ *
+ * Every family reports items_per_second (blocks, operations or points) and,
+ * for bulk data, bytes_per_second. The per-program --bench modes stay the
+ * quick interactive view; this executable is the one to keep JSON from.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+#include "../01_des/sdes.hpp"
+#include "../01_des/sdes_bitslice.hpp"
+#include "../02_aes/saes.hpp"
+#include "../02_aes/saes_modes.hpp"
+#include "../02_aes/saes_simd.hpp"
+#include "../03_rsa/rsa.hpp"
+#include "../03_rsa/rsa_keygen.hpp"
+#include "../04.1_ecc_diiffie_hellman/curve_points.hpp"
+#include "../04.1_ecc_diiffie_hellman/ec.hpp"
+#include "../04.1_ecc_diiffie_hellman/point_stream.hpp"
+#include "../04.2_diffie_hellman/dh.hpp"
+#include "../04.2_diffie_hellman/dh_cipher.hpp"
+#include "../common/thread_pool.hpp"
+#include "../cybersec/batch.hpp"
+
+using bench::State;
+
+ThreadPool &sharedPool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+std::string poolSuffix() { return "/threads:" + std::to_string(sharedPool().size()); }
+
+// --- S-DES ---
+const uint16_t SDES_KEY = 0b0111111101;
+const std::size_t SDES_BLOCKS = 1 << 16;
+
+std::vector<uint8_t> patternBytes(std::size_t n) {
+    std::vector<uint8_t> data(n);
+    for (std::size_t i = 0; i < n; i++) data[i] = uint8_t(i * 131 + 7);
+    return data;
+}
+
+void registerSdes() {
+    bench::add("sdes/packed", [](State &state) {
+        auto data = patternBytes(SDES_BLOCKS), out = data;
+        for (auto _ : state)
+            for (std::size_t i = 0; i < SDES_BLOCKS; i++) out[i] = sdes_packed::sdes(data[i], SDES_KEY, false);
+        bench::doNotOptimize(out.data());
+        state.setItemsProcessed(state.iterations() * SDES_BLOCKS);
+    });
+    for (bool tables : {false, true}) {
+        bench::add(tables ? "sdes/context/table" : "sdes/context/no_table", [tables](State &state) {
+            auto data = patternBytes(SDES_BLOCKS), out = data;
+            sdes_packed::SdesContext ctx(SDES_KEY);
+            if (tables) ctx.buildTables();
+            for (auto _ : state) ctx.encrypt(data.data(), out.data(), SDES_BLOCKS);
+            bench::doNotOptimize(out.data());
+            state.setItemsProcessed(state.iterations() * SDES_BLOCKS);
+        });
+    }
+    sdes_bitslice::Kernel active = sdes_bitslice::activeKernel();
+    for (int k = 0; k <= int(active); k++) {
+        auto kernel = sdes_bitslice::Kernel(k);
+        std::string name = sdes_bitslice::kernelName(kernel);
+        bench::add("sdes/bitslice/" + name, [kernel, active](State &state) {
+            auto data = patternBytes(SDES_BLOCKS), out = data;
+            sdes_bitslice::selectKernel(kernel);
+            for (auto _ : state) sdes_bitslice::encryptBlocks(data.data(), out.data(), SDES_BLOCKS, SDES_KEY);
+            sdes_bitslice::selectKernel(active);
+            bench::doNotOptimize(out.data());
+            state.setItemsProcessed(state.iterations() * SDES_BLOCKS);
+        });
+        bench::add("sdes/brute_force/bitslice/" + name, [kernel, active](State &state) {
+            uint8_t plain = 0xA2, cipher = 0x38;
+            uint64_t mask[16];
+            sdes_bitslice::selectKernel(kernel);
+            for (auto _ : state) {
+                sdes_bitslice::matchAllKeys(&plain, &cipher, 1, mask);
+                bench::doNotOptimize(mask[7]);
+            }
+            sdes_bitslice::selectKernel(active);
+            state.setItemsProcessed(state.iterations() * 1024);
+            state.counter("keys_per_second", double(state.iterations()) * 1024, true);
+        });
+    }
+    bench::add("sdes/brute_force/packed", [](State &state) {
+        unsigned hits = 0;
+        for (auto _ : state)
+            for (int k = 0; k < 1024; k++) hits += sdes_packed::sdes(0xA2, uint16_t(k), false) == 0x38;
+        bench::doNotOptimize(hits);
+        state.setItemsProcessed(state.iterations() * 1024);
+    });
+    const std::pair<const char *, sdes_packed::Mode> modes[] = {
+        {"ecb", sdes_packed::Mode::ECB}, {"cbc", sdes_packed::Mode::CBC}, {"ctr", sdes_packed::Mode::CTR}};
+    for (auto [label, mode] : modes) {
+        bench::add(std::string("sdes/stream/") + label, [mode = mode](State &state) {
+            const std::size_t BYTES = 1 << 20;
+            auto data = patternBytes(BYTES);
+            sdes_packed::SdesContext ctx(SDES_KEY);
+            ctx.buildTables();
+            sdes_packed::StreamCipher stream(ctx, mode, false, 0x5A);
+            for (auto _ : state) stream.process(data.data(), BYTES);
+            bench::doNotOptimize(data.data());
+            state.setItemsProcessed(state.iterations() * BYTES);
+            state.setBytesProcessed(state.iterations() * BYTES);
+        });
+    }
+}
+
+// --- S-AES ---
+const uint16_t SAES_KEY = 0b0100101011110101;
+
+// The SIMD kernels this CPU can run, Scalar first.
+std::vector<saes_simd::Kernel> saesKernels() {
+    std::vector<saes_simd::Kernel> kernels{saes_simd::Kernel::Scalar};
+    saes_simd::Kernel best = saes_simd::activeKernel();
+    for (auto k : {saes_simd::Kernel::SSSE3, saes_simd::Kernel::AVX2, saes_simd::Kernel::AVX512BW,
+                   saes_simd::Kernel::NEON})
+        if (k <= best && saes_simd::detail::kernelTable(k).kind == k) kernels.push_back(k);
+    return kernels;
+}
+
+void registerSaes() {
+    const std::size_t N = 1 << 16;
+    auto words = [N] {
+        std::vector<uint16_t> data(N);
+        for (std::size_t i = 0; i < N; i++) data[i] = uint16_t(i * 40503u + 11);
+        return data;
+    };
+    bench::add("saes/block/rounds", [=](State &state) {
+        auto data = words(), out = data;
+        SimplifiedAES saes(SAES_KEY);
+        for (auto _ : state)
+            for (std::size_t i = 0; i < N; i++) out[i] = saes.EncryptRounds(data[i]);
+        bench::doNotOptimize(out.data());
+        state.setItemsProcessed(state.iterations() * N);
+    });
+    bench::add("saes/block/ttables", [=](State &state) {
+        auto data = words(), out = data;
+        SimplifiedAES saes(SAES_KEY);
+        for (auto _ : state)
+            for (std::size_t i = 0; i < N; i++) out[i] = saes.Encrypt(data[i]);
+        bench::doNotOptimize(out.data());
+        state.setItemsProcessed(state.iterations() * N);
+    });
+    bench::add("saes/block/codebook", [=](State &state) {
+        auto data = words(), out = data;
+        auto book = std::make_unique<SaesCodebook>(SAES_KEY);
+        for (auto _ : state) book->encrypt(data.data(), out.data(), N);
+        bench::doNotOptimize(out.data());
+        state.setItemsProcessed(state.iterations() * N);
+    });
+
+    const std::size_t BYTES = 16 << 20;
+    saes_simd::Kernel best = saes_simd::activeKernel();
+    for (auto kernel : saesKernels()) {
+        std::string name = saes_simd::kernelName(kernel);
+        bench::add("saes/ecb/" + name, [=](State &state) {
+            std::vector<uint8_t> buffer(BYTES, 0x5A), out(BYTES);
+            SimplifiedAES saes(SAES_KEY);
+            saes_simd::selectKernel(kernel);
+            for (auto _ : state) saes_modes::ecbEncrypt(saes, buffer, out);
+            saes_simd::selectKernel(best);
+            state.setItemsProcessed(state.iterations() * BYTES / 2);
+            state.setBytesProcessed(state.iterations() * BYTES);
+        });
+        bench::add("saes/ctr/" + name, [=](State &state) {
+            std::vector<uint8_t> buffer(BYTES, 0x5A), out(BYTES);
+            SimplifiedAES saes(SAES_KEY);
+            saes_simd::selectKernel(kernel);
+            for (auto _ : state) saes_modes::ctr(saes, 0x1234, buffer, out);
+            saes_simd::selectKernel(best);
+            state.setItemsProcessed(state.iterations() * BYTES / 2);
+            state.setBytesProcessed(state.iterations() * BYTES);
+        });
+    }
+    // CBC chains block to block, so it runs on the scalar cipher whatever the kernel.
+    for (bool decrypting : {false, true}) {
+        bench::add(decrypting ? "saes/cbc_decrypt" : "saes/cbc_encrypt", [=](State &state) {
+            std::vector<uint8_t> buffer(BYTES, 0x5A), out(BYTES);
+            SimplifiedAES saes(SAES_KEY);
+            for (auto _ : state) {
+                if (decrypting) saes_modes::cbcDecrypt(saes, 0x1234, buffer, out);
+                else saes_modes::cbcEncrypt(saes, 0x1234, buffer, out);
+            }
+            state.setItemsProcessed(state.iterations() * BYTES / 2);
+            state.setBytesProcessed(state.iterations() * BYTES);
+        });
+    }
+    bench::add("saes/ctr/" + std::string(saes_simd::kernelName(best)) + poolSuffix(), [=](State &state) {
+        std::vector<uint8_t> buffer(BYTES, 0x5A), out(BYTES);
+        SimplifiedAES saes(SAES_KEY);
+        for (auto _ : state) saes_modes::ctr(saes, 0x1234, buffer, out, &sharedPool());
+        state.setThreads(sharedPool().size());
+        state.setItemsProcessed(state.iterations() * BYTES / 2);
+        state.setBytesProcessed(state.iterations() * BYTES);
+    });
+}
+
+// --- RSA ---
+
+// One key per size for the whole run: keygen is seconds at the larger sizes.
+template <std::size_t L>
+const RsaKey<L> &rsaKey() {
+    static const RsaKey<L> key = rsa_keygen::generateKey<L>(&sharedPool());
+    return key;
+}
+
+// A value below n: random limbs with the top limb held under n's.
+template <std::size_t L>
+bignum::BigInt<L> randomBelow(const bignum::BigInt<L> &n, std::mt19937_64 &rng) {
+    bignum::BigInt<L> v;
+    for (auto &limb : v.limb) limb = rng();
+    v.limb[L - 1] %= n.limb[L - 1];
+    return v;
+}
+
+template <std::size_t L>
+void registerRsa(bool keygen) {
+    const std::string prefix = "rsa" + std::to_string(64 * L);
+    if (keygen) {
+        bench::add(prefix + "/keygen/threads:1", [](State &state) {
+            ThreadPool single(1);
+            for (auto _ : state) bench::doNotOptimize(rsa_keygen::generateKey<L>(&single).n.limb[0]);
+            state.setItemsProcessed(state.iterations());
+        });
+        if (sharedPool().size() > 1)
+            bench::add(prefix + "/keygen" + poolSuffix(), [](State &state) {
+                for (auto _ : state) bench::doNotOptimize(rsa_keygen::generateKey<L>(&sharedPool()).n.limb[0]);
+                state.setThreads(sharedPool().size());
+                state.setItemsProcessed(state.iterations());
+            });
+    }
+    for (bool constantTime : {false, true}) {
+        bench::add(prefix + (constantTime ? "/sign/crt_constant_time" : "/sign/crt"), [constantTime](State &state) {
+            Rsa<L> rsa(rsaKey<L>());
+            if (constantTime) rsa.setExpMode(bignum::ExpMode::ConstantTime);
+            std::mt19937_64 rng(7);
+            auto m = randomBelow(rsa.publicKey().n, rng);
+            for (auto _ : state) m = rsa.sign(m);
+            bench::doNotOptimize(m.limb[0]);
+            state.setItemsProcessed(state.iterations());
+        });
+    }
+    bench::add(prefix + "/sign/plain", [](State &state) {
+        Rsa<L> rsa(rsaKey<L>());
+        std::mt19937_64 rng(7);
+        auto m = randomBelow(rsa.publicKey().n, rng);
+        for (auto _ : state) m = rsa.decryptPlain(m);
+        bench::doNotOptimize(m.limb[0]);
+        state.setItemsProcessed(state.iterations());
+    });
+    bench::add(prefix + "/verify", [](State &state) {
+        Rsa<L> rsa(rsaKey<L>());
+        std::mt19937_64 rng(7);
+        auto s = randomBelow(rsa.publicKey().n, rng);
+        for (auto _ : state) s = rsa.encrypt(s);
+        bench::doNotOptimize(s.limb[0]);
+        state.setItemsProcessed(state.iterations());
+    });
+    for (bool pooled : {false, true}) {
+        if (pooled && sharedPool().size() == 1) continue;
+        bench::add(prefix + "/verify_batch" + (pooled ? poolSuffix() : "/threads:1"), [pooled](State &state) {
+            const std::size_t BATCH = 256;
+            Rsa<L> rsa(rsaKey<L>());
+            std::mt19937_64 rng(7);
+            std::vector<bignum::BigInt<L>> batch(BATCH);
+            for (auto &s : batch) s = randomBelow(rsa.publicKey().n, rng);
+            for (auto _ : state) batch = rsa.encryptBatch(batch, pooled ? &sharedPool() : nullptr);
+            state.setThreads(pooled ? sharedPool().size() : 1);
+            state.setItemsProcessed(state.iterations() * BATCH);
+        });
+    }
+}
+
+// --- Finite-field Diffie-Hellman ---
+template <std::size_t L>
+void registerDh(const DhGroup<L> &(*group)()) {
+    const std::string prefix = "dh/modp" + std::to_string(64 * L);
+    bench::add(prefix + "/keygen/comb", [group](State &state) {
+        const DhGroup<L> &g = group();
+        g.comb(); // built on first use
+        std::mt19937_64 rng(5);
+        auto x = g.randomPrivateKey(rng);
+        for (auto _ : state) bench::doNotOptimize(g.publicKey(x).limb[0]);
+        state.setItemsProcessed(state.iterations());
+    });
+    bench::add(prefix + "/keygen/generic", [group](State &state) {
+        const DhGroup<L> &g = group();
+        std::mt19937_64 rng(5);
+        auto x = g.randomPrivateKey(rng);
+        for (auto _ : state) bench::doNotOptimize(g.publicKeyGeneric(x).limb[0]);
+        state.setItemsProcessed(state.iterations());
+    });
+    for (bool constantTime : {false, true}) {
+        bench::add(prefix + (constantTime ? "/agree/constant_time" : "/agree"), [group, constantTime](State &state) {
+            const DhGroup<L> &g = group();
+            std::mt19937_64 rng(5);
+            auto x = g.randomPrivateKey(rng), peer = g.publicKey(g.randomPrivateKey(rng));
+            auto mode = constantTime ? modmath::ExpMode::ConstantTime : modmath::ExpMode::SlidingWindow;
+            for (auto _ : state) bench::doNotOptimize(g.sharedSecret(peer, x, mode).limb[0]);
+            state.setItemsProcessed(state.iterations());
+        });
+    }
+}
+
+void registerDhCipher() {
+    bench::add("dh/session_cipher", [](State &state) {
+        std::vector<uint8_t> data(1 << 20, 0x5a);
+        auto secret = modp2048().sharedSecret(modp2048().publicKey(Modp2048::Int(3)), Modp2048::Int(5));
+        SessionCipher cipher = SessionCipher::fromSecret(secret, 256);
+        for (auto _ : state) cipher.apply(data);
+        bench::doNotOptimize(data.data());
+        state.setBytesProcessed(state.iterations() * data.size());
+    });
+}
+
+// --- Elliptic curves ---
+void registerEcdh(const char *name, const EcCurve<4> &(*curve)()) {
+    const std::string prefix = std::string("ecdh/") + name;
+    for (bool ladder : {false, true}) {
+        auto mode = ladder ? modmath::ExpMode::ConstantTime : modmath::ExpMode::SlidingWindow;
+        bench::add(prefix + (ladder ? "/keygen/ladder" : "/keygen/comb"), [curve, mode](State &state) {
+            const EcCurve<4> &c = curve();
+            c.comb();
+            std::mt19937_64 rng(24);
+            auto d = c.randomPrivateKey(rng);
+            for (auto _ : state) bench::doNotOptimize(c.publicKey(d, mode).x.limb[0]);
+            state.setItemsProcessed(state.iterations());
+        });
+        bench::add(prefix + (ladder ? "/agree/ladder" : "/agree/wnaf"), [curve, mode](State &state) {
+            const EcCurve<4> &c = curve();
+            std::mt19937_64 rng(24);
+            auto d = c.randomPrivateKey(rng);
+            auto peer = c.publicKey(c.randomPrivateKey(rng));
+            for (auto _ : state) bench::doNotOptimize(c.sharedSecret(peer, d, mode).limb[0]);
+            state.setItemsProcessed(state.iterations());
+        });
+    }
+    for (std::size_t n : {64, 1024}) {
+        for (int method = 0; method < 2; method++) {
+            bench::add(prefix + (method ? "/msm/pippenger/" : "/msm/straus/") + std::to_string(n),
+                       [curve, n, method](State &state) {
+                const EcCurve<4> &c = curve();
+                std::mt19937_64 rng(24);
+                std::vector<EcCurve<4>::Affine> points;
+                std::vector<EcCurve<4>::Int> scalars;
+                for (std::size_t i = 0; i < n; i++) {
+                    points.push_back(c.mulBase(c.randomPrivateKey(rng)));
+                    scalars.push_back(c.randomPrivateKey(rng));
+                }
+                for (auto _ : state) {
+                    auto r = method ? c.msmPippenger(points, scalars) : c.msmStraus(points, scalars);
+                    bench::doNotOptimize(r.X.limb[0]);
+                }
+                state.setItemsProcessed(state.iterations() * n);
+            });
+        }
+    }
+}
+
+void registerEcc() {
+    const uint64_t P = 1000003;
+    for (bool bitmap : {true, false}) {
+        bench::add(std::string("ecc/scan/") + (bitmap ? "bitmap" : "tonelli_shanks"), [=](State &state) {
+            PointScanner scanner(P, 2, 3, bitmap);
+            uint64_t points = 0;
+            for (auto _ : state) scanner.scan(0, P, [&](uint64_t, uint64_t) { points++; });
+            bench::doNotOptimize(points);
+            state.setItemsProcessed(points);
+            state.counter("x_per_second", double(state.iterations() * P), true);
+        });
+    }
+    for (bool pooled : {false, true}) {
+        for (auto format : {PointFormat::Text, PointFormat::Binary}) {
+            if (pooled && (sharedPool().size() == 1 || format == PointFormat::Binary)) continue;
+            std::string name = std::string("ecc/list/") + (format == PointFormat::Text ? "text" : "binary") +
+                               (pooled ? poolSuffix() : "/threads:1");
+            bench::add(name, [=](State &state) {
+                PointScanner scanner(P, 2, 3);
+                ThreadPool single(1);
+                ThreadPool &pool = pooled ? sharedPool() : single;
+                std::FILE *null = std::fopen("/dev/null", "wb");
+                if (!null) return state.skip("no /dev/null");
+                uint64_t points = 0;
+                for (auto _ : state) points += streamPoints(scanner, pool, null, format);
+                std::fclose(null);
+                state.setThreads(pool.size());
+                state.setItemsProcessed(points);
+            });
+        }
+    }
+}
+
+// --- Batch scheduler ---
+void registerBatch() {
+    // 64 S-AES and 64 S-DES buffers of 16 KiB, 2 DH-2048 and 64 P-256 handshakes.
+    bench::add("batch/mixed" + poolSuffix(), [](State &state) {
+        std::mt19937_64 rng(13);
+        std::vector<uint8_t> in(std::size_t(128) << 14, 0x3c), out(in.size());
+        std::vector<Modp2048::Int> dhPeers;
+        std::vector<EcCurve<4>::Affine> ecPeers;
+        for (int i = 0; i < 2; i++) dhPeers.push_back(modp2048().publicKey(modp2048().randomPrivateKey(rng)));
+        for (int i = 0; i < 64; i++) ecPeers.push_back(p256().publicKey(p256().randomPrivateKey(rng)));
+        cybersec::BatchScheduler batch(sharedPool(), 1);
+        for (auto _ : state) {
+            for (std::size_t i = 0; i < 128; i++) {
+                std::span<const uint8_t> src(in.data() + (i << 14), std::size_t(1) << 14);
+                std::span<uint8_t> dst(out.data() + (i << 14), std::size_t(1) << 14);
+                if (i % 2) batch.ctr(batch.make<cybersec::SdesCipher>(uint16_t(i)), uint8_t(i), src, dst);
+                else batch.ctr(batch.make<cybersec::SaesCipher>(uint16_t(i)), uint16_t(i), src, dst);
+            }
+            batch.agree(modp2048(), std::span<const Modp2048::Int>(dhPeers));
+            batch.agree(p256(), std::span<const EcCurve<4>::Affine>(ecPeers));
+            batch.run();
+            batch.clear();
+        }
+        state.setThreads(sharedPool().size());
+        state.setItemsProcessed(state.iterations() * (128 + dhPeers.size() + ecPeers.size()));
+        state.setBytesProcessed(state.iterations() * in.size());
+    });
+    bench::add("batch/ecdh/p256" + poolSuffix(), [](State &state) {
+        std::mt19937_64 rng(17);
+        std::vector<EcCurve<4>::Affine> peers;
+        for (int i = 0; i < 64; i++) peers.push_back(p256().publicKey(p256().randomPrivateKey(rng)));
+        cybersec::BatchScheduler batch(sharedPool(), 1);
+        for (auto _ : state) {
+            auto records = batch.agree(p256(), std::span<const EcCurve<4>::Affine>(peers));
+            batch.run();
+            bench::doNotOptimize(records[0].secret.limb[0]);
+            batch.clear();
+        }
+        state.setThreads(sharedPool().size());
+        state.setItemsProcessed(state.iterations() * peers.size());
+    });
+}
+
+int main(int argc, char *argv[]) {
+    registerSdes();
+    registerSaes();
+    registerRsa<16>(true);
+    registerRsa<32>(true);
+    registerRsa<48>(false); // keygen above 2048 bits takes seconds per key
+    registerRsa<64>(false);
+    registerDh<32>(modp2048);
+    registerDh<48>(modp3072);
+    registerDh<64>(modp4096);
+    registerDhCipher();
+    registerEcdh("p256", p256);
+    registerEcdh("secp256k1", secp256k1);
+    registerEcc();
+    registerBatch();
+    return bench::runAll(argc, argv,
+                         {{"sdes_bitslice_kernel", sdes_bitslice::kernelName(sdes_bitslice::activeKernel())},
+                          {"saes_simd_kernel", saes_simd::kernelName(saes_simd::activeKernel())},
+                          {"thread_pool_size", std::to_string(sharedPool().size())}});
+}
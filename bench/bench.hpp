@@ -0,0 +1,405 @@
+#pragma once
+
+/*
+ * Minimal benchmark harness in the Google Benchmark mould
+ * --------------------------------------------------------
+ * A benchmark is a name and a function taking a State. Set-up goes before
+ * the timed loop, `for (auto _ : state)` runs the body state.iterations()
+ * times, and throughput is declared with setItemsProcessed() or
+ * setBytesProcessed(). The runner grows the iteration count until one run
+ * lasts at least the minimum time, like Google Benchmark does, and repeats
+ * it when asked.
+ *
+ * The JSON report follows Google Benchmark's schema (a "context" object and
+ * a "benchmarks" array with real_time, cpu_time, items_per_second, ...), so
+ * its tools/compare.py can diff two runs. The harness itself has no
+ * dependencies beyond the standard library and POSIX clocks.
+ *
+ * Flags (Google Benchmark spellings):
+ *   --benchmark_filter=<regex>       run only the matching names
+ *   --benchmark_min_time=<seconds>   default 0.5
+ *   --benchmark_repetitions=<n>      adds mean / median / stddev rows
+ *   --benchmark_format=console|json  report on stdout
+ *   --benchmark_out=<file>           JSON report to a file as well
+ *   --benchmark_list_tests           print the names and exit
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace bench {
+
+// Keeps a value alive and opaque to the optimiser without storing it.
+template <class T>
+inline void doNotOptimize(T &&value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobberMemory() { asm volatile("" : : : "memory"); }
+
+class State {
+public:
+    State(uint64_t iterations, unsigned threads) : iters(iterations), threadCount(threads) {}
+
+    // The loop variable's type; marked unused so `for (auto _ : state)` stays quiet.
+    struct __attribute__((unused)) Value {};
+
+    struct Iterator {
+        uint64_t left;
+        State *state;
+
+        bool operator!=(const Iterator &) const {
+            if (left) return true;
+            state->stopTimer();
+            return false;
+        }
+        void operator++() { left--; }
+        Value operator*() const { return {}; }
+    };
+
+    Iterator begin() {
+        startTimer();
+        return {iters, this};
+    }
+    Iterator end() { return {0, this}; }
+
+    uint64_t iterations() const { return iters; }
+
+    // Work done over the whole run, for items_per_second and bytes_per_second.
+    void setItemsProcessed(uint64_t items) { itemCount = items; }
+    void setBytesProcessed(uint64_t bytes) { byteCount = bytes; }
+
+    // Worker threads the body uses, reported in the "threads" field.
+    void setThreads(unsigned threads) { threadCount = threads; }
+
+    // Extra values for the report; rate counters are divided by real time.
+    void counter(const std::string &name, double value, bool rate = false) { counters[name] = {value, rate}; }
+
+    // Skips the benchmark with a message (missing CPU feature, and so on).
+    void skip(const std::string &why) { skipReason = why; }
+
+private:
+    friend struct Runner;
+
+    static double cpuNow() {
+        timespec ts;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        return double(ts.tv_sec) + double(ts.tv_nsec) * 1e-9;
+    }
+
+    void startTimer() {
+        wallStart = std::chrono::steady_clock::now();
+        cpuStart = cpuNow();
+    }
+
+    void stopTimer() {
+        realSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        cpuSeconds = cpuNow() - cpuStart;
+    }
+
+    uint64_t iters;
+    unsigned threadCount;
+    uint64_t itemCount = 0, byteCount = 0;
+    std::map<std::string, std::pair<double, bool>> counters;
+    std::string skipReason;
+    std::chrono::steady_clock::time_point wallStart;
+    double cpuStart = 0, realSeconds = 0, cpuSeconds = 0;
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void(State &)> body;
+};
+
+inline std::vector<Benchmark> &registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+inline void add(std::string name, std::function<void(State &)> body) {
+    registry().push_back({std::move(name), std::move(body)});
+}
+
+// One reported row: a repetition, or an aggregate over the repetitions.
+struct Result {
+    std::string name, runName, aggregate; // aggregate: "", "mean", "median" or "stddev"
+    std::size_t family = 0, repetition = 0, repetitions = 1;
+    unsigned threads = 1;
+    uint64_t iterations = 0;
+    double realNs = 0, cpuNs = 0; // per iteration
+    double itemsPerSecond = 0, bytesPerSecond = 0;
+    std::map<std::string, double> counters;
+    std::string skipped;
+};
+
+struct Options {
+    std::string filter = ".*", format = "console", out;
+    double minTime = 0.5;
+    std::size_t repetitions = 1;
+    bool list = false;
+};
+
+inline std::string jsonEscape(const std::string &s) {
+    std::string r;
+    for (char c : s) {
+        if (c == '"' || c == '\\') r += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "\\u%04x", c);
+            r += buf;
+        } else {
+            r += c;
+        }
+    }
+    return r;
+}
+
+struct Runner {
+    // Runs the benchmark with a growing iteration count until one run covers minTime.
+    static Result measure(const Benchmark &b, double minTime) {
+        uint64_t n = 1;
+        for (;;) {
+            State state(n, 1);
+            b.body(state);
+            Result r;
+            r.name = r.runName = b.name;
+            r.threads = state.threadCount;
+            r.iterations = n;
+            if (!state.skipReason.empty()) {
+                r.skipped = state.skipReason;
+                return r;
+            }
+            bool done = state.realSeconds >= minTime || n >= (uint64_t(1) << 40);
+            if (done) {
+                double secs = std::max(state.realSeconds, 1e-12);
+                r.realNs = state.realSeconds * 1e9 / double(n);
+                r.cpuNs = state.cpuSeconds * 1e9 / double(n);
+                if (state.itemCount) r.itemsPerSecond = double(state.itemCount) / secs;
+                if (state.byteCount) r.bytesPerSecond = double(state.byteCount) / secs;
+                for (auto &[key, value] : state.counters) r.counters[key] = value.second ? value.first / secs : value.first;
+                return r;
+            }
+            // Aim 40% past minTime, growing by at most 10x per step.
+            double grow = state.realSeconds > 0 ? minTime * 1.4 / state.realSeconds : 10.0;
+            n = std::max(n + 1, uint64_t(double(n) * std::min(grow, 10.0)));
+        }
+    }
+
+    static std::vector<Result> aggregates(const std::vector<Result> &reps) {
+        auto stat = [&](auto get, const char *which) {
+            std::vector<double> v;
+            for (const Result &r : reps) v.push_back(get(r));
+            double mean = 0;
+            for (double x : v) mean += x;
+            mean /= double(v.size());
+            if (std::string(which) == "mean") return mean;
+            if (std::string(which) == "median") {
+                std::sort(v.begin(), v.end());
+                return v.size() % 2 ? v[v.size() / 2] : (v[v.size() / 2 - 1] + v[v.size() / 2]) / 2;
+            }
+            double ss = 0;
+            for (double x : v) ss += (x - mean) * (x - mean);
+            return v.size() > 1 ? std::sqrt(ss / double(v.size() - 1)) : 0.0;
+        };
+        std::vector<Result> out;
+        for (const char *which : {"mean", "median", "stddev"}) {
+            Result a = reps[0];
+            a.aggregate = which;
+            a.name = a.runName + "_" + which;
+            a.realNs = stat([](const Result &r) { return r.realNs; }, which);
+            a.cpuNs = stat([](const Result &r) { return r.cpuNs; }, which);
+            a.itemsPerSecond = stat([](const Result &r) { return r.itemsPerSecond; }, which);
+            a.bytesPerSecond = stat([](const Result &r) { return r.bytesPerSecond; }, which);
+            for (auto &[key, value] : a.counters) {
+                (void)value;
+                a.counters[key] = stat([&key](const Result &r) { return r.counters.at(key); }, which);
+            }
+            out.push_back(a);
+        }
+        return out;
+    }
+};
+
+// --- Reports ---
+
+inline std::string humanRate(double perSecond, const char *unit) {
+    const char *prefix[] = {"", "k", "M", "G", "T"};
+    int i = 0;
+    while (perSecond >= 1000 && i < 4) {
+        perSecond /= 1000;
+        i++;
+    }
+    char buf[48];
+    std::snprintf(buf, sizeof buf, "%.4g%s%s/s", perSecond, prefix[i], unit);
+    return buf;
+}
+
+inline void printConsoleHeader() {
+    std::printf("%-52s %13s %13s %12s  %s\n", "Benchmark", "Time", "CPU", "Iterations", "Throughput");
+    std::printf("%s\n", std::string(110, '-').c_str());
+}
+
+inline void printConsoleRow(const Result &r) {
+    if (!r.skipped.empty()) {
+        std::printf("%-52s SKIPPED: %s\n", r.name.c_str(), r.skipped.c_str());
+        return;
+    }
+    std::string extra;
+    if (r.bytesPerSecond) extra += "bytes_per_second=" + humanRate(r.bytesPerSecond, "B") + " ";
+    if (r.itemsPerSecond) extra += "items_per_second=" + humanRate(r.itemsPerSecond, "") + " ";
+    for (auto &[key, value] : r.counters) {
+        char buf[64];
+        std::snprintf(buf, sizeof buf, "%s=%.4g ", key.c_str(), value);
+        extra += buf;
+    }
+    std::printf("%-52s %10.0f ns %10.0f ns %12llu  %s\n", r.name.c_str(), r.realNs, r.cpuNs,
+                static_cast<unsigned long long>(r.iterations), extra.c_str());
+    std::fflush(stdout);
+}
+
+inline void writeJson(std::FILE *f, const std::vector<Result> &results,
+                      const std::vector<std::pair<std::string, std::string>> &context, const char *executable) {
+    char host[256] = "";
+    gethostname(host, sizeof host - 1);
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+    std::fprintf(f, "{\n  \"context\": {\n");
+    std::fprintf(f, "    \"date\": \"%s\",\n    \"host_name\": \"%s\",\n    \"executable\": \"%s\",\n", date,
+                 jsonEscape(host).c_str(), jsonEscape(executable).c_str());
+    std::fprintf(f, "    \"num_cpus\": %u,\n", std::max(1u, std::thread::hardware_concurrency()));
+    for (auto &[key, value] : context)
+        std::fprintf(f, "    \"%s\": \"%s\",\n", jsonEscape(key).c_str(), jsonEscape(value).c_str());
+#ifdef NDEBUG
+    std::fprintf(f, "    \"library_build_type\": \"release\"\n  },\n");
+#else
+    std::fprintf(f, "    \"library_build_type\": \"debug\"\n  },\n");
+#endif
+    std::fprintf(f, "  \"benchmarks\": [");
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        std::fprintf(f, "%s\n    {\n", i ? "," : "");
+        std::fprintf(f, "      \"name\": \"%s\",\n      \"family_index\": %zu,\n", jsonEscape(r.name).c_str(), r.family);
+        std::fprintf(f, "      \"per_family_instance_index\": 0,\n      \"run_name\": \"%s\",\n",
+                     jsonEscape(r.runName).c_str());
+        std::fprintf(f, "      \"run_type\": \"%s\",\n", r.aggregate.empty() ? "iteration" : "aggregate");
+        std::fprintf(f, "      \"repetitions\": %zu,\n", r.repetitions);
+        if (r.aggregate.empty()) std::fprintf(f, "      \"repetition_index\": %zu,\n", r.repetition);
+        else std::fprintf(f, "      \"aggregate_name\": \"%s\",\n", r.aggregate.c_str());
+        std::fprintf(f, "      \"threads\": %u,\n", r.threads);
+        if (!r.skipped.empty()) {
+            std::fprintf(f, "      \"error_occurred\": true,\n      \"error_message\": \"%s\"\n    }",
+                         jsonEscape(r.skipped).c_str());
+            continue;
+        }
+        std::fprintf(f, "      \"iterations\": %llu,\n", static_cast<unsigned long long>(r.iterations));
+        std::fprintf(f, "      \"real_time\": %.6e,\n      \"cpu_time\": %.6e,\n      \"time_unit\": \"ns\"", r.realNs,
+                     r.cpuNs);
+        if (r.bytesPerSecond) std::fprintf(f, ",\n      \"bytes_per_second\": %.6e", r.bytesPerSecond);
+        if (r.itemsPerSecond) std::fprintf(f, ",\n      \"items_per_second\": %.6e", r.itemsPerSecond);
+        for (auto &[key, value] : r.counters) std::fprintf(f, ",\n      \"%s\": %.6e", jsonEscape(key).c_str(), value);
+        std::fprintf(f, "\n    }");
+    }
+    std::fprintf(f, "\n  ]\n}\n");
+}
+
+// --- Driver ---
+
+inline Options parseOptions(int argc, char *argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const char *flag) -> const char * {
+            std::size_t n = std::char_traits<char>::length(flag);
+            return arg.compare(0, n, flag) == 0 ? arg.c_str() + n : nullptr;
+        };
+        if (const char *v = value("--benchmark_filter=")) opt.filter = v;
+        else if (const char *v = value("--benchmark_min_time=")) opt.minTime = std::stod(v);
+        else if (const char *v = value("--benchmark_repetitions=")) opt.repetitions = std::max(1, std::stoi(v));
+        else if (const char *v = value("--benchmark_format=")) opt.format = v;
+        else if (const char *v = value("--benchmark_out=")) opt.out = v;
+        else if (arg == "--benchmark_list_tests" || arg == "--benchmark_list_tests=true") opt.list = true;
+        else throw std::invalid_argument("unknown flag " + arg);
+    }
+    if (opt.format != "console" && opt.format != "json") throw std::invalid_argument("format must be console or json");
+    return opt;
+}
+
+// Runs every registered benchmark matching the filter; returns the exit code.
+inline int runAll(int argc, char *argv[], const std::vector<std::pair<std::string, std::string>> &context = {}) {
+    Options opt;
+    std::regex filter;
+    try {
+        opt = parseOptions(argc, argv);
+        try {
+            filter = std::regex(opt.filter);
+        } catch (const std::regex_error &e) {
+            throw std::invalid_argument("bad --benchmark_filter regex: " + std::string(e.what()));
+        }
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s\nflags: --benchmark_filter=<regex> --benchmark_min_time=<s> "
+                             "--benchmark_repetitions=<n> --benchmark_format=console|json --benchmark_out=<file> "
+                             "--benchmark_list_tests\n",
+                     e.what());
+        return 2;
+    }
+    bool console = opt.format == "console";
+    if (console && !opt.list) {
+        for (auto &[key, value] : context) std::printf("%s: %s\n", key.c_str(), value.c_str());
+        printConsoleHeader();
+    }
+    std::vector<Result> results;
+    for (std::size_t family = 0; family < registry().size(); family++) {
+        const Benchmark &b = registry()[family];
+        if (!std::regex_search(b.name, filter)) continue;
+        if (opt.list) {
+            std::printf("%s\n", b.name.c_str());
+            continue;
+        }
+        std::vector<Result> reps;
+        for (std::size_t rep = 0; rep < opt.repetitions; rep++) {
+            Result r = Runner::measure(b, opt.minTime);
+            r.family = family;
+            r.repetition = rep;
+            r.repetitions = opt.repetitions;
+            if (console) printConsoleRow(r);
+            reps.push_back(r);
+            if (!r.skipped.empty()) break;
+        }
+        results.insert(results.end(), reps.begin(), reps.end());
+        if (reps.size() > 1) {
+            for (const Result &a : Runner::aggregates(reps)) {
+                if (console) printConsoleRow(a);
+                results.push_back(a);
+            }
+        }
+    }
+    if (opt.list) return 0;
+    if (!console) writeJson(stdout, results, context, argv[0]);
+    if (!opt.out.empty()) {
+        std::FILE *f = std::fopen(opt.out.c_str(), "w");
+        if (!f) {
+            std::fprintf(stderr, "cannot write %s\n", opt.out.c_str());
+            return 1;
+        }
+        writeJson(f, results, context, argv[0]);
+        std::fclose(f);
+    }
+    return 0;
+}
+
+} // namespace bench
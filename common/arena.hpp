@@ -0,0 +1,148 @@
+#pragma once
+
+/*
+ * Bump-pointer arena for per-request state
+ * ----------------------------------------
+ * Arena hands out memory by advancing an offset through large chunks and
+ * gives all of it back at once with reset(). A batch of requests allocates
+ * its records, keyed contexts and scratch from one arena and frees them
+ * together when the batch is done, so the steady state allocates nothing:
+ * reset() keeps the chunks, and if a round needed more than one it merges
+ * them into a single chunk of the combined size for the next round.
+ *
+ * Nothing placed in an arena is destroyed, so make() and array() only
+ * accept trivially destructible types. ArenaAllocator<T> lets standard
+ * containers draw from an arena; its deallocate() does nothing and the
+ * memory comes back with the next reset().
+ *
+ * An arena is not thread-safe. Every worker that needs scratch space keeps
+ * its own.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "instrument.hpp"
+
+class Arena {
+public:
+    static constexpr std::size_t DEFAULT_CHUNK = std::size_t(64) << 10;
+
+    explicit Arena(std::size_t chunkBytes = DEFAULT_CHUNK) : chunkBytes(std::max<std::size_t>(chunkBytes, 64)) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    Arena(Arena &&) = default;
+    Arena &operator=(Arena &&) = default;
+
+    // `bytes` of uninitialised memory aligned to `align` (a power of two).
+    void *allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+        for (;;) {
+            if (current < chunks.size()) {
+                Chunk &c = chunks[current];
+                uintptr_t base = reinterpret_cast<uintptr_t>(c.data.get());
+                std::size_t start = std::size_t(((base + offset + align - 1) & ~uintptr_t(align - 1)) - base);
+                if (start + bytes <= c.size) {
+                    offset = start + bytes;
+                    used += bytes;
+                    return c.data.get() + start;
+                }
+                if (current + 1 < chunks.size()) {
+                    current++;
+                    offset = 0;
+                    continue;
+                }
+            }
+            grow(bytes + align);
+        }
+    }
+
+    template <class T, class... Args>
+    T *make(Args &&...args) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // n value-initialised objects of type T.
+    template <class T>
+    T *array(std::size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        T *p = static_cast<T *>(allocate(sizeof(T) * std::max<std::size_t>(n, 1), alignof(T)));
+        for (std::size_t i = 0; i < n; i++) new (p + i) T();
+        return p;
+    }
+
+    // Frees everything at once. Pointers from earlier allocations become invalid.
+    void reset() {
+        if (chunks.size() > 1) {
+            std::size_t total = 0;
+            for (const Chunk &c : chunks) total += c.size;
+            chunks.clear();
+            addChunk(total);
+        }
+        current = 0;
+        offset = 0;
+        used = 0;
+    }
+
+    std::size_t bytesUsed() const { return used; }
+
+    std::size_t bytesReserved() const {
+        std::size_t total = 0;
+        for (const Chunk &c : chunks) total += c.size;
+        return total;
+    }
+
+private:
+    struct Chunk {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    void grow(std::size_t atLeast) {
+        addChunk(std::max(chunkBytes, atLeast));
+        current = chunks.size() - 1;
+        offset = 0;
+    }
+
+    void addChunk(std::size_t bytes) {
+        instrument::count(instrument::Counter::Allocations);
+        chunks.push_back({std::unique_ptr<std::byte[]>(new std::byte[bytes]), bytes});
+    }
+
+    std::size_t chunkBytes;
+    std::vector<Chunk> chunks;
+    std::size_t current = 0; // chunk being filled
+    std::size_t offset = 0;  // first free byte in it
+    std::size_t used = 0;
+};
+
+// Standard allocator over an arena, e.g. std::vector<T, ArenaAllocator<T>>.
+template <class T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena &arena) : arena(&arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(std::size_t n) { return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, std::size_t) {}
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+
+private:
+    template <class U>
+    friend class ArenaAllocator;
+    Arena *arena;
+};
@@ -0,0 +1,736 @@
+#pragma once
+
+/*
+ * Fixed-width unsigned big integers and Montgomery arithmetic
+ * -----------------------------------------------------------
+ * BigInt<LIMBS> is LIMBS 64-bit words, least significant first, so
+ * BigInt<32> holds a 2048-bit RSA modulus. There is no heap allocation
+ * and no sign; everything the RSA code needs is modular arithmetic on
+ * values below an odd modulus.
+ *
+ * Montgomery<LIMBS> keeps numbers in Montgomery form a*R mod n with
+ * R = 2^(64*LIMBS). A product then needs no division, only the
+ * word-by-word CIOS reduction, and modexp() runs a left-to-right sliding
+ * window over the exponent with a table of odd powers.
+ *
+ * ExpMode::ConstantTime swaps the sliding window for a fixed 4- or 5-bit
+ * window over every bit position of the exponent type, so the sequence of
+ * squarings and products does not depend on the exponent. Its table is
+ * scattered limb-major: limb i of all entries sits in one row of whole
+ * cache lines, and a gather reads every entry of every row and keeps the
+ * wanted one with a mask. The memory access pattern is then the same for every
+ * window value. Products always end with a masked final subtraction.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "instrument.hpp"
+
+namespace bignum {
+
+using u128 = unsigned __int128;
+
+enum class ExpMode { SlidingWindow, ConstantTime };
+
+template <std::size_t LIMBS>
+struct BigInt {
+    static_assert(LIMBS > 0, "BigInt needs at least one limb");
+    static constexpr std::size_t BITS = 64 * LIMBS;
+
+    std::array<uint64_t, LIMBS> limb{};
+
+    constexpr BigInt() = default;
+    constexpr BigInt(uint64_t v) { limb[0] = v; }
+
+    static BigInt fromHex(const std::string &hex) {
+        BigInt r;
+        std::size_t bit = 0;
+        for (auto it = hex.rbegin(); it != hex.rend(); ++it) {
+            char ch = *it;
+            if (ch == '_' || ch == ' ') continue;
+            uint64_t v;
+            if (ch >= '0' && ch <= '9') v = uint64_t(ch - '0');
+            else if (ch >= 'a' && ch <= 'f') v = uint64_t(ch - 'a' + 10);
+            else if (ch >= 'A' && ch <= 'F') v = uint64_t(ch - 'A' + 10);
+            else throw std::invalid_argument("bignum: bad hex digit");
+            if (v && bit >= BITS) throw std::overflow_error("bignum: hex value does not fit");
+            if (bit < BITS) r.limb[bit / 64] |= v << (bit % 64);
+            bit += 4;
+        }
+        return r;
+    }
+
+    static BigInt fromDecimal(const std::string &dec) {
+        BigInt r;
+        for (char ch : dec) {
+            if (ch < '0' || ch > '9') throw std::invalid_argument("bignum: bad decimal digit");
+            if (r.mulSmall(10) || r.addSmall(uint64_t(ch - '0'))) throw std::overflow_error("bignum: decimal value does not fit");
+        }
+        return r;
+    }
+
+    std::string toHex() const {
+        static const char *digits = "0123456789abcdef";
+        std::string s;
+        for (std::size_t i = LIMBS; i-- > 0;)
+            for (int shift = 60; shift >= 0; shift -= 4) s += digits[(limb[i] >> shift) & 0xF];
+        std::size_t first = s.find_first_not_of('0');
+        return first == std::string::npos ? "0" : s.substr(first);
+    }
+
+    std::string toDecimal() const {
+        BigInt v = *this;
+        std::string s;
+        do {
+            uint64_t rem = v.divSmall(10);
+            s += char('0' + rem);
+        } while (!v.isZero());
+        return std::string(s.rbegin(), s.rend());
+    }
+
+    bool isZero() const {
+        for (uint64_t w : limb)
+            if (w) return false;
+        return true;
+    }
+
+    bool isOdd() const { return limb[0] & 1; }
+
+    bool bit(std::size_t i) const { return (limb[i / 64] >> (i % 64)) & 1; }
+
+    std::size_t bitLength() const {
+        for (std::size_t i = LIMBS; i-- > 0;)
+            if (limb[i]) return 64 * i + 64 - std::size_t(__builtin_clzll(limb[i]));
+        return 0;
+    }
+
+    // Bits [pos, pos + count) as a number, count <= 64.
+    uint64_t bits(std::size_t pos, std::size_t count) const {
+        uint64_t v = 0;
+        for (std::size_t i = 0; i < count && pos + i < BITS; i++) v |= uint64_t(bit(pos + i)) << i;
+        return v;
+    }
+
+    // a where mask is all ones, b where it is zero, without branching.
+    static BigInt select(uint64_t mask, const BigInt &a, const BigInt &b) {
+        BigInt r;
+        for (std::size_t i = 0; i < LIMBS; i++) r.limb[i] = (a.limb[i] & mask) | (b.limb[i] & ~mask);
+        return r;
+    }
+
+    friend std::size_t popcount(const BigInt &a) {
+        std::size_t c = 0;
+        for (uint64_t w : a.limb) c += std::size_t(__builtin_popcountll(w));
+        return c;
+    }
+
+    friend int compare(const BigInt &a, const BigInt &b) {
+        for (std::size_t i = LIMBS; i-- > 0;)
+            if (a.limb[i] != b.limb[i]) return a.limb[i] < b.limb[i] ? -1 : 1;
+        return 0;
+    }
+    friend bool operator==(const BigInt &a, const BigInt &b) { return a.limb == b.limb; }
+    friend bool operator!=(const BigInt &a, const BigInt &b) { return a.limb != b.limb; }
+    friend bool operator<(const BigInt &a, const BigInt &b) { return compare(a, b) < 0; }
+    friend bool operator>=(const BigInt &a, const BigInt &b) { return compare(a, b) >= 0; }
+
+    // In-place arithmetic; each returns the carry (or borrow) out of the top limb.
+    uint64_t add(const BigInt &b) {
+        uint64_t carry = 0;
+        for (std::size_t i = 0; i < LIMBS; i++) {
+            u128 s = u128(limb[i]) + b.limb[i] + carry;
+            limb[i] = uint64_t(s);
+            carry = uint64_t(s >> 64);
+        }
+        return carry;
+    }
+
+    uint64_t sub(const BigInt &b) {
+        uint64_t borrow = 0;
+        for (std::size_t i = 0; i < LIMBS; i++) {
+            u128 d = u128(limb[i]) - b.limb[i] - borrow;
+            limb[i] = uint64_t(d);
+            borrow = uint64_t(d >> 64) & 1;
+        }
+        return borrow;
+    }
+
+    uint64_t addSmall(uint64_t v) {
+        for (std::size_t i = 0; i < LIMBS && v; i++) {
+            limb[i] += v;
+            v = limb[i] < v;
+        }
+        return v;
+    }
+
+    uint64_t mulSmall(uint64_t m) {
+        uint64_t carry = 0;
+        for (std::size_t i = 0; i < LIMBS; i++) {
+            u128 p = u128(limb[i]) * m + carry;
+            limb[i] = uint64_t(p);
+            carry = uint64_t(p >> 64);
+        }
+        return carry;
+    }
+
+    // Divides in place and returns the remainder.
+    uint64_t divSmall(uint64_t d) {
+        u128 rem = 0;
+        for (std::size_t i = LIMBS; i-- > 0;) {
+            u128 cur = (rem << 64) | limb[i];
+            limb[i] = uint64_t(cur / d);
+            rem = cur % d;
+        }
+        return uint64_t(rem);
+    }
+
+    // Remainder by a small divisor, leaving the value unchanged.
+    uint64_t modSmall(uint64_t d) const {
+        u128 rem = 0;
+        for (std::size_t i = LIMBS; i-- > 0;) rem = ((rem << 64) | limb[i]) % d;
+        return uint64_t(rem);
+    }
+
+    // Shifts right by one; `carryIn` becomes the new top bit.
+    void shiftRight1(uint64_t carryIn = 0) {
+        for (std::size_t i = 0; i < LIMBS; i++) {
+            uint64_t next = i + 1 < LIMBS ? limb[i + 1] : carryIn;
+            limb[i] = (limb[i] >> 1) | (next << 63);
+        }
+    }
+
+    uint64_t shiftLeft1() {
+        uint64_t carry = 0;
+        for (std::size_t i = 0; i < LIMBS; i++) {
+            uint64_t next = limb[i] >> 63;
+            limb[i] = (limb[i] << 1) | carry;
+            carry = next;
+        }
+        return carry;
+    }
+};
+
+// Widens or narrows a value; narrowing must not drop set bits.
+template <std::size_t TO, std::size_t FROM>
+BigInt<TO> resize(const BigInt<FROM> &v) {
+    BigInt<TO> r;
+    for (std::size_t i = 0; i < FROM; i++) {
+        if (i < TO) r.limb[i] = v.limb[i];
+        else if (v.limb[i]) throw std::overflow_error("bignum: value does not fit");
+    }
+    return r;
+}
+
+// --- Multiplication thresholds ---
+
+// Operand sizes in limbs from which a product or square splits with
+// Karatsuba instead of going straight to schoolbook. Montgomery products
+// have their own switch point: below it the fused CIOS loop beats a
+// separate full product and reduction even when the product itself would
+// be faster with Karatsuba. NEVER disables a split. The defaults suit
+// recent x86-64; bignum_tune.hpp measures the crossovers on the host.
+// Set these before any threads start using them.
+struct MulThresholds {
+    static constexpr std::size_t NEVER = std::size_t(-1);
+    std::size_t karatsubaMul = 24;
+    std::size_t karatsubaSqr = 48;
+    std::size_t montgomeryMul = 48;
+};
+
+inline MulThresholds &mulThresholds() {
+    static MulThresholds thresholds;
+    return thresholds;
+}
+
+// --- Limb kernels ---
+// Runtime-length routines on little-endian limb arrays, shared by mulWide()
+// and Montgomery. None of them branch on limb values, so the constant-time
+// exponentiation can use the Karatsuba paths too.
+namespace detail {
+
+// r = a + b + carry over n limbs (r may alias a or b); returns the carry out.
+inline uint64_t addN(uint64_t *r, const uint64_t *a, const uint64_t *b, std::size_t n, uint64_t carry = 0) {
+    for (std::size_t i = 0; i < n; i++) {
+        u128 s = u128(a[i]) + b[i] + carry;
+        r[i] = uint64_t(s);
+        carry = uint64_t(s >> 64);
+    }
+    return carry;
+}
+
+// r = a - b over n limbs; returns the borrow out.
+inline uint64_t subN(uint64_t *r, const uint64_t *a, const uint64_t *b, std::size_t n) {
+    uint64_t borrow = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        u128 d = u128(a[i]) - b[i] - borrow;
+        r[i] = uint64_t(d);
+        borrow = uint64_t(d >> 64) & 1;
+    }
+    return borrow;
+}
+
+// Adds carry into r[0, n); returns the carry out.
+inline uint64_t addCarry(uint64_t *r, std::size_t n, uint64_t carry) {
+    for (std::size_t i = 0; i < n; i++) {
+        u128 s = u128(r[i]) + carry;
+        r[i] = uint64_t(s);
+        carry = uint64_t(s >> 64);
+    }
+    return carry;
+}
+
+// r = |a - b| for an n-limb a and an m-limb b (m <= n); returns 1 if a < b.
+// The difference is negated under a mask rather than recomputed as b - a.
+inline uint64_t absDiff(uint64_t *r, const uint64_t *a, std::size_t n, const uint64_t *b, std::size_t m) {
+    uint64_t borrow = subN(r, a, b, m);
+    for (std::size_t i = m; i < n; i++) {
+        r[i] = a[i] - borrow;
+        borrow &= a[i] == 0;
+    }
+    uint64_t mask = 0 - borrow, carry = borrow;
+    for (std::size_t i = 0; i < n; i++) {
+        u128 s = u128(r[i] ^ mask) + carry;
+        r[i] = uint64_t(s);
+        carry = uint64_t(s >> 64);
+    }
+    return borrow;
+}
+
+// r[0, 2n) = a * b, schoolbook.
+inline void mulBasecase(uint64_t *r, const uint64_t *a, const uint64_t *b, std::size_t n) {
+    std::fill(r, r + 2 * n, 0);
+    for (std::size_t i = 0; i < n; i++) {
+        uint64_t carry = 0;
+        for (std::size_t j = 0; j < n; j++) {
+            u128 s = u128(a[j]) * b[i] + r[i + j] + carry;
+            r[i + j] = uint64_t(s);
+            carry = uint64_t(s >> 64);
+        }
+        r[i + n] = carry;
+    }
+}
+
+// r[0, 2n) = a^2. The cross products a[i]*a[j], i < j, are computed once and
+// doubled, so a squaring costs about 3/4 of a general product.
+inline void sqrBasecase(uint64_t *r, const uint64_t *a, std::size_t n) {
+    std::fill(r, r + 2 * n, 0);
+    for (std::size_t i = 0; i < n; i++) {
+        uint64_t carry = 0;
+        for (std::size_t j = i + 1; j < n; j++) {
+            u128 s = u128(a[i]) * a[j] + r[i + j] + carry;
+            r[i + j] = uint64_t(s);
+            carry = uint64_t(s >> 64);
+        }
+        r[i + n] = carry;
+    }
+    uint64_t top = 0;
+    for (std::size_t i = 0; i < 2 * n; i++) {
+        uint64_t next = r[i] >> 63;
+        r[i] = (r[i] << 1) | top;
+        top = next;
+    }
+    uint64_t carry = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        u128 sq = u128(a[i]) * a[i];
+        u128 s = u128(r[2 * i]) + uint64_t(sq) + carry;
+        r[2 * i] = uint64_t(s);
+        s = u128(r[2 * i + 1]) + uint64_t(sq >> 64) + uint64_t(s >> 64);
+        r[2 * i + 1] = uint64_t(s);
+        carry = uint64_t(s >> 64);
+    }
+}
+
+// Scratch words an n-limb Karatsuba product or square needs, at any threshold.
+constexpr std::size_t karatsubaScratch(std::size_t n) {
+    return n < 2 ? 0 : 4 * ((n + 1) / 2) + 1 + karatsubaScratch((n + 1) / 2);
+}
+
+// Adds the middle term z1 = z0 + z2 +- |a0 - a1| * |b0 - b1| (the product
+// held in dm) at offset h. r holds z0 in [0, 2h) and z2 in [2h, 2n).
+// `subtract` is all ones to subtract dm, i.e. add its two's complement
+// ~dm + 1 over 2h + 1 words, and zero to add it.
+inline void karatsubaMiddle(uint64_t *r, std::size_t n, std::size_t h, const uint64_t *dm, uint64_t subtract,
+                            uint64_t *z1) {
+    std::size_t k = n - h;
+    std::copy(r + 2 * k, r + 2 * h, z1 + 2 * k);
+    uint64_t top = addN(z1, r, r + 2 * h, 2 * k);
+    top = addCarry(z1 + 2 * k, 2 * h - 2 * k, top);
+    uint64_t carry = subtract & 1;
+    for (std::size_t i = 0; i < 2 * h; i++) {
+        u128 s = u128(z1[i]) + (dm[i] ^ subtract) + carry;
+        z1[i] = uint64_t(s);
+        carry = uint64_t(s >> 64);
+    }
+    z1[2 * h] = top + subtract + carry; // the true z1 is nonnegative and fits 2h + 1 words
+    std::size_t len = std::min(2 * h + 1, 2 * n - h);
+    uint64_t c = addN(r + h, r + h, z1, len);
+    addCarry(r + h + len, 2 * n - h - len, c);
+}
+
+// r[0, 2n) = a * b; halves below `threshold` limbs use schoolbook.
+inline void mulKaratsuba(uint64_t *r, const uint64_t *a, const uint64_t *b, std::size_t n, uint64_t *scratch,
+                         std::size_t threshold) {
+    if (n < threshold || n < 4) {
+        mulBasecase(r, a, b, n);
+        return;
+    }
+    std::size_t h = (n + 1) / 2, k = n - h;
+    uint64_t *da = scratch, *db = scratch + h, *dm = scratch + 2 * h + 1, *next = scratch + 4 * h + 1;
+    uint64_t sa = absDiff(da, a, h, a + h, k);
+    uint64_t sb = absDiff(db, b, h, b + h, k);
+    mulKaratsuba(dm, da, db, h, next, threshold);
+    mulKaratsuba(r, a, b, h, next, threshold);
+    mulKaratsuba(r + 2 * h, a + h, b + h, k, next, threshold);
+    karatsubaMiddle(r, n, h, dm, (sa ^ sb) - 1, scratch); // same signs: subtract
+}
+
+// r[0, 2n) = a^2; the middle term is z0 + z2 - (a0 - a1)^2.
+inline void sqrKaratsuba(uint64_t *r, const uint64_t *a, std::size_t n, uint64_t *scratch, std::size_t threshold) {
+    if (n < threshold || n < 4) {
+        sqrBasecase(r, a, n);
+        return;
+    }
+    std::size_t h = (n + 1) / 2, k = n - h;
+    uint64_t *da = scratch, *dm = scratch + 2 * h + 1, *next = scratch + 4 * h + 1;
+    absDiff(da, a, h, a + h, k);
+    sqrKaratsuba(dm, da, h, next, threshold);
+    sqrKaratsuba(r, a, h, next, threshold);
+    sqrKaratsuba(r + 2 * h, a + h, k, next, threshold);
+    karatsubaMiddle(r, n, h, dm, ~uint64_t(0), scratch);
+}
+
+} // namespace detail
+
+// Full product of an A-limb and a B-limb number: Karatsuba for equal sizes
+// past the threshold, schoolbook otherwise.
+template <std::size_t A, std::size_t B>
+BigInt<A + B> mulWide(const BigInt<A> &a, const BigInt<B> &b) {
+    BigInt<A + B> r;
+    if constexpr (A == B) {
+        if (A >= mulThresholds().karatsubaMul) {
+            uint64_t scratch[detail::karatsubaScratch(A) + 1];
+            detail::mulKaratsuba(r.limb.data(), a.limb.data(), b.limb.data(), A, scratch, mulThresholds().karatsubaMul);
+            return r;
+        }
+    }
+    for (std::size_t i = 0; i < B; i++) {
+        uint64_t carry = 0;
+        for (std::size_t j = 0; j < A; j++) {
+            u128 s = u128(a.limb[j]) * b.limb[i] + r.limb[i + j] + carry;
+            r.limb[i + j] = uint64_t(s);
+            carry = uint64_t(s >> 64);
+        }
+        r.limb[i + A] = carry;
+    }
+    return r;
+}
+
+// a mod m for any nonzero m, one bit at a time. Meant for key setup, not hot paths.
+template <std::size_t A, std::size_t M>
+BigInt<M> mod(const BigInt<A> &a, const BigInt<M> &m) {
+    if (m.isZero()) throw std::domain_error("bignum: modulus is zero");
+    BigInt<M> r;
+    for (std::size_t i = a.bitLength(); i-- > 0;) {
+        uint64_t carry = r.shiftLeft1();
+        r.limb[0] |= uint64_t(a.bit(i));
+        if (carry || r >= m) r.sub(m);
+    }
+    return r;
+}
+
+// a^-1 mod m for odd m and gcd(a, m) = 1 (binary extended Euclid). Every
+// step is a subtraction or a halving, so no division is needed.
+template <std::size_t L>
+BigInt<L> modInverse(const BigInt<L> &a, const BigInt<L> &m) {
+    if (!m.isOdd()) throw std::domain_error("bignum: modInverse needs an odd modulus");
+    BigInt<L> u = mod(a, m), v = m, x1(1), x2(0);
+    auto halve = [&](BigInt<L> &x) { // x / 2 mod m
+        uint64_t carry = x.isOdd() ? x.add(m) : 0;
+        x.shiftRight1(carry);
+    };
+    auto subMod = [&](BigInt<L> &x, const BigInt<L> &y) { // x - y mod m
+        if (x.sub(y)) x.add(m);
+    };
+    const BigInt<L> one(1);
+    while (u != one && v != one) {
+        if (u.isZero()) throw std::domain_error("bignum: value is not invertible");
+        while (!u.isOdd()) {
+            u.shiftRight1();
+            halve(x1);
+        }
+        while (!v.isOdd()) {
+            v.shiftRight1();
+            halve(x2);
+        }
+        if (u >= v) {
+            u.sub(v);
+            subMod(x1, x2);
+        } else {
+            v.sub(u);
+            subMod(x2, x1);
+        }
+    }
+    return u == one ? x1 : x2;
+}
+
+// -n^-1 mod 2^64 for odd n, by Newton iteration (each step doubles the correct bits).
+inline uint64_t negInverse64(uint64_t n) {
+    uint64_t inv = n; // correct to 3 bits for odd n
+    for (int i = 0; i < 5; i++) inv *= 2 - n * inv;
+    return ~inv + 1;
+}
+
+template <std::size_t LIMBS>
+class Montgomery {
+public:
+    using Int = BigInt<LIMBS>;
+    static constexpr std::size_t SQR_VIA_MUL = 8;
+
+    explicit Montgomery(const Int &modulus) : n(modulus) {
+        if (!n.isOdd() || compare(n, Int(1)) <= 0) throw std::invalid_argument("Montgomery: modulus must be odd and > 1");
+        nPrime = negInverse64(n.limb[0]);
+        // Write BITS = c * 2^s with c odd. Doubling 1 BITS times gives R mod n,
+        // c more doublings give 2^c * R, and since a Montgomery squaring maps
+        // 2^a * R to 2^(2a) * R, s squarings of that reach 2^BITS * R = R^2.
+        // That is BITS + c cheap doublings and s products instead of 2 * BITS
+        // doublings, which matters when a context serves only a few operations.
+        std::size_t s = 0, c = Int::BITS;
+        while (c % 2 == 0) {
+            c /= 2;
+            s++;
+        }
+        Int r(1);
+        for (std::size_t i = 0; i < Int::BITS + c; i++) {
+            uint64_t carry = r.shiftLeft1();
+            if (carry || r >= n) r.sub(n);
+            if (i + 1 == Int::BITS) rModN = r;
+        }
+        for (std::size_t i = 0; i < s; i++) r = sqr(r);
+        r2 = r;
+    }
+
+    const Int &modulus() const { return n; }
+    const Int &one() const { return rModN; } // 1 in Montgomery form
+
+    Int toMont(const Int &a) const { return mul(a, r2); }
+    Int fromMont(const Int &a) const { return mul(a, Int(1)); }
+
+    // a * b mod n with both in normal form.
+    Int mulMod(const Int &a, const Int &b) const { return mul(toMont(a), b); }
+
+    // x mod n for a double-width x < n*R, e.g. an RSA ciphertext reduced by one prime.
+    Int reduceWide(const BigInt<2 * LIMBS> &x) const {
+        uint64_t t[2 * LIMBS + 1] = {};
+        std::copy(x.limb.begin(), x.limb.end(), t);
+        return mul(reduce(t), r2); // (x * R^-1) * R^2 * R^-1
+    }
+
+    // a * b * R^-1 mod n. Inputs must be below n. Small sizes interleave
+    // product and reduction word by word (CIOS); from montgomeryMul limbs
+    // the full Karatsuba product comes first and reduce() follows.
+    Int mul(const Int &a, const Int &b) const {
+        instrument::count(instrument::Counter::ModMul);
+        std::size_t threshold = mulThresholds().karatsubaMul;
+        if (LIMBS >= mulThresholds().montgomeryMul && LIMBS >= threshold) {
+            uint64_t wide[2 * LIMBS + 1] = {};
+            uint64_t scratch[detail::karatsubaScratch(LIMBS) + 1];
+            detail::mulKaratsuba(wide, a.limb.data(), b.limb.data(), LIMBS, scratch, threshold);
+            return reduce(wide);
+        }
+        uint64_t t[LIMBS + 2] = {};
+        for (std::size_t i = 0; i < LIMBS; i++) {
+            uint64_t carry = 0;
+            uint64_t bi = b.limb[i];
+            for (std::size_t j = 0; j < LIMBS; j++) {
+                u128 s = u128(a.limb[j]) * bi + t[j] + carry;
+                t[j] = uint64_t(s);
+                carry = uint64_t(s >> 64);
+            }
+            u128 s = u128(t[LIMBS]) + carry;
+            t[LIMBS] = uint64_t(s);
+            t[LIMBS + 1] = uint64_t(s >> 64);
+
+            uint64_t m = t[0] * nPrime;
+            s = u128(m) * n.limb[0] + t[0];
+            carry = uint64_t(s >> 64);
+            for (std::size_t j = 1; j < LIMBS; j++) {
+                s = u128(m) * n.limb[j] + t[j] + carry;
+                t[j - 1] = uint64_t(s);
+                carry = uint64_t(s >> 64);
+            }
+            s = u128(t[LIMBS]) + carry;
+            t[LIMBS - 1] = uint64_t(s);
+            t[LIMBS] = t[LIMBS + 1] + uint64_t(s >> 64);
+        }
+        Int r;
+        std::copy(t, t + LIMBS, r.limb.begin());
+        return finalSubtract(r, t[LIMBS]);
+    }
+
+    // a^2 * R^-1 mod n: the full square, then a separate reduction. At
+    // SQR_VIA_MUL limbs and below the fused CIOS product is faster: the
+    // reduction pass costs more than the square saves.
+    Int sqr(const Int &a) const {
+        if constexpr (LIMBS <= SQR_VIA_MUL) return mul(a, a);
+        instrument::count(instrument::Counter::ModSqr);
+        uint64_t t[2 * LIMBS + 1] = {};
+        std::size_t threshold = mulThresholds().karatsubaSqr;
+        if (LIMBS >= threshold) {
+            uint64_t scratch[detail::karatsubaScratch(LIMBS) + 1];
+            detail::sqrKaratsuba(t, a.limb.data(), LIMBS, scratch, threshold);
+        } else {
+            detail::sqrBasecase(t, a.limb.data(), LIMBS);
+        }
+        return reduce(t);
+    }
+
+    // Montgomery reduction of a 2*LIMBS-word value t < n*R: returns t * R^-1 mod n.
+    // t needs one spare word on top and is clobbered.
+    //
+    // Step i clears t[i], so its carry out is parked there and all of them
+    // are added to the top half in one pass at the end. Later steps only
+    // read words above i, and no carry chain stops early on the data, so
+    // the squarings of the constant-time modexp take the same time for
+    // every input.
+    Int reduce(uint64_t *t) const {
+        for (std::size_t i = 0; i < LIMBS; i++) {
+            uint64_t m = t[i] * nPrime;
+            uint64_t carry = 0;
+            for (std::size_t j = 0; j < LIMBS; j++) {
+                u128 s = u128(m) * n.limb[j] + t[i + j] + carry;
+                t[i + j] = uint64_t(s);
+                carry = uint64_t(s >> 64);
+            }
+            t[i] = carry;
+        }
+        uint64_t extra = detail::addN(t + LIMBS, t + LIMBS, t, LIMBS); // carry out of t[2 * LIMBS - 1]
+        Int r;
+        std::copy(t + LIMBS, t + 2 * LIMBS, r.limb.begin());
+        return finalSubtract(r, extra);
+    }
+
+    // Window width for a sliding-window exponent of `bits` bits.
+    static int windowBits(std::size_t bits) {
+        if (bits > 671) return 6;
+        if (bits > 239) return 5;
+        if (bits > 79) return 4;
+        if (bits > 23) return 3;
+        return bits > 7 ? 2 : 1;
+    }
+
+    // base^exp mod n, with base and result in normal (not Montgomery) form.
+    template <std::size_t E>
+    Int modexp(const Int &base, const BigInt<E> &exp, ExpMode mode = ExpMode::SlidingWindow) const {
+        if (base >= n) throw std::invalid_argument("Montgomery: base must be below the modulus");
+        instrument::Scope timer(instrument::Probe::BigModExp);
+        instrument::count(instrument::Counter::ModExp);
+        Int baseM = toMont(base);
+        return fromMont(mode == ExpMode::ConstantTime ? modexpConstTime(baseM, exp) : modexpMont(baseM, exp));
+    }
+
+    // Fixed window width: the table scan grows with 2^w, so short exponents use 4 bits.
+    template <std::size_t E>
+    static constexpr int ctWindow() { return BigInt<E>::BITS <= 512 ? 4 : 5; }
+
+    // Fixed-window exponentiation in Montgomery form whose timing and memory
+    // accesses depend only on E, not on the bits of exp.
+    template <std::size_t E>
+    Int modexpConstTime(const Int &baseM, const BigInt<E> &exp) const {
+        constexpr int W = ctWindow<E>();
+        constexpr std::size_t ENTRIES = std::size_t(1) << W;
+        alignas(64) uint64_t table[LIMBS][ENTRIES]; // table[i][k] = limb i of base^k
+        Int pow[ENTRIES];
+        pow[0] = rModN;
+        pow[1] = baseM;
+        for (std::size_t k = 2; k < ENTRIES; k++) pow[k] = k % 2 ? mul(pow[k - 1], baseM) : sqr(pow[k / 2]);
+        for (std::size_t k = 0; k < ENTRIES; k++) scatter<ENTRIES>(table, k, pow[k]);
+
+        constexpr std::size_t TOP = (BigInt<E>::BITS + W - 1) / W * W;
+        Int acc = gather<ENTRIES>(table, exp.bits(TOP - W, W));
+        for (std::size_t pos = TOP - W; pos > 0; pos -= W) {
+            for (int s = 0; s < W; s++) acc = sqr(acc);
+            acc = mul(acc, gather<ENTRIES>(table, exp.bits(pos - W, W)));
+        }
+        return acc;
+    }
+
+    // Same on a base already in Montgomery form; the result stays in Montgomery form.
+    template <std::size_t E>
+    Int modexpMont(const Int &baseM, const BigInt<E> &exp) const {
+        std::size_t bits = exp.bitLength();
+        if (bits == 0) return rModN;
+        // Sparse exponents such as 65537 gain nothing from a table of odd powers.
+        int w = popcount(exp) <= 4 ? 1 : windowBits(bits);
+
+        // odd[k] = base^(2k+1)
+        Int odd[1 << 5];
+        odd[0] = baseM;
+        if (w > 1) {
+            Int b2 = sqr(baseM);
+            for (int k = 1; k < (1 << (w - 1)); k++) odd[k] = mul(odd[k - 1], b2);
+        }
+
+        Int acc = rModN;
+        bool started = false;
+        std::size_t i = bits;
+        while (i > 0) {
+            if (!exp.bit(i - 1)) {
+                if (started) acc = sqr(acc);
+                i--;
+                continue;
+            }
+            // Longest window of at most w bits that ends in a set bit.
+            std::size_t low = i > std::size_t(w) ? i - std::size_t(w) : 0;
+            while (!exp.bit(low)) low++;
+            std::size_t len = i - low;
+            uint64_t value = exp.bits(low, len);
+            if (started) {
+                for (std::size_t s = 0; s < len; s++) acc = sqr(acc);
+                acc = mul(acc, odd[value >> 1]);
+            } else {
+                acc = odd[value >> 1];
+                started = true;
+            }
+            i = low;
+        }
+        return acc;
+    }
+
+private:
+    // r - n if the true value (carry:r) is at least n, else r; no branch on the data.
+    Int finalSubtract(const Int &r, uint64_t carry) const {
+        Int d = r;
+        uint64_t borrow = d.sub(n);
+        return Int::select(0 - (borrow & (carry ^ 1)), r, d); // keep r when r < n
+    }
+
+    template <std::size_t ENTRIES>
+    static void scatter(uint64_t (*table)[ENTRIES], std::size_t k, const Int &v) {
+        for (std::size_t i = 0; i < LIMBS; i++) table[i][k] = v.limb[i];
+    }
+
+    template <std::size_t ENTRIES>
+    static Int gather(const uint64_t (*table)[ENTRIES], uint64_t index) {
+        Int v;
+        for (std::size_t i = 0; i < LIMBS; i++) {
+            uint64_t w = 0;
+            for (std::size_t k = 0; k < ENTRIES; k++) {
+                uint64_t hit = ((uint64_t(k) ^ index) - 1) >> 63; // 1 iff k == index
+                w |= table[i][k] & (0 - hit);
+            }
+            v.limb[i] = w;
+        }
+        return v;
+    }
+
+    Int n;
+    uint64_t nPrime = 0;
+    Int rModN, r2;
+};
+
+} // namespace bignum
@@ -0,0 +1,161 @@
+#pragma once
+
+/*
+ * Karatsuba crossover tuning
+ * --------------------------
+ * tuneMulThresholds() times schoolbook against a single Karatsuba level
+ * (halves done in schoolbook) over a ladder of operand sizes. The threshold
+ * is the first size at which Karatsuba wins there and at the next size up;
+ * if that never happens, the result is MulThresholds::NEVER.
+ * Products and squares are tuned separately, since the schoolbook square
+ * already saves a quarter of the work.
+ *
+ * The Montgomery switch point is tuned last, on Montgomery<L>::mul itself
+ * at the RSA and DH sizes, comparing CIOS with a Karatsuba product (at the
+ * product threshold just found) followed by reduce().
+ *
+ * The result is returned, not installed; assign it to mulThresholds() to use it.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "bignum.hpp"
+
+namespace bignum {
+
+struct TuneRow {
+    std::size_t limbs;
+    double mulBasecaseNs, mulKaratsubaNs, sqrBasecaseNs, sqrKaratsubaNs;
+    double montCiosNs = 0, montKaratsubaNs = 0; // zero where Montgomery was not timed
+};
+
+namespace detail {
+
+// Nanoseconds per call of f and of g, each the best of seven runs. The runs
+// alternate so that frequency changes or a busy neighbour hit both alike.
+template <class F, class G>
+std::pair<double, double> bestNs(F &&f, G &&g) {
+    using clock = std::chrono::steady_clock;
+    std::size_t calls = 1;
+    for (;;) { // grow the batch until one run takes about half a millisecond
+        auto start = clock::now();
+        for (std::size_t i = 0; i < calls; i++) f();
+        if (clock::now() - start > std::chrono::microseconds(500) || calls >= (std::size_t(1) << 20)) break;
+        calls *= 2;
+    }
+    auto time = [&](auto &&h) {
+        auto start = clock::now();
+        for (std::size_t i = 0; i < calls; i++) h();
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count() / double(calls);
+    };
+    double bestF = 1e30, bestG = 1e30;
+    for (int run = 0; run < 7; run++) {
+        bestF = std::min(bestF, time(f));
+        bestG = std::min(bestG, time(g));
+    }
+    return {bestF, bestG};
+}
+
+// First ladder size where `wins` holds there and at the next size too, so
+// one noisy measurement neither sets nor blocks the threshold.
+template <class P>
+std::size_t crossover(const std::vector<TuneRow> &rows, P &&wins) {
+    for (std::size_t i = 0; i < rows.size(); i++)
+        if (wins(rows[i]) && (i + 1 == rows.size() || wins(rows[i + 1]))) return rows[i].limbs;
+    return MulThresholds::NEVER;
+}
+
+// Times Montgomery<L>::mul both ways into the ladder row for L.
+template <std::size_t L>
+void timeMontgomery(std::vector<TuneRow> &rows, std::size_t karatsubaMul, std::mt19937_64 &rng) {
+    if (L < karatsubaMul) return; // Montgomery<L> would use CIOS either way
+    for (TuneRow &row : rows) {
+        if (row.limbs != L) continue;
+        BigInt<L> n, a, b;
+        for (auto &w : n.limb) w = rng();
+        n.limb[0] |= 1;
+        n.limb[L - 1] |= uint64_t(1) << 63;
+        for (auto &w : b.limb) w = rng();
+        b.limb[L - 1] >>= 1;
+        Montgomery<L> mont(n);
+        a = b;
+        MulThresholds saved = mulThresholds();
+        mulThresholds().karatsubaMul = karatsubaMul;
+        std::tie(row.montCiosNs, row.montKaratsubaNs) = bestNs(
+            [&] {
+                mulThresholds().montgomeryMul = MulThresholds::NEVER;
+                a = mont.mul(a, b);
+            },
+            [&] {
+                mulThresholds().montgomeryMul = 0;
+                a = mont.mul(a, b);
+            });
+        mulThresholds() = saved;
+    }
+}
+
+} // namespace detail
+
+// Times both algorithms at sizes up to maxLimbs; `rows`, if given, receives the timings.
+inline MulThresholds tuneMulThresholds(std::vector<TuneRow> *rows = nullptr, std::size_t maxLimbs = 128) {
+    static const std::size_t LADDER[] = {4, 6, 8, 10, 12, 16, 20, 24, 28, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 256};
+    std::mt19937_64 rng(1);
+    std::vector<TuneRow> table;
+    volatile uint64_t sink = 0;
+    for (std::size_t n : LADDER) {
+        if (n > maxLimbs) break;
+        std::vector<uint64_t> a(n), b(n), r(2 * n), scratch(detail::karatsubaScratch(n) + 1);
+        for (auto &w : a) w = rng();
+        for (auto &w : b) w = rng();
+        TuneRow row{n, 0, 0, 0, 0};
+        // A threshold of n splits the top level only: its halves are below n.
+        std::tie(row.mulBasecaseNs, row.mulKaratsubaNs) = detail::bestNs(
+            [&] {
+                detail::mulBasecase(r.data(), a.data(), b.data(), n);
+                sink = sink + r[n];
+            },
+            [&] {
+                detail::mulKaratsuba(r.data(), a.data(), b.data(), n, scratch.data(), n);
+                sink = sink + r[n];
+            });
+        std::tie(row.sqrBasecaseNs, row.sqrKaratsubaNs) = detail::bestNs(
+            [&] {
+                detail::sqrBasecase(r.data(), a.data(), n);
+                sink = sink + r[n];
+            },
+            [&] {
+                detail::sqrKaratsuba(r.data(), a.data(), n, scratch.data(), n);
+                sink = sink + r[n];
+            });
+        table.push_back(row);
+    }
+    MulThresholds t;
+    t.karatsubaMul = detail::crossover(table, [](const TuneRow &row) { return row.mulKaratsubaNs < row.mulBasecaseNs; });
+    t.karatsubaSqr = detail::crossover(table, [](const TuneRow &row) { return row.sqrKaratsubaNs < row.sqrBasecaseNs; });
+    if (t.karatsubaMul != MulThresholds::NEVER) {
+        detail::timeMontgomery<16>(table, t.karatsubaMul, rng);
+        detail::timeMontgomery<24>(table, t.karatsubaMul, rng);
+        detail::timeMontgomery<32>(table, t.karatsubaMul, rng);
+        detail::timeMontgomery<48>(table, t.karatsubaMul, rng);
+        detail::timeMontgomery<64>(table, t.karatsubaMul, rng);
+        detail::timeMontgomery<96>(table, t.karatsubaMul, rng);
+        detail::timeMontgomery<128>(table, t.karatsubaMul, rng);
+        std::vector<TuneRow> timed;
+        for (const TuneRow &row : table)
+            if (row.montCiosNs > 0) timed.push_back(row);
+        t.montgomeryMul = detail::crossover(timed, [](const TuneRow &row) { return row.montKaratsubaNs < row.montCiosNs; });
+    } else {
+        t.montgomeryMul = MulThresholds::NEVER;
+    }
+    if (rows) *rows = std::move(table);
+    return t;
+}
+
+} // namespace bignum
@@ -0,0 +1,328 @@
+#pragma once
+
+/*
+ * Compile-time switchable hot-path instrumentation
+ * ------------------------------------------------
+ * Build with -DINSTRUMENT=1 to turn it on. Otherwise every hook below is an
+ * empty inline function or an empty class, and the optimiser removes it:
+ * the default build has no extra loads, stores or branches.
+ *
+ *   count(Counter, n)    per-thread event counters (blocks, modmuls, ...)
+ *   Scope t(Probe)       times the enclosing scope with rdtsc (steady_clock
+ *                        off x86) into a per-thread latency histogram
+ *   dump(fd)             totals, mean and percentiles over all threads
+ *
+ * Histograms are HDR-style: 16 linear sub-buckets per power of two, so any
+ * latency from one tick to 2^64 is kept within 1/16 of its value in under
+ * 8 KiB per probe. Each thread owns its counters and histograms and only
+ * ever stores to them (relaxed atomics, no read-modify-write), so recording
+ * costs a thread-local load and a couple of plain stores.
+ *
+ * An instrumented program registers a dump to stderr at exit and, if
+ * SIGUSR1 still has its default action, a handler that dumps on
+ * `kill -USR1 <pid>`. dump() only formats integers and calls
+ * write(2), so it is safe inside that handler.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef INSTRUMENT
+#define INSTRUMENT 0
+#endif
+
+#if INSTRUMENT
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace instrument {
+
+inline constexpr bool ENABLED = INSTRUMENT != 0;
+
+enum class Counter : unsigned {
+    SdesBlocks,  // blocks through the S-DES engines
+    SaesBlocks,  // single-block S-AES Encrypt / Decrypt calls
+    SaesBytes,   // bytes through the S-AES modes of operation
+    ModMul,      // multi-limb Montgomery products, small squarings included
+    ModSqr,      // multi-limb squarings above SQR_VIA_MUL limbs
+    ModExp,      // modular exponentiations, 64-bit and multi-limb
+    Allocations, // buffer growth inside the engines
+    COUNT
+};
+
+enum class Probe : unsigned {
+    SdesReference, // des.cpp sdes(), the bit-vector reference
+    SdesBulk,      // SdesContext::encrypt / decrypt over a buffer
+    SaesMode,      // one S-AES mode-of-operation call
+    ModPow64,      // diffie_hellman.cpp power()
+    BigModExp,     // Montgomery<L>::modexp
+    RsaPublic,
+    RsaPrivate,    // c^d with the full exponent
+    RsaPrivateCrt,
+    EcdhKeygen,
+    EcdhShared,
+    COUNT
+};
+
+inline constexpr const char *COUNTER_NAMES[] = {"sdes.blocks", "saes.blocks", "saes.bytes", "bignum.modmul",
+                                                "bignum.modsqr", "modexp", "allocations"};
+inline constexpr const char *PROBE_NAMES[] = {"sdes.reference", "sdes.bulk", "saes.mode", "dh.power64",
+                                              "bignum.modexp", "rsa.public", "rsa.private", "rsa.private_crt",
+                                              "ecdh.keygen", "ecdh.shared"};
+static_assert(sizeof COUNTER_NAMES / sizeof *COUNTER_NAMES == std::size_t(Counter::COUNT), "a name per counter");
+static_assert(sizeof PROBE_NAMES / sizeof *PROBE_NAMES == std::size_t(Probe::COUNT), "a name per probe");
+
+// Scope timers: ScopedTimer<false> is empty, so a disabled Scope is free.
+template <bool On>
+class ScopedTimer;
+
+template <>
+class ScopedTimer<false> {
+public:
+    constexpr explicit ScopedTimer(Probe) {}
+};
+
+#if INSTRUMENT
+
+namespace detail {
+
+// Bucket of a value: exact below 16, then 16 sub-buckets per power of two.
+inline constexpr std::size_t SUB_BITS = 4, SUB = std::size_t(1) << SUB_BITS;
+inline constexpr std::size_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+inline std::size_t bucketOf(uint64_t v) {
+    if (v < SUB) return std::size_t(v);
+    std::size_t e = std::size_t(63 - __builtin_clzll(v));
+    return (e - SUB_BITS + 1) * SUB + std::size_t((v >> (e - SUB_BITS)) & (SUB - 1));
+}
+
+// Smallest value that lands in bucket i.
+inline uint64_t bucketFloor(std::size_t i) {
+    if (i < SUB) return i;
+    std::size_t e = i / SUB + SUB_BITS - 1;
+    return (uint64_t(1) << e) | (uint64_t(i % SUB) << (e - SUB_BITS));
+}
+
+inline uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+inline uint64_t nanos() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Written by one thread, read by dump(): relaxed load + store, never an RMW.
+inline void bump(std::atomic<uint64_t> &a, uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+struct Histogram {
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+    std::atomic<uint64_t> calls{0}, sum{0}, max{0};
+};
+
+// One per thread, linked into a list that is only ever pushed to. Blocks of
+// finished threads stay in the list so their totals survive.
+struct ThreadBlock {
+    std::atomic<uint64_t> counters[std::size_t(Counter::COUNT)] = {};
+    Histogram probes[std::size_t(Probe::COUNT)];
+    ThreadBlock *next = nullptr;
+};
+
+inline std::atomic<ThreadBlock *> &head() {
+    static std::atomic<ThreadBlock *> list{nullptr};
+    return list;
+}
+
+inline void dumpAtExit();
+inline void onSignal(int);
+
+// Tick rate reference, taken at start-up.
+struct Epoch {
+    uint64_t ticks0 = ticks(), nanos0 = nanos();
+};
+
+inline const Epoch &epoch() {
+    static const Epoch e;
+    return e;
+}
+
+// Runs once at start-up in any program that includes this header.
+inline bool install() {
+    epoch();
+    std::atexit(dumpAtExit);
+    struct sigaction old {};
+    if (sigaction(SIGUSR1, nullptr, &old) == 0 && old.sa_handler == SIG_DFL) {
+        struct sigaction sa {};
+        sa.sa_handler = onSignal;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &sa, nullptr);
+    }
+    return true;
+}
+
+inline const bool installed = install();
+
+inline ThreadBlock &local() {
+    thread_local ThreadBlock *block = nullptr;
+    if (!block) {
+        block = new ThreadBlock; // never freed, see above
+        ThreadBlock *h = head().load(std::memory_order_relaxed);
+        do block->next = h;
+        while (!head().compare_exchange_weak(h, block, std::memory_order_release, std::memory_order_relaxed));
+    }
+    return *block;
+}
+
+inline void record(Probe p, uint64_t elapsed) {
+    Histogram &h = local().probes[std::size_t(p)];
+    bump(h.buckets[bucketOf(elapsed)], 1);
+    bump(h.calls, 1);
+    bump(h.sum, elapsed);
+    if (elapsed > h.max.load(std::memory_order_relaxed)) h.max.store(elapsed, std::memory_order_relaxed);
+}
+
+// --- Async-signal-safe output ---
+struct Writer {
+    int fd;
+    char buf[512];
+    std::size_t used = 0;
+
+    void flush() {
+        std::size_t done = 0;
+        while (done < used) {
+            ssize_t n = ::write(fd, buf + done, used - done);
+            if (n <= 0) break;
+            done += std::size_t(n);
+        }
+        used = 0;
+    }
+    void put(char c) {
+        if (used == sizeof buf) flush();
+        buf[used++] = c;
+    }
+    void text(const char *s, std::size_t width = 0) {
+        std::size_t n = 0;
+        for (; s[n]; n++) put(s[n]);
+        for (; n < width; n++) put(' ');
+    }
+    // Right-aligned unsigned decimal.
+    void number(uint64_t v, std::size_t width) {
+        char digits[20];
+        std::size_t n = 0;
+        do digits[n++] = char('0' + v % 10);
+        while (v /= 10);
+        for (std::size_t i = n; i < width; i++) put(' ');
+        while (n) put(digits[--n]);
+    }
+};
+
+} // namespace detail
+
+inline void count(Counter c, uint64_t n = 1) { detail::bump(detail::local().counters[std::size_t(c)], n); }
+
+// Counters usable from constexpr functions: nothing happens during constant evaluation.
+constexpr void countConstexpr(Counter c, uint64_t n = 1) {
+    if (!__builtin_is_constant_evaluated()) count(c, n);
+}
+
+template <>
+class ScopedTimer<true> {
+public:
+    explicit ScopedTimer(Probe p) : probe(p), start(detail::ticks()) {}
+    ~ScopedTimer() { detail::record(probe, detail::ticks() - start); }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Probe probe;
+    uint64_t start;
+};
+
+// Totals over every thread so far, latencies in nanoseconds.
+inline void dump(int fd = 2) {
+    using namespace detail;
+    const Epoch &e = epoch();
+    uint64_t dn = nanos() - e.nanos0, dt = ticks() - e.ticks0;
+    // Tick length in 1/1024 ns, from the rate seen since the first event.
+    uint64_t scale = dt && dn ? uint64_t((unsigned __int128)dn * 1024 / dt) : 1024;
+    if (!scale) scale = 1;
+    auto toNs = [scale](uint64_t t) { return uint64_t((unsigned __int128)t * scale / 1024); };
+
+    Writer w{fd, {}};
+    std::size_t threads = 0;
+    for (ThreadBlock *b = head().load(std::memory_order_acquire); b; b = b->next) threads++;
+    w.text("-- instrumentation: ");
+    w.number(threads, 0);
+    w.text(" thread(s) --\n");
+    w.text("counter", 24);
+    w.text("               total\n");
+    for (std::size_t c = 0; c < std::size_t(Counter::COUNT); c++) {
+        uint64_t total = 0;
+        for (ThreadBlock *b = head().load(std::memory_order_acquire); b; b = b->next)
+            total += b->counters[c].load(std::memory_order_relaxed);
+        if (!total) continue;
+        w.text(COUNTER_NAMES[c], 24);
+        w.number(total, 20);
+        w.put('\n');
+    }
+    w.text("probe (ns)", 24);
+    w.text("     calls       mean        p50        p90        p99      p99.9        max\n");
+    for (std::size_t p = 0; p < std::size_t(Probe::COUNT); p++) {
+        uint64_t merged[BUCKETS] = {};
+        uint64_t calls = 0, sum = 0, max = 0;
+        for (ThreadBlock *b = head().load(std::memory_order_acquire); b; b = b->next) {
+            const Histogram &h = b->probes[p];
+            calls += h.calls.load(std::memory_order_relaxed);
+            sum += h.sum.load(std::memory_order_relaxed);
+            uint64_t m = h.max.load(std::memory_order_relaxed);
+            if (m > max) max = m;
+            for (std::size_t i = 0; i < BUCKETS; i++) merged[i] += h.buckets[i].load(std::memory_order_relaxed);
+        }
+        if (!calls) continue;
+        w.text(PROBE_NAMES[p], 24);
+        w.number(calls, 10);
+        w.number(toNs(sum / calls), 11);
+        for (uint64_t permille : {500, 900, 990, 999}) {
+            uint64_t rank = (calls * permille + 999) / 1000, seen = 0;
+            std::size_t i = 0;
+            while (i + 1 < BUCKETS && (seen += merged[i]) < rank) i++;
+            w.number(toNs(bucketFloor(i)), 11);
+        }
+        w.number(toNs(max), 11);
+        w.put('\n');
+    }
+    w.flush();
+}
+
+namespace detail {
+inline void dumpAtExit() { dump(2); }
+inline void onSignal(int) { dump(2); }
+} // namespace detail
+
+#else // !INSTRUMENT
+
+inline void count(Counter, uint64_t = 1) {}
+constexpr void countConstexpr(Counter, uint64_t = 1) {}
+inline void dump(int = 2) {}
+
+#endif
+
+// The timer to use at call sites: an empty object unless instrumentation is on.
+using Scope = ScopedTimer<ENABLED>;
+
+} // namespace instrument
@@ -0,0 +1,333 @@
+#pragma once
+
+/*
+ * Modular arithmetic shared by RSA, Diffie-Hellman and ECC
+ * --------------------------------------------------------
+ * Three layers:
+ *
+ *   - Single-word moduli (up to 2^64). mulMod() takes the full 128-bit
+ *     product, so nothing overflows the way `long long` products do once
+ *     the modulus passes 2^31. For many products against one modulus,
+ *     Montgomery64 (odd moduli) and Barrett64 (any modulus) replace the
+ *     128-by-64 division with a few multiplications.
+ *
+ *   - Primes below 2^64: a deterministic Miller-Rabin test, Pollard-Brent
+ *     factoring, and SqrtMod64, square roots by Tonelli-Shanks (the curve
+ *     point scan and point counting).
+ *
+ *   - Multi-limb moduli. BigInt<LIMBS> and Montgomery<LIMBS> from
+ *     bignum.hpp, re-exported here so callers only include this header.
+ *
+ * Everything is header-only; the programs include it by relative path.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "bignum.hpp"
+
+namespace modmath {
+
+using bignum::BigInt;
+using bignum::ExpMode;
+using bignum::Montgomery;
+using bignum::mod;
+using bignum::modInverse;
+using bignum::mulWide;
+using bignum::resize;
+using bignum::u128;
+
+// --- Single-word helpers ---
+
+// a + b mod m for a, b < m, without overflowing when m is close to 2^64.
+inline uint64_t addMod(uint64_t a, uint64_t b, uint64_t m) {
+    uint64_t s = a + b;
+    if (s < a || s >= m) s -= m;
+    return s;
+}
+
+// a - b mod m for a, b < m.
+inline uint64_t subMod(uint64_t a, uint64_t b, uint64_t m) { return a >= b ? a - b : a - b + m; }
+
+inline uint64_t mulMod(uint64_t a, uint64_t b, uint64_t m) { return uint64_t(u128(a) * b % m); }
+
+// v mod m in [0, m) for a signed v, e.g. a negative curve coefficient.
+inline uint64_t reduceSigned(int64_t v, uint64_t m) {
+    uint64_t r = (v < 0 ? 0 - uint64_t(v) : uint64_t(v)) % m;
+    return v < 0 && r ? m - r : r;
+}
+
+inline uint64_t gcd64(uint64_t a, uint64_t b) {
+    while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// a^-1 mod m for 64-bit values (extended Euclid); 0 if no inverse exists.
+inline uint64_t modInverse64(uint64_t a, uint64_t m) {
+    __int128 t = 0, newT = 1;
+    __int128 r = m, newR = a % m;
+    while (newR != 0) {
+        __int128 q = r / newR;
+        __int128 tmp = t - q * newT;
+        t = newT;
+        newT = tmp;
+        tmp = r - q * newR;
+        r = newR;
+        newR = tmp;
+    }
+    if (r != 1) return 0;
+    return uint64_t(t < 0 ? t + m : t);
+}
+
+// --- Montgomery64 ---
+
+// Montgomery form a * 2^64 mod n for an odd n < 2^64. reduce() uses the
+// positive inverse n^-1 mod 2^64 and subtracts the correction instead of
+// adding it, so the 128-bit intermediate never carries past 2^128.
+class Montgomery64 {
+public:
+    explicit Montgomery64(uint64_t modulus) : n(modulus) {
+        if (n % 2 == 0 || n < 3) throw std::invalid_argument("Montgomery64: modulus must be odd and > 1");
+        nInv = 0 - bignum::negInverse64(n);
+        rModN = (0 - n) % n; // 2^64 mod n
+        r2 = uint64_t(u128(rModN) * rModN % n);
+    }
+
+    uint64_t modulus() const { return n; }
+    uint64_t one() const { return rModN; }
+
+    uint64_t toMont(uint64_t a) const { return mul(a % n, r2); }
+    uint64_t fromMont(uint64_t a) const { return reduce(a); }
+
+    // t * 2^-64 mod n for t < n * 2^64.
+    uint64_t reduce(u128 t) const {
+        uint64_t q = uint64_t(t) * nInv;
+        uint64_t h = uint64_t((u128(q) * n) >> 64);
+        uint64_t hi = uint64_t(t >> 64);
+        return hi >= h ? hi - h : hi - h + n;
+    }
+
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce(u128(a) * b); }
+    uint64_t add(uint64_t a, uint64_t b) const { return addMod(a, b, n); }
+    uint64_t sub(uint64_t a, uint64_t b) const { return subMod(a, b, n); }
+
+    uint64_t mulMod(uint64_t a, uint64_t b) const { return fromMont(mul(toMont(a), toMont(b))); }
+
+    // base^exp mod n on Montgomery-form operands, left to right.
+    uint64_t powMont(uint64_t base, uint64_t exp) const {
+        uint64_t r = rModN;
+        for (int i = 63 - (exp ? __builtin_clzll(exp) : 63); i >= 0; i--) {
+            r = mul(r, r);
+            if ((exp >> i) & 1) r = mul(r, base);
+        }
+        return r;
+    }
+
+    uint64_t modexp(uint64_t base, uint64_t exp) const { return fromMont(powMont(toMont(base), exp)); }
+
+private:
+    uint64_t n, nInv, rModN, r2;
+};
+
+// --- Barrett64 ---
+
+// x mod m via q = floor(x * mu / 2^128) with mu = floor((2^128 - 1) / m).
+// q undershoots floor(x / m) by at most 2, fixed with conditional
+// subtractions. Works for even moduli, where Montgomery does not.
+class Barrett64 {
+public:
+    explicit Barrett64(uint64_t modulus) : m(modulus) {
+        if (m < 2) throw std::invalid_argument("Barrett64: modulus must be > 1");
+        mu = ~u128(0) / m;
+    }
+
+    uint64_t modulus() const { return m; }
+
+    uint64_t reduce(u128 x) const {
+        uint64_t x0 = uint64_t(x), x1 = uint64_t(x >> 64);
+        uint64_t m0 = uint64_t(mu), m1 = uint64_t(mu >> 64);
+        u128 lo = u128(x0) * m0, mid1 = u128(x1) * m0, mid2 = u128(x0) * m1;
+        u128 t = (lo >> 64) + uint64_t(mid1) + uint64_t(mid2);
+        u128 q = u128(x1) * m1 + (mid1 >> 64) + (mid2 >> 64) + (t >> 64);
+        u128 r = x - q * m;
+        while (r >= m) r -= m;
+        return uint64_t(r);
+    }
+
+    uint64_t mul(uint64_t a, uint64_t b) const { return reduce(u128(a) * b); }
+
+    uint64_t modexp(uint64_t base, uint64_t exp) const {
+        uint64_t r = 1 % m;
+        base = uint64_t(base % m);
+        for (; exp; exp >>= 1) {
+            if (exp & 1) r = mul(r, base);
+            base = mul(base, base);
+        }
+        return r;
+    }
+
+private:
+    uint64_t m;
+    u128 mu;
+};
+
+// base^exp mod m for any m >= 1: Montgomery for odd moduli, Barrett otherwise.
+inline uint64_t powMod(uint64_t base, uint64_t exp, uint64_t m) {
+    if (m == 0) throw std::invalid_argument("modmath: modulus must be nonzero");
+    if (m == 1) return 0;
+    if (m % 2) return Montgomery64(m).modexp(base, exp);
+    return Barrett64(m).modexp(base, exp);
+}
+
+// --- Primes and square roots ---
+
+// Deterministic Miller-Rabin for 64-bit n: the first twelve prime bases
+// leave no strong pseudoprime below 3.18 * 10^23, well past 2^64.
+inline bool isPrime64(uint64_t n) {
+    static const uint64_t BASES[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    if (n < 2) return false;
+    for (uint64_t q : BASES)
+        if (n % q == 0) return n == q;
+    Montgomery64 mont(n);
+    uint64_t d = n - 1;
+    int s = __builtin_ctzll(d);
+    d >>= s;
+    uint64_t one = mont.one(), minusOne = mont.sub(0, one);
+    for (uint64_t q : BASES) {
+        uint64_t x = mont.powMont(mont.toMont(q), d);
+        if (x == one || x == minusOne) continue;
+        bool composite = true;
+        for (int i = 1; i < s && composite; i++) {
+            x = mont.mul(x, x);
+            composite = x != minusOne;
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+// A nontrivial factor of an odd composite n (Pollard rho, Brent's cycle
+// finding). Products of |x - y| are batched so one gcd covers 128 steps.
+inline uint64_t pollardRho64(uint64_t n) {
+    Montgomery64 mont(n);
+    auto diff = [](uint64_t x, uint64_t y) { return x > y ? x - y : y - x; };
+    for (uint64_t c = 1;; c++) {
+        auto f = [&](uint64_t v) { return mont.add(mont.mul(v, v), c % n); };
+        uint64_t x = 0, y = 2, ys = 2, q = mont.one(), g = 1;
+        for (uint64_t r = 1; g == 1; r *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < r; i++) y = f(y);
+            for (uint64_t k = 0; k < r && g == 1; k += 128) {
+                ys = y;
+                for (uint64_t i = 0; i < 128 && i < r - k; i++) {
+                    y = f(y);
+                    q = mont.mul(q, diff(x, y));
+                }
+                g = gcd64(q, n);
+            }
+        }
+        if (g == n) { // the batch overshot: redo it one step at a time
+            do {
+                ys = f(ys);
+                g = gcd64(diff(x, ys), n);
+            } while (g == 1);
+        }
+        if (g != n) return g;
+    }
+}
+
+// Prime factors of n with multiplicity, ascending; empty for n < 2.
+inline std::vector<uint64_t> factor64(uint64_t n) {
+    std::vector<uint64_t> out;
+    for (uint64_t q = 2; q < 64 && q * q <= n; q++)
+        while (n % q == 0) {
+            out.push_back(q);
+            n /= q;
+        }
+    std::vector<uint64_t> pending;
+    if (n > 1) pending.push_back(n);
+    while (!pending.empty()) {
+        uint64_t m = pending.back();
+        pending.pop_back();
+        if (isPrime64(m)) {
+            out.push_back(m);
+        } else {
+            uint64_t d = pollardRho64(m);
+            pending.push_back(d);
+            pending.push_back(m / d);
+        }
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// Square roots modulo an odd prime p. With p - 1 = q * 2^s, Tonelli-Shanks
+// starts from r = a^((q+1)/2), t = a^q and repeatedly cancels the order of t
+// with powers of c = z^q for a fixed non-residue z. p = 3 mod 4 (s = 1) is a
+// single exponentiation, r = a^((p+1)/4). The same run tells residues from
+// non-residues, so no separate Legendre symbol is needed before sqrt().
+class SqrtMod64 {
+public:
+    explicit SqrtMod64(uint64_t prime) : mont(prime), p(prime) {
+        if (!isPrime64(p)) throw std::invalid_argument("SqrtMod64: modulus must be an odd prime");
+        q = p - 1;
+        s = __builtin_ctzll(q);
+        q >>= s;
+        uint64_t z = 2;
+        while (legendre(z) != -1) z++;
+        c = mont.powMont(mont.toMont(z), q);
+    }
+
+    uint64_t modulus() const { return p; }
+
+    // Euler's criterion: a^((p-1)/2) is 1 for residues, p - 1 for non-residues.
+    int legendre(uint64_t a) const {
+        a %= p;
+        if (!a) return 0;
+        return mont.powMont(mont.toMont(a), (p - 1) / 2) == mont.one() ? 1 : -1;
+    }
+
+    // A root of a mod p in `root`, or false if a is not a square. The other root is p - root.
+    bool sqrt(uint64_t a, uint64_t &root) const {
+        a %= p;
+        if (!a) {
+            root = 0;
+            return true;
+        }
+        uint64_t am = mont.toMont(a), one = mont.one();
+        if (s == 1) {
+            uint64_t r = mont.powMont(am, (p + 1) / 4);
+            if (mont.mul(r, r) != am) return false;
+            root = mont.fromMont(r);
+            return true;
+        }
+        uint64_t t = mont.powMont(am, q), r = mont.mul(mont.powMont(am, q / 2), am), b = c;
+        int m = s;
+        while (t != one) {
+            int i = 0; // least i with t^(2^i) = 1
+            for (uint64_t u = t; u != one; u = mont.mul(u, u))
+                if (++i == m) return false; // t has order 2^m: a is a non-residue
+            for (int j = 0; j < m - i - 1; j++) b = mont.mul(b, b);
+            r = mont.mul(r, b);
+            b = mont.mul(b, b);
+            t = mont.mul(t, b);
+            m = i;
+        }
+        root = mont.fromMont(r);
+        return true;
+    }
+
+private:
+    Montgomery64 mont;
+    uint64_t p, q, c;
+    int s;
+};
+
+} // namespace modmath
@@ -0,0 +1,178 @@
+#pragma once
+
+/*
+ * SHA-256, HMAC-SHA-256 and HKDF
+ * ------------------------------
+ * FIPS 180-4 SHA-256 with an incremental update()/finish() interface,
+ * HMAC (RFC 2104) on top of it, and HKDF extract/expand (RFC 5869) for
+ * turning a Diffie-Hellman shared secret into key material. Everything
+ * works on caller-provided buffers and nothing allocates.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+class Sha256 {
+public:
+    static constexpr std::size_t DIGEST = 32;
+    static constexpr std::size_t BLOCK = 64;
+    using Digest = std::array<uint8_t, DIGEST>;
+
+    Sha256() { reset(); }
+
+    void reset() {
+        static constexpr uint32_t IV[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                           0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        std::memcpy(h, IV, sizeof h);
+        used = 0;
+        total = 0;
+    }
+
+    Sha256 &update(const void *data, std::size_t len) {
+        if (!len) return *this;
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        total += len;
+        if (used) {
+            std::size_t take = std::min(len, BLOCK - used);
+            std::memcpy(buffer + used, p, take);
+            used += take;
+            p += take;
+            len -= take;
+            if (used < BLOCK) return *this;
+            compress(buffer);
+            used = 0;
+        }
+        for (; len >= BLOCK; p += BLOCK, len -= BLOCK) compress(p);
+        std::memcpy(buffer, p, len);
+        used = len;
+        return *this;
+    }
+
+    Digest finish() {
+        uint64_t bits = total * 8;
+        uint8_t pad[BLOCK + 8] = {0x80};
+        std::size_t padLen = (used < 56 ? 56 : 120) - used;
+        for (int i = 0; i < 8; i++) pad[padLen + i] = uint8_t(bits >> (56 - 8 * i));
+        update(pad, padLen + 8);
+        Digest out;
+        for (int i = 0; i < 8; i++)
+            for (int j = 0; j < 4; j++) out[4 * i + j] = uint8_t(h[i] >> (24 - 8 * j));
+        reset();
+        return out;
+    }
+
+    static Digest hash(const void *data, std::size_t len) { return Sha256().update(data, len).finish(); }
+
+private:
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const uint8_t *block) {
+        static constexpr uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+            w[i] = uint32_t(block[4 * i]) << 24 | uint32_t(block[4 * i + 1]) << 16 | uint32_t(block[4 * i + 2]) << 8 |
+                   block[4 * i + 3];
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            k = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += k;
+    }
+
+    uint32_t h[8];
+    uint8_t buffer[BLOCK];
+    std::size_t used;
+    uint64_t total;
+};
+
+// HMAC-SHA-256 (RFC 2104), fed incrementally like Sha256.
+class HmacSha256 {
+public:
+    HmacSha256(const uint8_t *key, std::size_t keyLen) {
+        uint8_t block[Sha256::BLOCK] = {};
+        if (keyLen > Sha256::BLOCK) {
+            Sha256::Digest d = Sha256::hash(key, keyLen);
+            std::memcpy(block, d.data(), d.size());
+        } else if (keyLen) {
+            std::memcpy(block, key, keyLen);
+        }
+        uint8_t pad[Sha256::BLOCK];
+        for (std::size_t i = 0; i < Sha256::BLOCK; i++) pad[i] = block[i] ^ 0x36;
+        inner.update(pad, sizeof pad);
+        for (std::size_t i = 0; i < Sha256::BLOCK; i++) pad[i] = block[i] ^ 0x5c;
+        outer.update(pad, sizeof pad);
+    }
+
+    HmacSha256 &update(const void *data, std::size_t len) {
+        inner.update(data, len);
+        return *this;
+    }
+
+    Sha256::Digest finish() {
+        Sha256::Digest innerHash = inner.finish();
+        return outer.update(innerHash.data(), innerHash.size()).finish();
+    }
+
+private:
+    Sha256 inner, outer;
+};
+
+inline Sha256::Digest hmacSha256(const uint8_t *key, std::size_t keyLen, const uint8_t *msg, std::size_t msgLen) {
+    return HmacSha256(key, keyLen).update(msg, msgLen).finish();
+}
+
+// HKDF-Extract: PRK = HMAC(salt, ikm); an empty salt means 32 zero bytes.
+inline Sha256::Digest hkdfExtract(const uint8_t *salt, std::size_t saltLen, const uint8_t *ikm, std::size_t ikmLen) {
+    static const uint8_t ZEROS[Sha256::DIGEST] = {};
+    if (!saltLen) return hmacSha256(ZEROS, sizeof ZEROS, ikm, ikmLen);
+    return hmacSha256(salt, saltLen, ikm, ikmLen);
+}
+
+// HKDF-Expand: fills out[0, len) (len <= 255 * 32) from the PRK and context info.
+inline void hkdfExpand(const Sha256::Digest &prk, const uint8_t *info, std::size_t infoLen, uint8_t *out,
+                       std::size_t len) {
+    if (len > 255 * Sha256::DIGEST) throw std::invalid_argument("HKDF: output too long");
+    Sha256::Digest t{};
+    std::size_t tLen = 0;
+    for (uint8_t counter = 1; len; counter++) { // T(i) = HMAC(PRK, T(i-1) | info | i)
+        t = HmacSha256(prk.data(), prk.size()).update(t.data(), tLen).update(info, infoLen).update(&counter, 1).finish();
+        tLen = t.size();
+        std::size_t take = std::min(len, t.size());
+        std::memcpy(out, t.data(), take);
+        out += take;
+        len -= take;
+    }
+}
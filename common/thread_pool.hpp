@@ -0,0 +1,178 @@
+#pragma once
+
+/*
+ * Small persistent thread pool with a work-stealing parallelFor.
+ * --------------------------------------------------------------
+ * parallelFor(n, grain, f) cuts [0, n) into chunks of `grain` items and
+ * hands every worker one contiguous run of chunks. A worker takes chunks
+ * from the front of its own run; once it is empty it steals the back half
+ * of another worker's run. Each run is a single 64-bit atomic word
+ * (begin, end), so owner pops and thief splits are one CAS each.
+ *
+ * The calling thread acts as worker 0, so ThreadPool(1) runs everything
+ * inline without starting any threads.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // Upper bound for a thread count given on a command line.
+    static constexpr unsigned MAX_THREADS = 1024;
+
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        runs = std::unique_ptr<Run[]>(new Run[threads]);
+        workerCount = threads;
+        for (unsigned i = 1; i < threads; i++)
+            workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned size() const { return workerCount; }
+
+    // Runs job(worker) once on every worker, including the caller, and waits.
+    void runOnAll(const std::function<void(unsigned)> &job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentJob = &job;
+            pending = workerCount - 1;
+            generation++;
+        }
+        wake.notify_all();
+        job(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        currentJob = nullptr;
+    }
+
+    // Calls f(begin, end, worker) over [0, n) in chunks of `grain` items.
+    template <class F>
+    void parallelFor(std::size_t n, std::size_t grain, F &&f) {
+        if (n == 0) return;
+        grain = std::max<std::size_t>(grain, 1);
+        std::size_t chunks = (n + grain - 1) / grain;
+        if (workerCount == 1 || chunks == 1) {
+            f(std::size_t(0), n, 0u);
+            return;
+        }
+        // Chunk indices must fit the 32-bit halves of a run; widen the grain if not.
+        while (chunks > UINT32_MAX) {
+            grain *= 2;
+            chunks = (n + grain - 1) / grain;
+        }
+
+        for (unsigned w = 0; w < workerCount; w++) {
+            uint64_t begin = chunks * w / workerCount;
+            uint64_t end = chunks * (w + 1) / workerCount;
+            runs[w].range.store(pack(begin, end), std::memory_order_relaxed);
+        }
+
+        runOnAll([&](unsigned self) {
+            auto runChunk = [&](uint64_t c) {
+                std::size_t begin = std::size_t(c) * grain;
+                f(begin, std::min(n, begin + grain), self);
+            };
+            for (;;) {
+                uint64_t c;
+                while (popFront(runs[self], c)) runChunk(c);
+                if (!steal(self)) break;
+            }
+        });
+    }
+
+private:
+    struct alignas(64) Run {
+        std::atomic<uint64_t> range{0};
+    };
+
+    static uint64_t pack(uint64_t begin, uint64_t end) { return (end << 32) | begin; }
+    static uint64_t lo(uint64_t v) { return v & 0xFFFFFFFFu; }
+    static uint64_t hi(uint64_t v) { return v >> 32; }
+
+    static bool popFront(Run &run, uint64_t &chunk) {
+        uint64_t cur = run.range.load(std::memory_order_acquire);
+        while (lo(cur) < hi(cur)) {
+            if (run.range.compare_exchange_weak(cur, pack(lo(cur) + 1, hi(cur)), std::memory_order_acq_rel)) {
+                chunk = lo(cur);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves the back half of some other worker's run into our own.
+    bool steal(unsigned self) {
+        for (unsigned i = 1; i < workerCount; i++) {
+            Run &victim = runs[(self + i) % workerCount];
+            uint64_t cur = victim.range.load(std::memory_order_acquire);
+            while (lo(cur) < hi(cur)) {
+                uint64_t mid = lo(cur) + (hi(cur) - lo(cur)) / 2;
+                if (victim.range.compare_exchange_weak(cur, pack(lo(cur), mid), std::memory_order_acq_rel)) {
+                    runs[self].range.store(pack(mid, hi(cur)), std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned self) {
+        uint64_t seen = 0;
+        for (;;) {
+            const std::function<void(unsigned)> *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                job = currentJob;
+            }
+            (*job)(self);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) done.notify_one();
+        }
+    }
+
+    unsigned workerCount = 1;
+    std::unique_ptr<Run[]> runs;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(unsigned)> *currentJob = nullptr;
+    uint64_t generation = 0;
+    unsigned pending = 0;
+    bool stopping = false;
+};
+
+// A --threads value: decimal digits only, 0 (one per hardware thread) up to
+// ThreadPool::MAX_THREADS. std::stoul alone would accept "-1" and wrap it.
+inline unsigned parseThreadCount(const std::string &s) {
+    if (s.empty() || s.size() > 4 || s.find_first_not_of("0123456789") != std::string::npos ||
+        std::stoul(s) > ThreadPool::MAX_THREADS)
+        throw std::invalid_argument("thread count must be 0-" + std::to_string(ThreadPool::MAX_THREADS));
+    return unsigned(std::stoul(s));
+}
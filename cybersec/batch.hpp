@@ -0,0 +1,297 @@
+#pragma once
+
+/*
+ * Mixed batches on the work-stealing pool
+ * ---------------------------------------
+ * A BatchScheduler collects the requests of one round (encrypt these
+ * buffers, answer those DH or ECDH handshakes) and run() executes them
+ * on a ThreadPool. Submission is single-threaded and only records a job;
+ * nothing runs until run().
+ *
+ * Every job is cut into tasks of roughly TASK_NS of estimated work, from
+ * the cipher's NS_PER_BYTE or handshakeNs(). Cipher tasks are never under
+ * MIN_CIPHER_BYTES, so the SIMD and bitsliced kernels get long runs, and
+ * a tiny buffer stays a single task. Consecutive tasks are then packed into
+ * units of about the same cost and the pool's parallelFor hands the units
+ * out; an idle worker steals half of another worker's remaining units. The
+ * units are balanced where the work divides; a single handshake that costs
+ * more than TASK_NS is a unit of its own.
+ *
+ * Handshakes on an EcCurve are worked in groups of ECDH_GROUP: all points
+ * stay Jacobian and one batched inversion per group brings them to affine
+ * form. Other groups go handshake by handshake. A peer value that fails
+ * validPublic() is marked as rejected rather than failing the batch.
+ *
+ * Per-request state (keyed contexts from make(), handshake records, the
+ * job and task lists) lives in the scheduler's arena and is released all
+ * at once by clear(). Workers draw scratch from arenas of their own. The
+ * buffers and peer values passed in stay owned by the caller and must stay
+ * valid until run() returns.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "../common/arena.hpp"
+#include "../common/thread_pool.hpp"
+#include "cipher.hpp"
+#include "key_agreement.hpp"
+
+namespace cybersec {
+
+class BatchScheduler {
+public:
+    // Estimated work per task, and the smallest cipher task worth splitting off.
+    static constexpr double TASK_NS = 250e3;
+    static constexpr std::size_t MIN_CIPHER_BYTES = std::size_t(64) << 10;
+    static constexpr std::size_t ECDH_GROUP = 8;
+
+    struct Stats {
+        std::size_t jobs = 0, tasks = 0, units = 0;
+        double wallSeconds = 0;
+    };
+
+    explicit BatchScheduler(ThreadPool &pool, uint64_t seed = std::random_device{}(),
+                            std::size_t arenaBytes = std::size_t(256) << 10)
+        : pool(pool), arena(arenaBytes), jobs(ArenaAllocator<Job>(arena)) {
+        workers = std::make_unique<Worker[]>(pool.size());
+        for (unsigned w = 0; w < pool.size(); w++) workers[w].rng.seed(seed + w);
+    }
+
+    BatchScheduler(const BatchScheduler &) = delete;
+    BatchScheduler &operator=(const BatchScheduler &) = delete;
+
+    // Per-request state that lives until clear(), e.g. make<SaesCipher>(key).
+    template <class T, class... Args>
+    T &make(Args &&...args) {
+        return *arena.make<T>(std::forward<Args>(args)...);
+    }
+
+    // --- Requests ---
+
+    template <BlockCipher C>
+    void encrypt(const C &cipher, std::span<const uint8_t> in, std::span<uint8_t> out) {
+        addEcb(cipher, in, out, false);
+    }
+
+    template <BlockCipher C>
+    void decrypt(const C &cipher, std::span<const uint8_t> in, std::span<uint8_t> out) {
+        addEcb(cipher, in, out, true);
+    }
+
+    template <BlockCipher C>
+    void ctr(const C &cipher, typename C::Block iv, std::span<const uint8_t> in, std::span<uint8_t> out) {
+        C::checkSizes(in.size(), out.size(), false);
+        if (in.empty()) return;
+        Job job = cipherJob(cipher, in.data(), out.data(), in.size());
+        job.counter = iv;
+        job.run = &runCtr<C>;
+        jobs.push_back(job);
+    }
+
+    // One handshake per peer value; the records are filled in by run().
+    template <KeyAgreement G>
+    std::span<Handshake<G>> agree(const G &group, std::span<const PublicKeyOf<G>> peers) {
+        Handshake<G> *records = arena.array<Handshake<G>>(peers.size());
+        if (peers.empty()) return {records, 0};
+        Job job;
+        job.engine = &group;
+        job.in = peers.data();
+        job.out = records;
+        job.items = peers.size();
+        job.bytes = 0;
+        job.itemNs = handshakeNs(group);
+        job.minItems = handshakesPerTask(group);
+        job.run = &runAgree<G>;
+        jobs.push_back(job);
+        return {records, peers.size()};
+    }
+
+    // --- Execution ---
+
+    Stats run() {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        Stats stats;
+        stats.jobs = jobs.size();
+
+        std::vector<Task, ArenaAllocator<Task>> tasks{ArenaAllocator<Task>(arena)};
+        for (uint32_t j = 0; j < jobs.size(); j++) {
+            const Job &job = jobs[j];
+            std::size_t per = std::max<std::size_t>(std::size_t(TASK_NS / job.itemNs), 1);
+            per = std::max(per, job.minItems);
+            for (std::size_t begin = 0; begin < job.items; begin += per)
+                tasks.push_back({j, begin, std::min(job.items, begin + per)});
+        }
+
+        // units[u] .. units[u + 1] are the tasks of unit u.
+        std::vector<std::size_t, ArenaAllocator<std::size_t>> units{ArenaAllocator<std::size_t>(arena)};
+        double load = TASK_NS;
+        for (std::size_t t = 0; t < tasks.size(); t++) {
+            if (load >= TASK_NS) {
+                units.push_back(t);
+                load = 0;
+            }
+            load += double(tasks[t].end - tasks[t].begin) * jobs[tasks[t].job].itemNs;
+        }
+        units.push_back(tasks.size());
+        stats.tasks = tasks.size();
+        stats.units = units.size() - 1;
+
+        pool.parallelFor(stats.units, 1, [&](std::size_t begin, std::size_t end, unsigned w) {
+            for (std::size_t u = begin; u < end; u++) {
+                for (std::size_t t = units[u]; t < units[u + 1]; t++) {
+                    const Job &job = jobs[tasks[t].job];
+                    workers[w].scratch.reset();
+                    job.run(job, tasks[t].begin, tasks[t].end, workers[w]);
+                }
+            }
+        });
+        jobs.clear();
+        stats.wallSeconds = std::chrono::duration<double>(clock::now() - start).count();
+        return stats;
+    }
+
+    // Drops the per-request state of the last round. The records returned by
+    // agree() and the objects from make() become invalid.
+    void clear() {
+        jobs = JobList(ArenaAllocator<Job>(arena));
+        arena.reset();
+    }
+
+    std::size_t pending() const { return jobs.size(); }
+    std::size_t arenaBytes() const { return arena.bytesReserved(); }
+
+private:
+    struct Worker {
+        std::mt19937_64 rng;
+        Arena scratch{std::size_t(16) << 10};
+    };
+
+    struct Job {
+        void (*run)(const Job &, std::size_t begin, std::size_t end, Worker &) = nullptr;
+        const void *engine = nullptr; // the cipher or group
+        const void *in = nullptr;     // bytes or peer values
+        void *out = nullptr;          // bytes or handshake records
+        std::size_t items = 0;        // blocks or handshakes
+        std::size_t bytes = 0;        // cipher jobs: length of the buffer
+        std::size_t minItems = 1;     // smallest task
+        double itemNs = 1;
+        uint32_t counter = 0; // CTR start block
+        bool decrypting = false;
+    };
+
+    struct Task {
+        uint32_t job;
+        std::size_t begin, end;
+    };
+
+    using JobList = std::vector<Job, ArenaAllocator<Job>>;
+
+    template <BlockCipher C>
+    Job cipherJob(const C &cipher, const uint8_t *in, uint8_t *out, std::size_t bytes) {
+        Job job;
+        job.engine = &cipher;
+        job.in = in;
+        job.out = out;
+        job.bytes = bytes;
+        job.items = (bytes + C::BLOCK_BYTES - 1) / C::BLOCK_BYTES;
+        job.itemNs = C::NS_PER_BYTE * C::BLOCK_BYTES;
+        job.minItems = MIN_CIPHER_BYTES / C::BLOCK_BYTES;
+        return job;
+    }
+
+    template <BlockCipher C>
+    void addEcb(const C &cipher, std::span<const uint8_t> in, std::span<uint8_t> out, bool decrypting) {
+        C::checkSizes(in.size(), out.size(), true);
+        if (in.empty()) return;
+        Job job = cipherJob(cipher, in.data(), out.data(), in.size());
+        job.decrypting = decrypting;
+        job.run = &runEcb<C>;
+        jobs.push_back(job);
+    }
+
+    template <BlockCipher C>
+    static void runEcb(const Job &job, std::size_t begin, std::size_t end, Worker &) {
+        const C &cipher = *static_cast<const C *>(job.engine);
+        const uint8_t *in = static_cast<const uint8_t *>(job.in) + begin * C::BLOCK_BYTES;
+        uint8_t *out = static_cast<uint8_t *>(job.out) + begin * C::BLOCK_BYTES;
+        if (job.decrypting) cipher.decryptBlocks(in, out, end - begin);
+        else cipher.encryptBlocks(in, out, end - begin);
+    }
+
+    template <BlockCipher C>
+    static void runCtr(const Job &job, std::size_t begin, std::size_t end, Worker &) {
+        const C &cipher = *static_cast<const C *>(job.engine);
+        std::size_t first = begin * C::BLOCK_BYTES, last = std::min(job.bytes, end * C::BLOCK_BYTES);
+        cipher.ctrBytes(typename C::Block(job.counter + begin), static_cast<const uint8_t *>(job.in) + first,
+                        static_cast<uint8_t *>(job.out) + first, last - first);
+    }
+
+    template <KeyAgreement G>
+    static std::size_t handshakesPerTask(const G &) {
+        return 1;
+    }
+
+    template <std::size_t LIMBS>
+    static std::size_t handshakesPerTask(const EcCurve<LIMBS> &) {
+        return ECDH_GROUP;
+    }
+
+    template <KeyAgreement G>
+    static void runAgree(const Job &job, std::size_t begin, std::size_t end, Worker &worker) {
+        const G &group = *static_cast<const G *>(job.engine);
+        agreeRange(group, static_cast<const PublicKeyOf<G> *>(job.in) + begin,
+                   static_cast<Handshake<G> *>(job.out) + begin, end - begin, worker);
+    }
+
+    template <KeyAgreement G>
+    static void agreeRange(const G &group, const PublicKeyOf<G> *peers, Handshake<G> *out, std::size_t n,
+                           Worker &worker) {
+        for (std::size_t i = 0; i < n; i++) {
+            if (!group.validPublic(peers[i])) continue;
+            auto x = group.randomPrivateKey(worker.rng);
+            out[i].ours = group.publicKey(x);
+            out[i].secret = group.sharedSecret(peers[i], x);
+            out[i].accepted = true;
+        }
+    }
+
+    // Both points of every handshake stay Jacobian until one batched inversion.
+    template <std::size_t LIMBS>
+    static void agreeRange(const EcCurve<LIMBS> &curve, const typename EcCurve<LIMBS>::Affine *peers,
+                           Handshake<EcCurve<LIMBS>> *out, std::size_t n, Worker &worker) {
+        using Curve = EcCurve<LIMBS>;
+        auto *jacobian = worker.scratch.array<typename Curve::Jacobian>(2 * n);
+        auto *affine = worker.scratch.array<typename Curve::Affine>(2 * n);
+        auto *scratch = worker.scratch.array<typename Curve::Int>(2 * n);
+        for (std::size_t i = 0; i < n; i++) {
+            jacobian[2 * i] = jacobian[2 * i + 1] = curve.infinity();
+            if (!curve.validPublic(peers[i])) continue;
+            auto d = curve.randomPrivateKey(worker.rng);
+            jacobian[2 * i] = curve.comb().mul(d);
+            jacobian[2 * i + 1] = curve.mulWnaf(peers[i], d);
+        }
+        curve.toAffineBatch(jacobian, affine, 2 * n, scratch);
+        for (std::size_t i = 0; i < n; i++) {
+            if (affine[2 * i].infinity || affine[2 * i + 1].infinity) continue;
+            out[i].ours = affine[2 * i];
+            out[i].secret = affine[2 * i + 1].x;
+            out[i].accepted = true;
+        }
+    }
+
+    ThreadPool &pool;
+    Arena arena;
+    JobList jobs;
+    std::unique_ptr<Worker[]> workers;
+};
+
+} // namespace cybersec
@@ -0,0 +1,188 @@
+#pragma once
+
+/*
+ * Block ciphers behind one interface
+ * ----------------------------------
+ * The BlockCipher concept is what generic code (the batch scheduler, the
+ * span helpers below) may call on a keyed cipher: three raw kernels over
+ * caller-owned bytes,
+ *
+ *   encryptBlocks(in, out, blocks)   ECB over whole blocks
+ *   decryptBlocks(in, out, blocks)
+ *   ctrBytes(counter, in, out, bytes) XOR with the CTR keystream that
+ *                                     starts at block counter `counter`
+ *
+ * plus its Key and Block types, a NAME and NS_PER_BYTE, a rough cost used
+ * only to size work items. Everything is resolved at compile time; there
+ * are no virtual calls anywhere on the block path.
+ *
+ * BlockCipherBase<Derived, Block> is the CRTP half: from those kernels it
+ * builds the span API with size checks and optional ThreadPool splitting,
+ * so every cipher gets the same encrypt/decrypt/ctr surface. In all of
+ * them `in` and `out` may alias, and the counter wraps at the block size.
+ *
+ * SdesCipher and SaesCipher adapt the engines of 01_des and 02_aes: bulk
+ * S-DES goes to the bitsliced kernel and S-AES to its SIMD kernel, each
+ * picked for the CPU at run time.
+ */
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "../01_des/sdes.hpp"
+#include "../01_des/sdes_bitslice.hpp"
+#include "../02_aes/saes.hpp"
+#include "../02_aes/saes_modes.hpp"
+#include "../common/instrument.hpp"
+#include "../common/thread_pool.hpp"
+
+namespace cybersec {
+
+template <class C>
+concept BlockCipher = requires(const C &c, const uint8_t *in, uint8_t *out, std::size_t n, typename C::Block counter) {
+    typename C::Key;
+    requires std::constructible_from<C, typename C::Key>;
+    { C::NAME } -> std::convertible_to<const char *>;
+    { C::BLOCK_BYTES } -> std::convertible_to<std::size_t>;
+    { C::NS_PER_BYTE } -> std::convertible_to<double>;
+    c.encryptBlocks(in, out, n);
+    c.decryptBlocks(in, out, n);
+    c.ctrBytes(counter, in, out, n);
+};
+
+template <class Derived, class BlockT>
+class BlockCipherBase {
+public:
+    using Block = BlockT;
+    static constexpr std::size_t BLOCK_BYTES = sizeof(BlockT);
+
+    // Bytes per parallel work item when a pool is passed in.
+    static constexpr std::size_t PARALLEL_BYTES = std::size_t(512) << 10;
+
+    // ECB over whole blocks.
+    void encrypt(std::span<const uint8_t> in, std::span<uint8_t> out, ThreadPool *pool = nullptr) const {
+        ecb(in, out, false, pool);
+    }
+
+    void decrypt(std::span<const uint8_t> in, std::span<uint8_t> out, ThreadPool *pool = nullptr) const {
+        ecb(in, out, true, pool);
+    }
+
+    // CTR on any length; it is its own inverse.
+    void ctr(Block iv, std::span<const uint8_t> in, std::span<uint8_t> out, ThreadPool *pool = nullptr) const {
+        checkSizes(in.size(), out.size(), false);
+        std::size_t blocks = (in.size() + BLOCK_BYTES - 1) / BLOCK_BYTES;
+        split(blocks, pool, [&](std::size_t begin, std::size_t end) {
+            std::size_t first = begin * BLOCK_BYTES, last = std::min(in.size(), end * BLOCK_BYTES);
+            self().ctrBytes(Block(iv + begin), in.data() + first, out.data() + first, last - first);
+        });
+    }
+
+    static void checkSizes(std::size_t in, std::size_t out, bool wholeBlocks) {
+        if (out < in) throw std::invalid_argument(std::string(Derived::NAME) + ": output buffer is smaller than the input");
+        if (wholeBlocks && in % BLOCK_BYTES != 0)
+            throw std::invalid_argument(std::string(Derived::NAME) + ": ECB input must be a whole number of blocks");
+    }
+
+private:
+    const Derived &self() const { return static_cast<const Derived &>(*this); }
+
+    void ecb(std::span<const uint8_t> in, std::span<uint8_t> out, bool decrypting, ThreadPool *pool) const {
+        checkSizes(in.size(), out.size(), true);
+        split(in.size() / BLOCK_BYTES, pool, [&](std::size_t begin, std::size_t end) {
+            const uint8_t *src = in.data() + begin * BLOCK_BYTES;
+            uint8_t *dst = out.data() + begin * BLOCK_BYTES;
+            if (decrypting) self().decryptBlocks(src, dst, end - begin);
+            else self().encryptBlocks(src, dst, end - begin);
+        });
+    }
+
+    template <class F>
+    static void split(std::size_t blocks, ThreadPool *pool, F &&f) {
+        if (!pool) {
+            f(std::size_t(0), blocks);
+            return;
+        }
+        pool->parallelFor(blocks, PARALLEL_BYTES / BLOCK_BYTES,
+                          [&](std::size_t begin, std::size_t end, unsigned) { f(begin, end); });
+    }
+};
+
+// --- S-DES: 8-bit blocks, 10-bit keys ---
+class SdesCipher : public BlockCipherBase<SdesCipher, uint8_t> {
+public:
+    using Key = uint16_t;
+    static constexpr const char *NAME = "S-DES";
+    static constexpr double NS_PER_BYTE = 0.2;
+
+    // Below this many blocks the bitsliced kernel spends more on transposing
+    // than it saves, and the round functions run block by block instead.
+    static constexpr std::size_t BITSLICE_MIN = 256;
+
+    explicit SdesCipher(Key key) : key(key), ctx(key) {}
+
+    void encryptBlocks(const uint8_t *in, uint8_t *out, std::size_t n) const { blocks(in, out, n, false); }
+    void decryptBlocks(const uint8_t *in, uint8_t *out, std::size_t n) const { blocks(in, out, n, true); }
+
+    // An 8-bit counter repeats every 256 bytes, so long runs encrypt the 256
+    // counter values once and reuse that keystream.
+    void ctrBytes(uint8_t counter, const uint8_t *in, uint8_t *out, std::size_t n) const {
+        if (n < BITSLICE_MIN) {
+            for (std::size_t i = 0; i < n; i++) out[i] = in[i] ^ ctx.encrypt(uint8_t(counter + i));
+            return;
+        }
+        uint8_t stream[256];
+        for (int i = 0; i < 256; i++) stream[i] = uint8_t(counter + i);
+        sdes_bitslice::encryptBlocks(stream, stream, 256, key);
+        for (std::size_t i = 0; i < n; i++) out[i] = in[i] ^ stream[i & 0xFF];
+    }
+
+private:
+    void blocks(const uint8_t *in, uint8_t *out, std::size_t n, bool decrypting) const {
+        if (n >= BITSLICE_MIN) sdes_bitslice::encryptBlocks(in, out, n, key, decrypting);
+        else if (decrypting) ctx.decrypt(in, out, n);
+        else ctx.encrypt(in, out, n);
+    }
+
+    Key key;
+    sdes_packed::SdesContext ctx;
+};
+
+// --- S-AES: 16-bit blocks stored big-endian, 16-bit keys ---
+class SaesCipher : public BlockCipherBase<SaesCipher, uint16_t> {
+public:
+    using Key = uint16_t;
+    static constexpr const char *NAME = "S-AES";
+    static constexpr double NS_PER_BYTE = 0.1;
+
+    explicit SaesCipher(Key key) : saes(key) {}
+
+    void encryptBlocks(const uint8_t *in, uint8_t *out, std::size_t n) const {
+        instrument::count(instrument::Counter::SaesBytes, 2 * n);
+        saes_modes::ecbBlocks(saes, in, out, n, false);
+    }
+
+    void decryptBlocks(const uint8_t *in, uint8_t *out, std::size_t n) const {
+        instrument::count(instrument::Counter::SaesBytes, 2 * n);
+        saes_modes::ecbBlocks(saes, in, out, n, true);
+    }
+
+    void ctrBytes(uint16_t counter, const uint8_t *in, uint8_t *out, std::size_t n) const {
+        instrument::count(instrument::Counter::SaesBytes, n);
+        saes_modes::ctrRange(saes, counter, in, out, n);
+    }
+
+    const SimplifiedAES &engine() const { return saes; }
+
+private:
+    SimplifiedAES saes;
+};
+
+static_assert(BlockCipher<SdesCipher> && BlockCipher<SaesCipher>);
+
+} // namespace cybersec
@@ -0,0 +1,84 @@
+#pragma once
+
+/*
+ * Key agreement behind one interface
+ * ----------------------------------
+ * DhGroup<LIMBS> (04.2_diffie_hellman) and EcCurve<LIMBS> (04.1) already
+ * share the shape of a key agreement:
+ *
+ *   randomPrivateKey(rng)     a fresh private key
+ *   publicKey(x)              the value sent to the peer
+ *   validPublic(y)            range / on-curve check of a peer value
+ *   sharedSecret(y, x)        throws on an invalid peer value
+ *
+ * so the KeyAgreement concept states exactly that, and the key and secret
+ * types are read off those calls instead of being declared by hand. Any
+ * group with the same four calls plugs into the batch scheduler.
+ *
+ * handshakeNs() is a rough cost of one handshake (our public value plus
+ * the shared secret) on one core, scaled from the benchmark numbers; the
+ * scheduler only uses it to size work items.
+ */
+
+#include <concepts>
+#include <cstddef>
+#include <random>
+#include <utility>
+
+#include "../04.1_ecc_diiffie_hellman/ec.hpp"
+#include "../04.2_diffie_hellman/dh.hpp"
+
+namespace cybersec {
+
+template <class G>
+using PrivateKeyOf = decltype(std::declval<const G &>().randomPrivateKey(std::declval<std::mt19937_64 &>()));
+
+template <class G>
+using PublicKeyOf = decltype(std::declval<const G &>().publicKey(std::declval<const PrivateKeyOf<G> &>()));
+
+template <class G>
+using SecretOf = decltype(std::declval<const G &>().sharedSecret(std::declval<const PublicKeyOf<G> &>(),
+                                                                 std::declval<const PrivateKeyOf<G> &>()));
+
+template <class G>
+concept KeyAgreement = requires(const G &g, std::mt19937_64 &rng) {
+    g.randomPrivateKey(rng);
+    { g.bits() } -> std::convertible_to<std::size_t>;
+} && requires(const G &g, const PrivateKeyOf<G> &x, const PublicKeyOf<G> &y) {
+    { g.publicKey(x) } -> std::same_as<PublicKeyOf<G>>;
+    { g.validPublic(y) } -> std::convertible_to<bool>;
+    g.sharedSecret(y, x);
+};
+
+// One side of a handshake against a peer's public value.
+template <KeyAgreement G>
+struct Handshake {
+    PublicKeyOf<G> ours{}; // the value to send back
+    SecretOf<G> secret{};  // left zero when the peer value was rejected
+    bool accepted = false;
+};
+
+// --- Cost estimates ---
+
+// Comb keygen plus a sliding-window modexp: about 6 ms at 2048 bits, cubic in the size.
+template <std::size_t LIMBS>
+double handshakeNs(const DhGroup<LIMBS> &) {
+    double scale = double(LIMBS) / 32;
+    return 6e6 * scale * scale * scale;
+}
+
+// Comb keygen plus a wNAF multiply: about 0.23 ms at 256 bits.
+template <std::size_t LIMBS>
+double handshakeNs(const EcCurve<LIMBS> &) {
+    double scale = double(LIMBS) / 4;
+    return 2.3e5 * scale * scale * scale;
+}
+
+template <KeyAgreement G>
+double handshakeNs(const G &) {
+    return 1e6;
+}
+
+static_assert(KeyAgreement<Modp2048> && KeyAgreement<EcCurve<4>>);
+
+} // namespace cybersec